@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <runtime/interpreter/interpreter.h>
+#include <runtime/vm/vm.h>
+#include <runtime/closure/closure.h>
+
+
+static constexpr const char* kUsage =
+    "usage: itmoscript_bench [--runs=N] [--engine=tree|closure|vm|all] [script.is...]\n";
+
+
+using EngineFn = bool (*)(std::istream&, std::ostream&);
+
+
+struct Engine {
+    std::string_view name;
+    EngineFn run;
+};
+
+
+static constexpr Engine kEngines[] = {
+    {"tree", [](std::istream& in, std::ostream& out) { return Interpreter::Interpret(in, out); }},
+    {"closure", [](std::istream& in, std::ostream& out) { return ClosureEngine::Interpret(in, out); }},
+    {"vm", [](std::istream& in, std::ostream& out) { return VirtualMachine::Interpret(in, out); }},
+};
+
+
+// Returns the median wall time in milliseconds, or a negative value if the
+// script failed to run.
+static double Measure(const std::string& source, EngineFn run, int runs) {
+    std::vector<double> samples;
+    samples.reserve(runs);
+
+    for (int i = 0; i < runs; ++i) {
+        std::istringstream input(source);
+        std::ostringstream output;
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok = run(input, output);
+        auto finish = std::chrono::steady_clock::now();
+
+        if (!ok) {
+            return -1.0;
+        }
+        samples.push_back(std::chrono::duration<double, std::milli>(finish - start).count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+
+int main(int argc, char** argv) {
+    int runs = 5;
+    std::string_view engine = "all";
+    std::vector<std::filesystem::path> scripts;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--runs=")) {
+            runs = std::max(1, std::stoi(std::string(arg.substr(std::string_view("--runs=").size()))));
+        } else if (arg.starts_with("--engine=")) {
+            engine = arg.substr(std::string_view("--engine=").size());
+        } else if (arg.starts_with("--")) {
+            std::cerr << kUsage;
+            return 1;
+        } else {
+            scripts.emplace_back(arg);
+        }
+    }
+
+    if (scripts.empty()) {
+        for (const auto& entry : std::filesystem::directory_iterator(ITMO_BENCH_SCRIPTS_DIR)) {
+            if (entry.path().extension() == ".is") {
+                scripts.push_back(entry.path());
+            }
+        }
+        std::sort(scripts.begin(), scripts.end());
+    }
+
+    bool success = true;
+    for (const auto& path : scripts) {
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "unable to open " << path << "\n";
+            return 1;
+        }
+        std::stringstream source;
+        source << file.rdbuf();
+
+        for (const auto& [name, run] : kEngines) {
+            if (engine != "all" && engine != name) {
+                continue;
+            }
+            double ms = Measure(source.str(), run, runs);
+            std::cout << path.filename().string() << "\t" << name << "\t";
+            if (ms < 0) {
+                std::cout << "failed\n";
+                success = false;
+            } else {
+                std::cout << ms << " ms\n";
+            }
+        }
+    }
+
+    return success ? 0 : 1;
+}
@@ -1,15 +1,90 @@
+#include <charconv>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
+#include <string_view>
 #include <runtime/interpreter/interpreter.h>
+#include <runtime/vm/vm.h>
+#include <runtime/closure/closure.h>
+#include <runtime/aot/aot.h>
+
+
+static constexpr const char* kUsage =
+    "usage: itmoscript_interpreter [--engine=tree|vm|closure] [--dump-bytecode] [--dump-fusion]\n"
+    "                             [--dump-call-caches] [--max-depth=<calls>] <file.is>\n"
+    "       itmoscript_interpreter --emit-cpp [--output=<executable>] <file.is>\n";
+
 
 int main(int argc, char** argv) {
-    std::ifstream file(argv[1]);
+    std::string_view engine = "tree";
+    bool dump_bytecode = false;
+    bool dump_fusion = false;
+    bool dump_call_caches = false;
+    bool emit_cpp = false;
+    std::size_t max_depth = kDefaultMaxCallDepth;
+    std::filesystem::path executable;
+    const char* path = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--engine=")) {
+            engine = arg.substr(std::string_view("--engine=").size());
+        } else if (arg == "--dump-bytecode") {
+            dump_bytecode = true;
+        } else if (arg == "--dump-fusion") {
+            dump_fusion = true;
+        } else if (arg == "--dump-call-caches") {
+            dump_call_caches = true;
+        } else if (arg == "--emit-cpp") {
+            emit_cpp = true;
+        } else if (arg.starts_with("--max-depth=")) {
+            std::string_view value = arg.substr(std::string_view("--max-depth=").size());
+            auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), max_depth);
+            if (error != std::errc() || end != value.data() + value.size()) {
+                std::cerr << kUsage;
+                return 1;
+            }
+        } else if (arg.starts_with("--output=")) {
+            executable = arg.substr(std::string_view("--output=").size());
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (!path || (engine != "tree" && engine != "vm" && engine != "closure")) {
+        std::cerr << kUsage;
+        return 1;
+    }
+
+    std::ifstream file(path);
 
     if (!file) {
         std::cerr << "unable to open the file\n";
+        return 1;
+    }
+
+    if (emit_cpp) {
+        if (executable.empty()) {
+            executable = std::filesystem::path(path).replace_extension();
+        }
+        return AotCompiler::Build(file, executable) ? 0 : 1;
+    }
+
+    if (dump_bytecode) {
+        return VirtualMachine::Disassemble(file, std::cout) ? 0 : 1;
+    }
+
+    bool success = false;
+    if (engine == "vm") {
+        success = VirtualMachine::Interpret(file, std::cout, max_depth);
+    } else if (engine == "closure") {
+        success = ClosureEngine::Interpret(file, std::cout, max_depth);
+    } else {
+        success = Interpreter::Interpret(file, std::cout, dump_fusion ? &std::cerr : nullptr
+                                        , dump_call_caches ? &std::cerr : nullptr, max_depth);
     }
 
-    if (Interpreter::Interpret(file, std::cout)) {
+    if (success) {
         std::cout << std::endl;
         return 0;
     } else {
@@ -10,4 +10,17 @@ Token::Token(TokenType tok, std::string lex
       , lexeme(std::move(lex))
       , line(ln)
       , column(col) 
-{}
\ No newline at end of file
+{}
+
+
+TokenType CompoundBaseOperation(TokenType type) {
+    switch (type) {
+        case TokenType::plus_eq_: return TokenType::plus_;
+        case TokenType::minus_eq_: return TokenType::minus_;
+        case TokenType::star_eq_: return TokenType::star_;
+        case TokenType::slash_eq_: return TokenType::slash_;
+        case TokenType::percent_eq_: return TokenType::percent_;
+        case TokenType::degree_eq_: return TokenType::degree_;
+        default: return type;
+    }
+}
\ No newline at end of file
@@ -36,6 +36,10 @@ enum class TokenType {
     r_bracket_, comma_, colon_
 };
 
+// Binary operator applied by a compound assignment (`plus_eq_` -> `plus_`);
+// any other token is returned unchanged.
+TokenType CompoundBaseOperation(TokenType);
+
 struct Token {
     Token(TokenType, std::string
         , std::size_t, std::size_t);
@@ -0,0 +1,99 @@
+#include <cerrno>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include <semantic.h>
+#include <syntax.h>
+#include <runtime/aot/aot.h>
+#include <runtime/aot/aot_config.h>
+#include <runtime/aot/emitter/emitter.h>
+#include <runtime/aot/errors/aot_errors.h>
+#include <runtime/enviroment/global_table.h>
+#include <runtime/interpreter/builtins/builtins.h>
+#include <runtime/interpreter/errors/intrptr_errors.h>
+
+
+extern char** environ;
+
+
+namespace {
+
+// Runs the compiler with `arguments` as its argv, so that nothing in them,
+// such as a path taken from the script name, is interpreted by a shell.
+bool RunCompiler(std::vector<std::string> arguments) {
+    std::vector<char*> argv;
+    for (auto& argument : arguments) {
+        argv.push_back(argument.data());
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = 0;
+    if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) != 0) {
+        return false;
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+}
+
+
+bool AotCompiler::Emit(std::istream& in, std::ostream& cpp) {
+    try {
+        SyntaxAnalizer parser(in);
+        auto program = parser.Parse();
+
+        // Slots are bound exactly as AotRuntime::Run binds them at startup.
+        GlobalTable globals;
+        BuiltinRegistry::Get().RegisterAll(globals, std::cout, std::cin);
+        SemanticAnalizer sem(std::cerr, globals.Names());
+        if (!sem.Analyse(program)) { return false; }
+        for (const auto& name : sem.GlobalNames()) {
+            globals.Bind(name);
+        }
+
+        cpp << CppEmitter(globals).Emit(program);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Compile error: " << e.what() << "\n";
+        return false;
+    } catch (...) {
+        std::cerr << InterpreterError::kUnknownError;
+        return false;
+    }
+}
+
+
+bool AotCompiler::Build(std::istream& in, const std::filesystem::path& executable) {
+    std::filesystem::path source = executable;
+    source += ".cpp";
+
+    std::ofstream file(source);
+    if (!file) {
+        std::cerr << "Compile error: " << AotError::kCannotWriteSource << source.string() << "\n";
+        return false;
+    }
+    if (!Emit(in, file)) {
+        return false;
+    }
+    file.close();
+
+    std::vector<std::string> arguments = {kAotCompiler};
+    arguments.insert(arguments.end(), std::begin(kAotFlags), std::end(kAotFlags));
+    arguments.insert(arguments.end(), {source.string(), "-o", executable.string()});
+    arguments.insert(arguments.end(), std::begin(kAotLibraries), std::end(kAotLibraries));
+    if (!RunCompiler(std::move(arguments))) {
+        std::cerr << "Compile error: " << AotError::kCompilerFailed << source.string() << "\n";
+        return false;
+    }
+    return true;
+}
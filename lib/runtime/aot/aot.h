@@ -0,0 +1,19 @@
+#pragma once
+
+#include <filesystem>
+#include <iostream>
+
+
+// Ahead-of-time compilation: the program is checked as for the
+// interpreters, lowered to C++ by CppEmitter and compiled by the C++
+// compiler of this build against its own libraries, so the executable
+// shares values, operators and builtins with the interpreters. Errors go
+// to stderr.
+class AotCompiler {
+public:
+    // Writes the C++ translation unit for the program to `cpp`.
+    static bool Emit(std::istream&, std::ostream& cpp);
+
+    // Writes `<executable>.cpp` and compiles it into `executable`.
+    static bool Build(std::istream&, const std::filesystem::path& executable);
+};
@@ -0,0 +1,627 @@
+#include <cmath>
+#include <cstdio>
+#include <string_view>
+#include <utility>
+
+#include <runtime/aot/emitter/emitter.h>
+#include <runtime/evaluator/operations/register.h>
+
+
+namespace {
+
+std::string BinaryOpName(BinaryOp op) {
+    static constexpr const char* kNames[] = {
+        "BinaryOp::Add", "BinaryOp::Sub", "BinaryOp::Mul", "BinaryOp::Div", "BinaryOp::Mod"
+        , "BinaryOp::Pow", "BinaryOp::Lt", "BinaryOp::Le", "BinaryOp::Gt", "BinaryOp::Ge"
+    };
+    return kNames[static_cast<std::size_t>(op)];
+}
+
+
+std::string UnaryOpName(UnaryOp op) {
+    return op == UnaryOp::Neg ? "UnaryOp::Neg" : "UnaryOp::Not";
+}
+
+
+// Hexadecimal floating literals keep every bit of the number.
+std::string NumberLiteral(double value) {
+    if (std::isinf(value)) {
+        return value > 0 ? "std::numeric_limits<double>::infinity()" : "-std::numeric_limits<double>::infinity()";
+    }
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%a", value);
+    return buffer;
+}
+
+
+// Anything but printable ASCII is written as a three-digit octal escape,
+// which no following character can extend.
+std::string Quote(std::string_view text) {
+    std::string quoted = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += static_cast<char>(c);
+        } else if (c >= 0x20 && c < 0x7F && c != '?') {
+            quoted += static_cast<char>(c);
+        } else {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\%03o", c);
+            quoted += buffer;
+        }
+    }
+    return quoted + "\"";
+}
+
+
+std::string LocalAddress(const LexicalAddress& address) {
+    switch (address.kind) {
+        case LexicalAddress::Kind::Cell:
+            return "AotRuntime::Cell(" + std::to_string(address.depth) + ", " + std::to_string(address.slot) + ")";
+        case LexicalAddress::Kind::Upvalue:
+            return "AotRuntime::Upvalue(" + std::to_string(address.slot) + ")";
+        default:
+            return "AotRuntime::Local(" + std::to_string(address.depth) + ", " + std::to_string(address.slot) + ")";
+    }
+}
+
+
+std::string Join(const std::vector<std::string>& items, const std::string& separator) {
+    std::string joined;
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        if (i != 0) {
+            joined += separator;
+        }
+        joined += items[i];
+    }
+    return joined;
+}
+
+} // namespace
+
+
+CppEmitter::CppEmitter(const GlobalTable& globals)
+    : globals_(globals)
+{}
+
+
+std::string CppEmitter::Emit(const std::vector<Statement>& program) {
+    current_ = Function{};
+    current_.env = "top_level";
+    current_.top_level = true;
+    EmitStatements(program);
+
+    std::vector<std::string> names;
+    for (const auto& name : globals_.Names()) {
+        names.push_back(Quote(name));
+    }
+
+    std::string out;
+    out += "// Generated by itmoscript_interpreter --emit-cpp.\n";
+    out += "#include <limits>\n";
+    out += "#include <runtime/aot/support/support.h>\n\n";
+    out += "namespace {\n\n";
+    out += "GlobalTable globals;\n\n";
+    for (const auto& constant : constants_) {
+        out += constant + "\n";
+    }
+    if (!constants_.empty()) {
+        out += "\n";
+    }
+    for (const auto& declaration : declarations_) {
+        out += declaration + "\n";
+    }
+    if (!declarations_.empty()) {
+        out += "\n";
+    }
+    for (const auto& definition : definitions_) {
+        out += definition + "\n\n";
+    }
+    out += "void Main(Enviroment& top_level) {\n";
+    for (const auto& line : current_.lines) {
+        out += line + "\n";
+    }
+    out += "}\n\n} // namespace\n\n\n";
+    out += "int main() {\n";
+    out += "    return AotRuntime::Run(globals, {" + Join(names, ", ") + "}, Main);\n";
+    out += "}\n";
+    return out;
+}
+
+
+void CppEmitter::EmitStatement(const Statement& stmt) {
+    std::visit([this](const auto& node) {
+        EmitStatementImpl(node);
+    }, stmt.value);
+}
+
+
+void CppEmitter::EmitStatements(const std::vector<Statement>& stmts) {
+    for (const auto& stmt : stmts) {
+        EmitStatement(stmt);
+    }
+}
+
+
+// The caller has opened the C++ block the scope lives in.
+void CppEmitter::EmitScope(const std::vector<Statement>& stmts, const ScopeLayout& layout) {
+    if (layout.elided) {
+        EmitStatements(stmts);
+        return;
+    }
+
+    std::string outer = current_.env;
+    std::string scope = Temporary("s");
+    Line("Enviroment " + scope + "(&" + outer + ", " + std::to_string(layout.slots) + ");");
+    current_.env = scope;
+    EmitStatements(stmts);
+    current_.env = outer;
+}
+
+
+void CppEmitter::EmitStatementImpl(const ExpressionStatement& stmt) {
+    EmitExpression(stmt.expression);
+}
+
+
+void CppEmitter::EmitStatementImpl(const IfStatement& stmt) {
+    std::string condition = EmitCondition(stmt.condition);
+    Open("if (" + condition + ") {");
+    EmitScope(stmt.then_case, stmt.then_scope);
+    if (!stmt.else_case.empty()) {
+        Close("} else {");
+        ++current_.depth;
+        EmitScope(stmt.else_case, stmt.else_scope);
+    }
+    Close();
+}
+
+
+// A condition that needs lines of its own is evaluated at the top of the
+// loop body, which `continue` returns to as well.
+void CppEmitter::EmitStatementImpl(const WhileStatement& stmt) {
+    std::string outer = current_.env;
+    Open("{");
+    std::string scope = EmitLoopScope(stmt.body_scope);
+
+    std::vector<std::string> lines = std::exchange(current_.lines, {});
+    ++current_.depth;
+    std::string condition = EmitCondition(stmt.condition);
+    --current_.depth;
+    std::vector<std::string> condition_lines = std::exchange(current_.lines, std::move(lines));
+
+    if (condition_lines.empty()) {
+        Open("while (" + condition + ") {");
+    } else {
+        Open("while (true) {");
+        current_.lines.insert(current_.lines.end(), condition_lines.begin(), condition_lines.end());
+        Open("if (!(" + condition + ")) {");
+        Line("break;");
+        Close();
+    }
+
+    current_.env = EmitIteration(scope);
+    ++current_.loops;
+    EmitStatements(stmt.body);
+    --current_.loops;
+    current_.env = outer;
+
+    Close();
+    Close();
+}
+
+
+void CppEmitter::EmitStatementImpl(const ForStatement& stmt) {
+    std::string outer = current_.env;
+    Open("{");
+    std::string iterable = EmitExpression(stmt.iter);
+    std::string sequence = Temporary("q");
+    Line("LoopSequence " + sequence + "(" + iterable + ");");
+    std::string scope = EmitLoopScope(stmt.body_scope);
+
+    std::string index = Temporary("i");
+    Open("for (std::size_t " + index + " = 0; " + index + " < " + sequence + ".Size(); ++" + index + ") {");
+    current_.env = EmitIteration(scope);
+    Line(current_.env + ".SetLocal(0, " + sequence + ".At(" + index + "));");
+
+    ++current_.loops;
+    EmitStatements(stmt.body);
+    --current_.loops;
+    current_.env = outer;
+
+    Close();
+    Close();
+}
+
+
+void CppEmitter::EmitStatementImpl(const ReturnStatement& stmt) {
+    std::string value = stmt.value ? EmitExpression(*stmt.value) : "Value(NilType{})";
+    if (current_.top_level) {
+        Unexpected();
+        return;
+    }
+    Line("return " + value + ";");
+}
+
+
+void CppEmitter::EmitStatementImpl(const BlockStatement& stmt) {
+    Open("{");
+    EmitScope(stmt.statements, stmt.scope);
+    Close();
+}
+
+
+void CppEmitter::EmitStatementImpl(const BreakStatement&) {
+    if (current_.loops == 0) {
+        Unexpected();
+        return;
+    }
+    Line("break;");
+}
+
+
+void CppEmitter::EmitStatementImpl(const ContinueStatement&) {
+    if (current_.loops == 0) {
+        Unexpected();
+        return;
+    }
+    Line("continue;");
+}
+
+
+// The LoopScope the iterations of a body with `layout` take their
+// environments from, in the current environment.
+std::string CppEmitter::EmitLoopScope(const ScopeLayout& layout) {
+    std::string scope = Temporary("l");
+    Line("LoopScope " + scope + "(&" + current_.env + ", ScopeLayout{"
+         + (layout.elided ? "true" : "false") + ", " + (layout.captured ? "true" : "false") + ", "
+         + std::to_string(layout.slots) + "});");
+    return scope;
+}
+
+
+// The environment of the iteration starting here.
+std::string CppEmitter::EmitIteration(const std::string& scope) {
+    std::string env = Temporary("s");
+    Line("Enviroment& " + env + " = *" + scope + ".Next();");
+    return env;
+}
+
+
+std::string CppEmitter::EmitExpression(const Expression& expr) {
+    return std::visit([this](const auto& node) {
+        return EmitExpressionImpl(node);
+    }, expr.value);
+}
+
+
+// Comparisons are decided without building a Value for their result, and
+// `and`/`or` only combine the tests of their operands.
+std::string CppEmitter::EmitCondition(const Expression& condition) {
+    if (const auto* fused = std::get_if<FusedExpression>(&condition.value)) {
+        return EmitCondition(*fused->original);
+    }
+
+    const auto* expr = std::get_if<BinaryExpression>(&condition.value);
+    if (expr && (expr->operation == TokenType::and_ || expr->operation == TokenType::or_)) {
+        bool conjunction = expr->operation == TokenType::and_;
+        std::string lhs = EmitCondition(*expr->lhs);
+        std::string test = Temporary("c");
+        Line("bool " + test + " = " + lhs + ";");
+        Open(conjunction ? "if (" + test + ") {" : "if (!" + test + ") {");
+        std::string rhs = EmitCondition(*expr->rhs);
+        Line(test + " = " + rhs + ";");
+        Close();
+        return test;
+    }
+
+    if (expr) {
+        auto op = OperationRegistry::ToBinary(expr->operation);
+        bool comparison = op && *op >= BinaryOp::Lt;
+        bool equality = expr->operation == TokenType::double_eq_ || expr->operation == TokenType::not_eq_;
+        if (comparison || equality) {
+            std::string lhs = EmitExpression(*expr->lhs);
+            std::string rhs = EmitExpression(*expr->rhs);
+            if (comparison) {
+                return "AotRuntime::Test(" + BinaryOpName(*op) + ", " + lhs + ", " + rhs + ")";
+            }
+            std::string negation = expr->operation == TokenType::not_eq_ ? "!" : "";
+            return negation + "Interpreter::IsEqual(" + lhs + ", " + rhs + ")";
+        }
+    }
+
+    std::string value = EmitExpression(condition);
+    return "Interpreter::IsTrue(" + value + ")";
+}
+
+
+std::string CppEmitter::EmitExpressionImpl(const NumberExpression& expr) {
+    return "Value(" + NumberLiteral(expr.value) + ")";
+}
+
+
+std::string CppEmitter::EmitExpressionImpl(const StringExpression& expr) {
+    std::string name = "kString" + std::to_string(constants_.size());
+    constants_.push_back("const Value " + name + "(std::string(" + Quote(expr.value) + ", "
+                        + std::to_string(expr.value.size()) + "));");
+    return name;
+}
+
+
+std::string CppEmitter::EmitExpressionImpl(const BoolExpression& expr) {
+    return expr.value ? "Value(true)" : "Value(false)";
+}
+
+
+std::string CppEmitter::EmitExpressionImpl(const NilExpression&) {
+    return "Value(NilType{})";
+}
+
+
+std::string CppEmitter::EmitExpressionImpl(const VariableExpression& expr) {
+    std::string value = Temporary();
+    if (expr.address.kind != LexicalAddress::Kind::Global) {
+        Line("Value " + value + " = " + current_.env + ".Get(" + LocalAddress(expr.address) + ", "
+            + Quote(expr.name) + ");");
+    } else {
+        Line("Value " + value + " = globals.Get(" + std::to_string(expr.address.slot) + ");");
+    }
+    return value;
+}
+
+
+std::string CppEmitter::EmitExpressionImpl(const UnaryExpression& expr) {
+    std::string operand = EmitExpression(*expr.rhs);
+    auto op = OperationRegistry::ToUnary(expr.operation);
+    if (!op) {
+        Line("throw EvaluatorErrors(EvaluatorErrors::kBadOperandsForBinaryOperation);");
+        return "Value(NilType{})";
+    }
+
+    std::string value = Temporary();
+    Line("Value " + value + " = OperationRegistry::Unary(" + UnaryOpName(*op) + ", " + operand + ");");
+    return value;
+}
+
+
+std::string CppEmitter::EmitExpressionImpl(const BinaryExpression& expr) {
+    if (expr.operation == TokenType::and_ || expr.operation == TokenType::or_) {
+        std::string lhs = EmitExpression(*expr.lhs);
+        std::string value = Temporary();
+        Line("Value " + value + " = " + lhs + ";");
+        std::string negation = expr.operation == TokenType::or_ ? "!" : "";
+        Open("if (" + negation + "Interpreter::IsTrue(" + value + ")) {");
+        std::string rhs = EmitExpression(*expr.rhs);
+        Line(value + " = " + rhs + ";");
+        Close();
+        return value;
+    }
+
+    std::string lhs = EmitExpression(*expr.lhs);
+    std::string rhs = EmitExpression(*expr.rhs);
+    std::string value = Temporary();
+
+    if (expr.operation == TokenType::double_eq_ || expr.operation == TokenType::not_eq_) {
+        std::string negation = expr.operation == TokenType::not_eq_ ? "!" : "";
+        Line("Value " + value + "(" + negation + "Interpreter::IsEqual(" + lhs + ", " + rhs + "));");
+        return value;
+    }
+
+    auto op = OperationRegistry::ToBinary(expr.operation);
+    if (!op) {
+        Line("throw EvaluatorErrors(EvaluatorErrors::kBadOperandsForBinaryOperation);");
+        return "Value(NilType{})";
+    }
+    Line("Value " + value + " = OperationRegistry::Binary(" + BinaryOpName(*op) + ", " + lhs + ", " + rhs + ");");
+    return value;
+}
+
+
+std::string CppEmitter::EmitExpressionImpl(const CallableExpression& expr) {
+    std::string callable = EmitExpression(*expr.callable);
+    std::string function = Temporary("f");
+    Line("const FunctionalObject& " + function + " = AotRuntime::Callee(" + callable + ");");
+
+    std::vector<std::string> arguments;
+    arguments.reserve(expr.f_arguments.size());
+    for (const auto& arg : expr.f_arguments) {
+        arguments.push_back(EmitExpression(*arg));
+    }
+
+    std::string passed = "{}";
+    if (!arguments.empty()) {
+        passed = Temporary("a");
+        Line("const Value " + passed + "[] = {" + Join(arguments, ", ") + "};");
+    }
+
+    std::string value = Temporary();
+    Line("Value " + value + " = " + function + ".native(" + passed + ");");
+    return value;
+}
+
+
+std::string CppEmitter::EmitExpressionImpl(const ListExpression& expr) {
+    std::vector<std::string> elements;
+    elements.reserve(expr.elements.size());
+    for (const auto& element : expr.elements) {
+        elements.push_back(EmitExpression(*element));
+    }
+
+    std::string value = Temporary();
+    Line("Value " + value + "(Value::Array{" + Join(elements, ", ") + "});");
+    return value;
+}
+
+
+// The body becomes a C++ function of its own; the expression only creates
+// a function value holding the cells it captures.
+std::string CppEmitter::EmitExpressionImpl(const FunctionExpression& expr) {
+    std::string name = "Function" + std::to_string(declarations_.size());
+    std::string signature = "Value " + name + "(const AotRuntime::Upvalues& upvalues, FunctionalObject::Arguments args)";
+    declarations_.push_back("Value " + name + "(const AotRuntime::Upvalues&, FunctionalObject::Arguments);");
+
+    std::string captures = "{}";
+    if (!expr.captures.empty()) {
+        std::vector<std::string> addresses;
+        for (const auto& address : expr.captures) {
+            addresses.push_back(LocalAddress(address));
+        }
+        captures = "kCaptures" + std::to_string(declarations_.size() - 1);
+        constants_.push_back("constexpr LexicalAddress " + captures + "[] = {" + Join(addresses, ", ") + "};");
+    }
+
+    Function outer = std::exchange(current_, Function{});
+    current_.env = "local";
+    Line("Enviroment local(upvalues);");
+    Line("AotRuntime::BindArguments(local, args, " + std::to_string(expr.parameters.size()) + ");");
+    EmitStatements(expr.f_body);
+    Line("return Value(NilType{});");
+
+    std::string definition = "// function(" + Join(expr.parameters, ", ") + ")\n" + signature + " {\n";
+    for (const auto& line : current_.lines) {
+        definition += line + "\n";
+    }
+    definition += "}\n";
+    definitions_.push_back(std::move(definition));
+    current_ = std::move(outer);
+
+    std::string value = Temporary();
+    Line("Value " + value + " = AotRuntime::MakeFunction(" + name + ", " + current_.env + ".Capture(" + captures + "));");
+    return value;
+}
+
+
+std::string CppEmitter::EmitExpressionImpl(const AssignExpression& expr) {
+    if (expr.operation != TokenType::assign_) {
+        return EmitCompoundAssign(expr);
+    }
+
+    std::string value = EmitExpression(*expr.rhs);
+    if (expr.address.kind != LexicalAddress::Kind::Global) {
+        Line(current_.env + ".Set(" + LocalAddress(expr.address) + ", " + value + ");");
+    } else {
+        Line("globals.Set(" + std::to_string(expr.address.slot) + ", " + value + ");");
+    }
+    return value;
+}
+
+
+// The right operand is evaluated before the variable is looked up, as in
+// the tree-walker.
+std::string CppEmitter::EmitCompoundAssign(const AssignExpression& expr) {
+    std::string rhs = EmitExpression(*expr.rhs);
+    std::string target = Temporary("r");
+    Line("Value& " + target + " = " + Reference(expr.address, expr.name) + ";");
+
+    if (expr.operation == TokenType::plus_eq_) {
+        Line("AddInPlace(" + target + ", " + rhs + ");");
+    } else if (auto op = OperationRegistry::ToBinary(CompoundBaseOperation(expr.operation))) {
+        Line(target + " = OperationRegistry::Binary(" + BinaryOpName(*op) + ", " + target + ", " + rhs + ");");
+    } else {
+        Line("throw EvaluatorErrors(EvaluatorErrors::kBadOperandsForBinaryOperation);");
+    }
+
+    std::string value = Temporary();
+    Line("Value " + value + " = " + target + ";");
+    return value;
+}
+
+
+std::string CppEmitter::Reference(const LexicalAddress& address, const std::string& name) {
+    if (address.kind != LexicalAddress::Kind::Global) {
+        return current_.env + ".Get(" + LocalAddress(address) + ", " + Quote(name) + ")";
+    }
+    return "globals.Get(" + std::to_string(address.slot) + ")";
+}
+
+
+std::string CppEmitter::EmitExpressionImpl(const IndexExpression& expr) {
+    std::string object = EmitExpression(*expr.object);
+    std::string index = EmitExpression(*expr.index);
+    std::string value = Temporary();
+    Line("Value " + value + " = Index(" + object + ", " + index + ");");
+    return value;
+}
+
+
+std::string CppEmitter::EmitExpressionImpl(const SliceExpression& expr) {
+    std::string object = EmitExpression(*expr.object);
+
+    auto bound = [this](const std::unique_ptr<Expression>& limit) -> std::string {
+        if (!limit) {
+            return "nullptr";
+        }
+        std::string value = EmitExpression(*limit);
+        std::string name = Temporary("b");
+        Line("const Value& " + name + " = " + value + ";");
+        return "&" + name;
+    };
+    std::string from = bound(expr.from_s);
+    std::string to = bound(expr.to_s);
+
+    std::string value = Temporary();
+    Line("Value " + value + " = Slice(" + object + ", " + from + ", " + to + ");");
+    return value;
+}
+
+
+std::string CppEmitter::EmitExpressionImpl(const IndexAssignExpression& expr) {
+    std::string object = EmitExpression(*expr.object);
+    std::string index = EmitExpression(*expr.index);
+
+    if (expr.operation == TokenType::assign_) {
+        std::string rhs = EmitExpression(*expr.rhs);
+        std::string value = Temporary();
+        Line("Value " + value + " = SetIndex(" + object + ", " + index + ", " + rhs + ");");
+        return value;
+    }
+
+    std::string current = Temporary();
+    Line("Value " + current + " = Index(" + object + ", " + index + ");");
+    std::string rhs = EmitExpression(*expr.rhs);
+    std::string value = Temporary();
+    if (auto op = OperationRegistry::ToBinary(CompoundBaseOperation(expr.operation))) {
+        Line("Value " + value + " = SetIndex(" + object + ", " + index + ", OperationRegistry::Binary("
+            + BinaryOpName(*op) + ", " + current + ", " + rhs + "));");
+    } else {
+        Line("throw EvaluatorErrors(EvaluatorErrors::kBadOperandsForBinaryOperation);");
+        return "Value(NilType{})";
+    }
+    return value;
+}
+
+
+// Fused nodes exist for the tree-walker; compiled code runs the subtree
+// they replaced.
+std::string CppEmitter::EmitExpressionImpl(const FusedExpression& expr) {
+    return EmitExpression(*expr.original);
+}
+
+
+void CppEmitter::Line(const std::string& text) {
+    current_.lines.push_back(std::string(4 * current_.depth, ' ') + text);
+}
+
+
+void CppEmitter::Open(const std::string& text) {
+    Line(text);
+    ++current_.depth;
+}
+
+
+void CppEmitter::Close(const std::string& text) {
+    --current_.depth;
+    Line(text);
+}
+
+
+std::string CppEmitter::Temporary(const char* prefix) {
+    return prefix + std::to_string(current_.temporaries++);
+}
+
+
+// break, continue or return where the tree-walker would reject the
+// completion at run time.
+void CppEmitter::Unexpected() {
+    Line("throw InterpreterError(InterpreterError::kUnexpectedCompletion);");
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <vls_and_sttmnts.h>
+#include <runtime/enviroment/global_table.h>
+
+
+// Lowers a semantically checked program to one C++ translation unit built
+// on AotRuntime. Every node becomes the C++ the closure compiler would run
+// for it: expressions are evaluated left to right into temporaries, scopes
+// become Enviroment objects on the C++ stack, loops and branches become
+// C++ loops and branches, and every function literal becomes a C++
+// function. The program itself becomes Main.
+class CppEmitter {
+public:
+    explicit CppEmitter(const GlobalTable&);
+
+    std::string Emit(const std::vector<Statement>&);
+
+private:
+    // The C++ function being written.
+    struct Function {
+        std::vector<std::string> lines;
+        int depth = 1;
+        std::size_t temporaries = 0;
+        std::size_t loops = 0;
+        std::string env;
+        bool top_level = false;
+    };
+
+private:
+    void EmitStatement(const Statement&);
+    void EmitStatements(const std::vector<Statement>&);
+    void EmitScope(const std::vector<Statement>&, const ScopeLayout&);
+
+    void EmitStatementImpl(const ExpressionStatement&);
+    void EmitStatementImpl(const IfStatement&);
+    void EmitStatementImpl(const WhileStatement&);
+    void EmitStatementImpl(const ForStatement&);
+    void EmitStatementImpl(const ReturnStatement&);
+    void EmitStatementImpl(const BlockStatement&);
+    void EmitStatementImpl(const BreakStatement&);
+    void EmitStatementImpl(const ContinueStatement&);
+
+    std::string EmitLoopScope(const ScopeLayout&);
+    std::string EmitIteration(const std::string& scope);
+
+private:
+    // Each returns a C++ expression for the result that may be used once,
+    // after the lines emitted for it.
+    std::string EmitExpression(const Expression&);
+    std::string EmitCondition(const Expression&);
+
+    std::string EmitExpressionImpl(const NumberExpression&);
+    std::string EmitExpressionImpl(const StringExpression&);
+    std::string EmitExpressionImpl(const BoolExpression&);
+    std::string EmitExpressionImpl(const NilExpression&);
+    std::string EmitExpressionImpl(const VariableExpression&);
+    std::string EmitExpressionImpl(const UnaryExpression&);
+    std::string EmitExpressionImpl(const BinaryExpression&);
+    std::string EmitExpressionImpl(const CallableExpression&);
+    std::string EmitExpressionImpl(const ListExpression&);
+    std::string EmitExpressionImpl(const FunctionExpression&);
+    std::string EmitExpressionImpl(const AssignExpression&);
+    std::string EmitExpressionImpl(const IndexExpression&);
+    std::string EmitExpressionImpl(const SliceExpression&);
+    std::string EmitExpressionImpl(const IndexAssignExpression&);
+    std::string EmitExpressionImpl(const FusedExpression&);
+
+    std::string EmitCompoundAssign(const AssignExpression&);
+    std::string Reference(const LexicalAddress&, const std::string& name);
+
+private:
+    void Line(const std::string&);
+    void Open(const std::string&);
+    void Close(const std::string& = "}");
+    std::string Temporary(const char* prefix = "v");
+    void Unexpected();
+
+private:
+    const GlobalTable& globals_;
+    Function current_;
+    std::vector<std::string> constants_;
+    std::vector<std::string> declarations_;
+    std::vector<std::string> definitions_;
+};
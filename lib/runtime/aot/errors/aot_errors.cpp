@@ -0,0 +1,6 @@
+#include <runtime/aot/errors/aot_errors.h>
+
+
+AotError::AotError(const std::string& message)
+    : std::runtime_error(message)
+{}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdexcept>
+
+
+class AotError : public std::runtime_error {
+public:
+    static constexpr const char* kGlobalsMismatch = "compiled program does not match the builtins it is linked with";
+    static constexpr const char* kCannotWriteSource = "unable to write the generated C++ file: ";
+    static constexpr const char* kCompilerFailed = "C++ compiler failed on ";
+
+public:
+    AotError(const std::string&);
+};
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <memory>
+
+#include <runtime/aot/support/support.h>
+#include <runtime/aot/errors/aot_errors.h>
+#include <runtime/interpreter/builtins/builtins.h>
+#include <runtime/interpreter/call_stack/call_stack.h>
+
+
+namespace {
+
+// The calls in progress of the program Run executes. A process runs only
+// one compiled program.
+CallDepth* calls = nullptr;
+
+} // namespace
+
+
+int AotRuntime::Run(GlobalTable& globals, const std::vector<std::string>& names, Main main) {
+    try {
+        RunOnCallStack(kDefaultMaxCallDepth, [&](const char* stack_limit, std::size_t fits) {
+            BuiltinRegistry::Get().RegisterAll(globals, std::cout, std::cin);
+            for (std::size_t i = 0; i < names.size(); ++i) {
+                if (globals.Bind(names[i]) != i) {
+                    throw AotError(AotError::kGlobalsMismatch);
+                }
+            }
+
+            CallDepth depth(fits, stack_limit);
+            calls = &depth;
+            Enviroment top_level;
+            main(top_level);
+        });
+    } catch (const std::exception& e) {
+        std::cerr << "Interpreter error: " << e.what() << "\n";
+        std::cerr << "Error: Script execution failed" << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << InterpreterError::kUnknownError;
+        std::cerr << "Error: Script execution failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::endl;
+    return 0;
+}
+
+
+Value AotRuntime::MakeFunction(Body body, Upvalues upvalues) {
+    return Value(std::make_shared<FunctionalObject>(
+        [body, upvalues = std::move(upvalues)](FunctionalObject::Arguments args) {
+            CallDepth::Scope call(*calls);
+            return body(upvalues, args);
+        }
+    ));
+}
+
+
+void AotRuntime::BindArguments(Enviroment& local, FunctionalObject::Arguments args, std::size_t arity) {
+    for (std::size_t i = 0; i < arity; ++i) {
+        local.SetLocal(i, i < args.size() ? args[i] : Value(NilType{}));
+    }
+}
+
+
+const FunctionalObject& AotRuntime::Callee(const Value& function) {
+    if (!function.IsFunction() || !function.AsFunction()->native) {
+        throw EvaluatorErrors(EvaluatorErrors::kCallOfNonFunction);
+    }
+    return *function.AsFunction();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <runtime/value/value.h>
+#include <runtime/function/function.h>
+#include <runtime/enviroment/enviroment.h>
+#include <runtime/enviroment/global_table.h>
+#include <runtime/evaluator/errors/ev_errors.h>
+#include <runtime/evaluator/operations/handlers.h>
+#include <runtime/evaluator/operations/register.h>
+#include <runtime/interpreter/interpreter.h>
+#include <runtime/interpreter/errors/intrptr_errors.h>
+#include <runtime/interpreter/statements/loop.h>
+
+
+// What the C++ emitted by AotCompiler calls into. Everything else it uses
+// directly: Value, Enviroment, GlobalTable, the loop helpers and the
+// operator handlers, so a compiled program behaves exactly like the
+// interpreters.
+class AotRuntime {
+public:
+    using Upvalues = std::vector<Enviroment::Cell>;
+    using Body = Value (*)(const Upvalues&, FunctionalObject::Arguments);
+    using Main = void (*)(Enviroment&);
+
+    // Registers the builtins, binds `names` to the slots the program was
+    // compiled for and runs `main`, reporting errors and the exit status as
+    // itmoscript_interpreter does. Script calls nest up to
+    // kDefaultMaxCallDepth deep, on a stack sized for it.
+    static int Run(GlobalTable&, const std::vector<std::string>& names, Main);
+
+    static constexpr LexicalAddress Local(std::uint32_t depth, std::uint32_t slot) {
+        return {LexicalAddress::Kind::Local, depth, slot};
+    }
+
+    static constexpr LexicalAddress Cell(std::uint32_t depth, std::uint32_t slot) {
+        return {LexicalAddress::Kind::Cell, depth, slot};
+    }
+
+    static constexpr LexicalAddress Upvalue(std::uint32_t slot) {
+        return {LexicalAddress::Kind::Upvalue, 0, slot};
+    }
+
+    // A function value whose calls run `body` with the cells it captured.
+    static Value MakeFunction(Body, Upvalues);
+
+    static void BindArguments(Enviroment&, FunctionalObject::Arguments, std::size_t arity);
+
+    static const FunctionalObject& Callee(const Value&);
+
+    // A comparison in a condition, without building a Value for its result.
+    static bool Test(BinaryOp, const Value&, const Value&);
+};
+
+
+inline bool AotRuntime::Test(BinaryOp op, const Value& left, const Value& right) {
+    if (left.IsNumber() && right.IsNumber()) {
+        double x = left.AsNumber();
+        double y = right.AsNumber();
+        switch (op) {
+            case BinaryOp::Lt: return x < y;
+            case BinaryOp::Le: return x <= y;
+            case BinaryOp::Gt: return x > y;
+            default: return x >= y;
+        }
+    }
+    return Interpreter::IsTrue(OperationRegistry::Binary(op, left, right));
+}
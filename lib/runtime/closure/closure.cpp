@@ -0,0 +1,49 @@
+#include <semantic.h>
+#include <syntax.h>
+#include <runtime/closure/closure.h>
+#include <runtime/interpreter/interpreter.h>
+#include <runtime/interpreter/errors/intrptr_errors.h>
+#include <runtime/interpreter/builtins/builtins.h>
+
+
+bool ClosureEngine::Interpret(std::istream& in, std::ostream& out, std::size_t max_depth) {
+    try {
+        bool success = false;
+        RunOnCallStack(max_depth, [&](const char* stack_limit, std::size_t fits) {
+            SyntaxAnalizer parser(in);
+            auto program = parser.Parse();
+
+            ClosureEngine engine(out);
+            SemanticAnalizer sem(out, engine.globals_.Names());
+            if (!sem.Analyse(program)) { return; }
+            for (const auto& name : sem.GlobalNames()) {
+                engine.globals_.Bind(name);
+            }
+
+            CallDepth calls(fits, stack_limit);
+            StatementClosure main = ClosureCompiler(engine.globals_, calls).Compile(program);
+
+            Completion completion = main(&engine.top_level_);
+            if (!completion.IsNormal()) {
+                throw InterpreterError(InterpreterError::kUnexpectedCompletion);
+            }
+            success = true;
+        });
+        return success;
+    } catch (const std::exception& e) {
+        std::cerr << "Interpreter error: " << e.what() << "\n";
+        return false;
+    } catch (...) {
+        std::cerr << InterpreterError::kUnknownError;
+        return false;
+    }
+}
+
+
+ClosureEngine::ClosureEngine(std::ostream& out)
+    : output_(out)
+    , globals_()
+    , top_level_()
+{
+    BuiltinRegistry::Get().RegisterAll(globals_, output_, std::cin);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <iostream>
+
+#include <runtime/value/value.h>
+#include <runtime/enviroment/enviroment.h>
+#include <runtime/enviroment/global_table.h>
+#include <runtime/closure/compiler/compiler.h>
+#include <runtime/interpreter/call_stack/call_stack.h>
+
+
+// Alternative to the tree-walking Interpreter that runs the program as the
+// tree of closures ClosureCompiler builds from it. It shares values,
+// environments, builtins and error reporting with the tree-walker, so both
+// behave the same on every program, including the stack overflow error once
+// more than `max_depth` script calls are nested.
+class ClosureEngine {
+public:
+    static bool Interpret(std::istream&, std::ostream&, std::size_t max_depth = kDefaultMaxCallDepth);
+
+private:
+    ClosureEngine(std::ostream&);
+
+private:
+    std::ostream& output_;
+    GlobalTable globals_;
+    Enviroment top_level_;
+};
@@ -0,0 +1,573 @@
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+#include <runtime/closure/compiler/compiler.h>
+#include <runtime/evaluator/errors/ev_errors.h>
+#include <runtime/evaluator/operations/handlers.h>
+#include <runtime/evaluator/operations/register.h>
+#include <runtime/function/function.h>
+#include <runtime/interpreter/interpreter.h>
+#include <runtime/interpreter/errors/intrptr_errors.h>
+#include <runtime/interpreter/statements/loop.h>
+
+
+namespace {
+
+using BinaryFn = Value (*)(const Value&, const Value&);
+using TestFn = bool (*)(const Value&, const Value&);
+
+
+template<BinaryOp Op>
+Value ApplyBinary(const Value& left, const Value& right) {
+    return OperationRegistry::Binary(Op, left, right);
+}
+
+
+Value ApplyEqual(const Value& left, const Value& right) {
+    return Value(Interpreter::IsEqual(left, right));
+}
+
+
+Value ApplyNotEqual(const Value& left, const Value& right) {
+    return Value(!Interpreter::IsEqual(left, right));
+}
+
+
+Value ApplyUnsupported(const Value&, const Value&) {
+    throw EvaluatorErrors(EvaluatorErrors::kBadOperandsForBinaryOperation);
+}
+
+
+template<BinaryOp Op>
+bool TestBinary(const Value& left, const Value& right) {
+    if (left.IsNumber() && right.IsNumber()) {
+        double x = left.AsNumber();
+        double y = right.AsNumber();
+        if constexpr (Op == BinaryOp::Lt) {
+            return x < y;
+        } else if constexpr (Op == BinaryOp::Le) {
+            return x <= y;
+        } else if constexpr (Op == BinaryOp::Gt) {
+            return x > y;
+        } else {
+            return x >= y;
+        }
+    }
+    return Interpreter::IsTrue(OperationRegistry::Binary(Op, left, right));
+}
+
+
+bool TestEqual(const Value& left, const Value& right) {
+    return Interpreter::IsEqual(left, right);
+}
+
+
+bool TestNotEqual(const Value& left, const Value& right) {
+    return !Interpreter::IsEqual(left, right);
+}
+
+
+BinaryFn SelectBinary(TokenType op) {
+    switch (op) {
+        case TokenType::plus_: return ApplyBinary<BinaryOp::Add>;
+        case TokenType::minus_: return ApplyBinary<BinaryOp::Sub>;
+        case TokenType::star_: return ApplyBinary<BinaryOp::Mul>;
+        case TokenType::slash_: return ApplyBinary<BinaryOp::Div>;
+        case TokenType::percent_: return ApplyBinary<BinaryOp::Mod>;
+        case TokenType::degree_: return ApplyBinary<BinaryOp::Pow>;
+        case TokenType::less_: return ApplyBinary<BinaryOp::Lt>;
+        case TokenType::less_eq_: return ApplyBinary<BinaryOp::Le>;
+        case TokenType::greater_: return ApplyBinary<BinaryOp::Gt>;
+        case TokenType::greater_eq_: return ApplyBinary<BinaryOp::Ge>;
+        case TokenType::double_eq_: return ApplyEqual;
+        case TokenType::not_eq_: return ApplyNotEqual;
+        default: return ApplyUnsupported;
+    }
+}
+
+
+TestFn SelectTest(TokenType op) {
+    switch (op) {
+        case TokenType::less_: return TestBinary<BinaryOp::Lt>;
+        case TokenType::less_eq_: return TestBinary<BinaryOp::Le>;
+        case TokenType::greater_: return TestBinary<BinaryOp::Gt>;
+        case TokenType::greater_eq_: return TestBinary<BinaryOp::Ge>;
+        case TokenType::double_eq_: return TestEqual;
+        case TokenType::not_eq_: return TestNotEqual;
+        default: return nullptr;
+    }
+}
+
+
+// `target` yields the variable a compound assignment updates; the right
+// operand is evaluated before it is looked up, as in the tree-walker.
+template<typename Target>
+ValueClosure CompoundAssign(TokenType op, ValueClosure value, Target target) {
+    if (op == TokenType::plus_eq_) {
+        return [value = std::move(value), target](Enviroment* env) {
+            Value rhs = value(env);
+            Value& slot = target(env);
+            AddInPlace(slot, rhs);
+            return slot;
+        };
+    }
+
+    BinaryFn apply = SelectBinary(CompoundBaseOperation(op));
+    return [value = std::move(value), target, apply](Enviroment* env) {
+        Value rhs = value(env);
+        Value& slot = target(env);
+        slot = apply(slot, rhs);
+        return slot;
+    };
+}
+
+} // namespace
+
+
+ClosureCompiler::ClosureCompiler(GlobalTable& globals, CallDepth& calls)
+    : globals_(globals)
+    , calls_(calls)
+{}
+
+
+StatementClosure ClosureCompiler::Compile(const std::vector<Statement>& program) {
+    return CompileStatements(program);
+}
+
+
+StatementClosure ClosureCompiler::CompileStatement(const Statement& stmt) {
+    return std::visit([this](const auto& node) {
+        return CompileStatementImpl(node);
+    }, stmt.value);
+}
+
+
+StatementClosure ClosureCompiler::CompileStatements(const std::vector<Statement>& stmts) {
+    std::vector<StatementClosure> compiled;
+    compiled.reserve(stmts.size());
+    for (const auto& stmt : stmts) {
+        compiled.push_back(CompileStatement(stmt));
+    }
+
+    if (compiled.size() == 1) {
+        return std::move(compiled.front());
+    }
+    return [statements = std::move(compiled)](Enviroment* env) {
+        for (const auto& statement : statements) {
+            Completion completion = statement(env);
+            if (!completion.IsNormal()) {
+                return completion;
+            }
+        }
+        return Completion::Normal();
+    };
+}
+
+
+StatementClosure ClosureCompiler::CompileScope(const std::vector<Statement>& stmts
+                                            , const ScopeLayout& layout)
+{
+    StatementClosure body = CompileStatements(stmts);
+    if (layout.elided) {
+        return body;
+    }
+    return [body = std::move(body), slots = layout.slots](Enviroment* env) {
+        Enviroment block(env, slots);
+        return body(&block);
+    };
+}
+
+
+StatementClosure ClosureCompiler::CompileStatementImpl(const ExpressionStatement& stmt) {
+    return [value = CompileExpression(stmt.expression)](Enviroment* env) {
+        value(env);
+        return Completion::Normal();
+    };
+}
+
+
+StatementClosure ClosureCompiler::CompileStatementImpl(const IfStatement& stmt) {
+    TestClosure condition = CompileCondition(stmt.condition);
+    StatementClosure then_case = CompileScope(stmt.then_case, stmt.then_scope);
+
+    if (stmt.else_case.empty()) {
+        return [condition = std::move(condition), then_case = std::move(then_case)](Enviroment* env) {
+            return condition(env) ? then_case(env) : Completion::Normal();
+        };
+    }
+
+    StatementClosure else_case = CompileScope(stmt.else_case, stmt.else_scope);
+    return [condition = std::move(condition), then_case = std::move(then_case)
+            , else_case = std::move(else_case)](Enviroment* env)
+    {
+        return condition(env) ? then_case(env) : else_case(env);
+    };
+}
+
+
+StatementClosure ClosureCompiler::CompileStatementImpl(const WhileStatement& stmt) {
+    return [condition = CompileCondition(stmt.condition), body = CompileStatements(stmt.body)
+            , layout = stmt.body_scope](Enviroment* env)
+    {
+        LoopScope scope(env, layout);
+        while (condition(env)) {
+            Completion completion = body(scope.Next());
+            if (completion.kind == Completion::Kind::Break) {
+                break;
+            }
+            if (completion.kind == Completion::Kind::Return) {
+                return completion;
+            }
+        }
+        return Completion::Normal();
+    };
+}
+
+
+StatementClosure ClosureCompiler::CompileStatementImpl(const ForStatement& stmt) {
+    return [iter = CompileExpression(stmt.iter), body = CompileStatements(stmt.body)
+            , layout = stmt.body_scope](Enviroment* env)
+    {
+        LoopSequence sequence(iter(env));
+        LoopScope scope(env, layout);
+        for (std::size_t i = 0; i < sequence.Size(); ++i) {
+            Enviroment* loop_env = scope.Next();
+            loop_env->SetLocal(0, sequence.At(i));
+
+            Completion completion = body(loop_env);
+            if (completion.kind == Completion::Kind::Break) {
+                break;
+            }
+            if (completion.kind == Completion::Kind::Return) {
+                return completion;
+            }
+        }
+        return Completion::Normal();
+    };
+}
+
+
+StatementClosure ClosureCompiler::CompileStatementImpl(const ReturnStatement& stmt) {
+    if (!stmt.value) {
+        return [](Enviroment*) {
+            return Completion::Return(Value(NilType{}));
+        };
+    }
+    return [value = CompileExpression(*stmt.value)](Enviroment* env) {
+        return Completion::Return(value(env));
+    };
+}
+
+
+StatementClosure ClosureCompiler::CompileStatementImpl(const BlockStatement& stmt) {
+    return CompileScope(stmt.statements, stmt.scope);
+}
+
+
+StatementClosure ClosureCompiler::CompileStatementImpl(const BreakStatement&) {
+    return [](Enviroment*) {
+        return Completion::Break();
+    };
+}
+
+
+StatementClosure ClosureCompiler::CompileStatementImpl(const ContinueStatement&) {
+    return [](Enviroment*) {
+        return Completion::Continue();
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileExpression(const Expression& expr) {
+    return std::visit([this](const auto& node) {
+        return CompileExpressionImpl(node);
+    }, expr.value);
+}
+
+
+// Comparisons in conditions are decided without building a Value for
+// their result, and `and`/`or` only combine the tests of their operands.
+TestClosure ClosureCompiler::CompileCondition(const Expression& condition) {
+    if (const auto* fused = std::get_if<FusedExpression>(&condition.value)) {
+        return CompileCondition(*fused->original);
+    }
+
+    const auto* expr = std::get_if<BinaryExpression>(&condition.value);
+    if (expr && expr->operation == TokenType::and_) {
+        return [lhs = CompileCondition(*expr->lhs), rhs = CompileCondition(*expr->rhs)](Enviroment* env) {
+            return lhs(env) && rhs(env);
+        };
+    }
+    if (expr && expr->operation == TokenType::or_) {
+        return [lhs = CompileCondition(*expr->lhs), rhs = CompileCondition(*expr->rhs)](Enviroment* env) {
+            return lhs(env) || rhs(env);
+        };
+    }
+
+    if (TestFn test = expr ? SelectTest(expr->operation) : nullptr) {
+        return [lhs = CompileExpression(*expr->lhs), rhs = CompileExpression(*expr->rhs), test](Enviroment* env) {
+            Value left = lhs(env);
+            Value right = rhs(env);
+            return test(left, right);
+        };
+    }
+
+    return [value = CompileExpression(condition)](Enviroment* env) {
+        return Interpreter::IsTrue(value(env));
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileExpressionImpl(const NumberExpression& expr) {
+    return [value = Value(expr.value)](Enviroment*) {
+        return value;
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileExpressionImpl(const StringExpression& expr) {
+    return [value = Value(expr.value)](Enviroment*) {
+        return value;
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileExpressionImpl(const BoolExpression& expr) {
+    return [value = Value(expr.value)](Enviroment*) {
+        return value;
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileExpressionImpl(const NilExpression&) {
+    return [](Enviroment*) {
+        return Value(NilType{});
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileExpressionImpl(const VariableExpression& expr) {
+    if (expr.address.kind != LexicalAddress::Kind::Global) {
+        return [address = expr.address, name = expr.name](Enviroment* env) {
+            return env->Get(address, name);
+        };
+    }
+    return [&globals = globals_, slot = expr.address.slot](Enviroment*) {
+        return globals.Get(slot);
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileExpressionImpl(const UnaryExpression& expr) {
+    ValueClosure operand = CompileExpression(*expr.rhs);
+    auto op = OperationRegistry::ToUnary(expr.operation);
+    if (!op) {
+        return [operand = std::move(operand)](Enviroment* env) -> Value {
+            operand(env);
+            throw EvaluatorErrors(EvaluatorErrors::kBadOperandsForBinaryOperation);
+        };
+    }
+    return [operand = std::move(operand), op = *op](Enviroment* env) {
+        return OperationRegistry::Unary(op, operand(env));
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileExpressionImpl(const BinaryExpression& expr) {
+    ValueClosure lhs = CompileExpression(*expr.lhs);
+    ValueClosure rhs = CompileExpression(*expr.rhs);
+
+    if (expr.operation == TokenType::and_) {
+        return [lhs = std::move(lhs), rhs = std::move(rhs)](Enviroment* env) {
+            Value left = lhs(env);
+            return Interpreter::IsTrue(left) ? rhs(env) : left;
+        };
+    }
+    if (expr.operation == TokenType::or_) {
+        return [lhs = std::move(lhs), rhs = std::move(rhs)](Enviroment* env) {
+            Value left = lhs(env);
+            return Interpreter::IsTrue(left) ? left : rhs(env);
+        };
+    }
+
+    return [lhs = std::move(lhs), rhs = std::move(rhs), apply = SelectBinary(expr.operation)](Enviroment* env) {
+        Value left = lhs(env);
+        Value right = rhs(env);
+        return apply(left, right);
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileExpressionImpl(const CallableExpression& expr) {
+    std::vector<ValueClosure> arguments;
+    arguments.reserve(expr.f_arguments.size());
+    for (const auto& arg : expr.f_arguments) {
+        arguments.push_back(CompileExpression(*arg));
+    }
+
+    return [callable = CompileExpression(*expr.callable), arguments = std::move(arguments)](Enviroment* env) {
+        Value function = callable(env);
+        if (!function.IsFunction()) {
+            throw EvaluatorErrors(EvaluatorErrors::kCallOfNonFunction);
+        }
+
+        std::vector<Value> values;
+        values.reserve(arguments.size());
+        for (const auto& argument : arguments) {
+            values.push_back(argument(env));
+        }
+
+        const FunctionalObject& object = *function.AsFunction();
+        if (!object.native) {
+            throw EvaluatorErrors(EvaluatorErrors::kCallOfNonFunction);
+        }
+        return object.native(values);
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileExpressionImpl(const ListExpression& expr) {
+    std::vector<ValueClosure> elements;
+    elements.reserve(expr.elements.size());
+    for (const auto& element : expr.elements) {
+        elements.push_back(CompileExpression(*element));
+    }
+
+    return [elements = std::move(elements)](Enviroment* env) {
+        Value::Array array;
+        array.reserve(elements.size());
+        for (const auto& element : elements) {
+            array.push_back(element(env));
+        }
+        return Value(std::move(array));
+    };
+}
+
+
+// The body is compiled once and shared by every function object the
+// expression creates; each object only adds the cells it captured.
+ValueClosure ClosureCompiler::CompileExpressionImpl(const FunctionExpression& expr) {
+    auto body = std::make_shared<const StatementClosure>(CompileStatements(expr.f_body));
+    std::size_t arity = expr.parameters.size();
+
+    return [body, arity, &captures = expr.captures, &calls = calls_](Enviroment* env) {
+        auto function = std::make_shared<FunctionalObject>(
+            [body, arity, &calls, upvalues = env->Capture(captures)](FunctionalObject::Arguments args) -> Value {
+                CallDepth::Scope call(calls);
+                Enviroment local(upvalues);
+                for (std::size_t i = 0; i < arity; ++i) {
+                    local.SetLocal(i, i < args.size() ? args[i] : Value(NilType{}));
+                }
+
+                Completion completion = (*body)(&local);
+                if (completion.kind == Completion::Kind::Return) {
+                    return std::move(completion.value);
+                }
+                if (!completion.IsNormal()) {
+                    throw InterpreterError(InterpreterError::kUnexpectedCompletion);
+                }
+                return Value(NilType{});
+            }
+        );
+        return Value(function);
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileExpressionImpl(const AssignExpression& expr) {
+    if (expr.operation != TokenType::assign_) {
+        return CompileCompoundAssign(expr);
+    }
+
+    ValueClosure value = CompileExpression(*expr.rhs);
+    if (expr.address.kind != LexicalAddress::Kind::Global) {
+        return [value = std::move(value), address = expr.address](Enviroment* env) {
+            Value result = value(env);
+            env->Set(address, result);
+            return result;
+        };
+    }
+    return [value = std::move(value), &globals = globals_, slot = expr.address.slot](Enviroment* env) {
+        Value result = value(env);
+        globals.Set(slot, result);
+        return result;
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileCompoundAssign(const AssignExpression& expr) {
+    ValueClosure value = CompileExpression(*expr.rhs);
+    if (expr.address.kind != LexicalAddress::Kind::Global) {
+        return CompoundAssign(expr.operation, std::move(value)
+            , [address = expr.address, name = expr.name](Enviroment* env) -> Value& {
+                return env->Get(address, name);
+            });
+    }
+    return CompoundAssign(expr.operation, std::move(value)
+        , [&globals = globals_, slot = expr.address.slot](Enviroment*) -> Value& {
+            return globals.Get(slot);
+        });
+}
+
+
+ValueClosure ClosureCompiler::CompileExpressionImpl(const IndexExpression& expr) {
+    return [object = CompileExpression(*expr.object), index = CompileExpression(*expr.index)](Enviroment* env) {
+        Value container = object(env);
+        Value position = index(env);
+        return Index(container, position);
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileExpressionImpl(const SliceExpression& expr) {
+    ValueClosure from = expr.from_s ? CompileExpression(*expr.from_s) : ValueClosure();
+    ValueClosure to = expr.to_s ? CompileExpression(*expr.to_s) : ValueClosure();
+
+    return [object = CompileExpression(*expr.object), from = std::move(from), to = std::move(to)](Enviroment* env) {
+        Value container = object(env);
+
+        std::optional<Value> from_value;
+        if (from) {
+            from_value = from(env);
+        }
+
+        std::optional<Value> to_value;
+        if (to) {
+            to_value = to(env);
+        }
+
+        return Slice(container, from_value ? &*from_value : nullptr, to_value ? &*to_value : nullptr);
+    };
+}
+
+
+ValueClosure ClosureCompiler::CompileExpressionImpl(const IndexAssignExpression& expr) {
+    ValueClosure object = CompileExpression(*expr.object);
+    ValueClosure index = CompileExpression(*expr.index);
+    ValueClosure rhs = CompileExpression(*expr.rhs);
+
+    if (expr.operation == TokenType::assign_) {
+        return [object = std::move(object), index = std::move(index), rhs = std::move(rhs)](Enviroment* env) {
+            Value container = object(env);
+            Value position = index(env);
+            return SetIndex(container, position, rhs(env));
+        };
+    }
+
+    BinaryFn apply = SelectBinary(CompoundBaseOperation(expr.operation));
+    return [object = std::move(object), index = std::move(index), rhs = std::move(rhs), apply](Enviroment* env) {
+        Value container = object(env);
+        Value position = index(env);
+        Value current = Index(container, position);
+        Value value = rhs(env);
+        return SetIndex(container, position, apply(current, value));
+    };
+}
+
+
+// Closures already take a pre-resolved path for every node, so a fused
+// idiom compiles like the subtree it replaced.
+ValueClosure ClosureCompiler::CompileExpressionImpl(const FusedExpression& expr) {
+    return CompileExpression(*expr.original);
+}
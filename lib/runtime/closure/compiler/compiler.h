@@ -0,0 +1,72 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <vls_and_sttmnts.h>
+#include <runtime/value/value.h>
+#include <runtime/enviroment/enviroment.h>
+#include <runtime/enviroment/global_table.h>
+#include <runtime/interpreter/statements/completion.h>
+#include <runtime/interpreter/call_stack/call_stack.h>
+
+
+// Compiled forms of expressions, conditions and statements. Each closure
+// owns the closures of its children and runs against the environment it is
+// given.
+using ValueClosure = std::function<Value(Enviroment*)>;
+using TestClosure = std::function<bool(Enviroment*)>;
+using StatementClosure = std::function<Completion(Enviroment*)>;
+
+
+// Turns a semantically checked program into a tree of closures. Everything
+// the tree-walker decides on each visit is decided here once: which node it
+// is, which operator handler applies and where a name lives. Functions are
+// compiled once as well and called through FunctionalObject::native; their
+// calls are counted against `calls`.
+class ClosureCompiler {
+public:
+    ClosureCompiler(GlobalTable&, CallDepth& calls);
+
+    StatementClosure Compile(const std::vector<Statement>&);
+
+private:
+    StatementClosure CompileStatement(const Statement&);
+    StatementClosure CompileStatements(const std::vector<Statement>&);
+    StatementClosure CompileScope(const std::vector<Statement>&, const ScopeLayout&);
+
+    StatementClosure CompileStatementImpl(const ExpressionStatement&);
+    StatementClosure CompileStatementImpl(const IfStatement&);
+    StatementClosure CompileStatementImpl(const WhileStatement&);
+    StatementClosure CompileStatementImpl(const ForStatement&);
+    StatementClosure CompileStatementImpl(const ReturnStatement&);
+    StatementClosure CompileStatementImpl(const BlockStatement&);
+    StatementClosure CompileStatementImpl(const BreakStatement&);
+    StatementClosure CompileStatementImpl(const ContinueStatement&);
+
+private:
+    ValueClosure CompileExpression(const Expression&);
+    TestClosure CompileCondition(const Expression&);
+
+    ValueClosure CompileExpressionImpl(const NumberExpression&);
+    ValueClosure CompileExpressionImpl(const StringExpression&);
+    ValueClosure CompileExpressionImpl(const BoolExpression&);
+    ValueClosure CompileExpressionImpl(const NilExpression&);
+    ValueClosure CompileExpressionImpl(const VariableExpression&);
+    ValueClosure CompileExpressionImpl(const UnaryExpression&);
+    ValueClosure CompileExpressionImpl(const BinaryExpression&);
+    ValueClosure CompileExpressionImpl(const CallableExpression&);
+    ValueClosure CompileExpressionImpl(const ListExpression&);
+    ValueClosure CompileExpressionImpl(const FunctionExpression&);
+    ValueClosure CompileExpressionImpl(const AssignExpression&);
+    ValueClosure CompileExpressionImpl(const IndexExpression&);
+    ValueClosure CompileExpressionImpl(const SliceExpression&);
+    ValueClosure CompileExpressionImpl(const IndexAssignExpression&);
+    ValueClosure CompileExpressionImpl(const FusedExpression&);
+
+    ValueClosure CompileCompoundAssign(const AssignExpression&);
+
+private:
+    GlobalTable& globals_;
+    CallDepth& calls_;
+};
@@ -1,3 +1,7 @@
+#include <iterator>
+#include <memory>
+#include <utility>
+
 #include <runtime/enviroment/enviroment.h>
 
 Enviroment::Enviroment() = default;
@@ -5,6 +9,29 @@ Enviroment::Enviroment() = default;
 
 Enviroment::Enviroment(Enviroment* parent)
     : parent_(parent)
+    , upvalues_(parent ? parent->upvalues_ : nullptr)
+{}
+
+
+Enviroment::Enviroment(Enviroment* parent, std::size_t slots)
+    : parent_(parent)
+    , upvalues_(parent ? parent->upvalues_ : nullptr)
+    , owned_(slots)
+{
+    slots_ = owned_;
+}
+
+
+Enviroment::Enviroment(Enviroment* parent, std::span<std::optional<Value>> slots)
+    : parent_(parent)
+    , upvalues_(parent ? parent->upvalues_ : nullptr)
+    , slots_(slots)
+{}
+
+
+Enviroment::Enviroment(const std::vector<Cell>& upvalues, std::span<std::optional<Value>> slots)
+    : upvalues_(&upvalues)
+    , slots_(slots)
 {}
 
 
@@ -38,3 +65,118 @@ Value Enviroment::Get(const std::string& name) const {
     }
     throw EnviromentError(EnviromentError::kUndefinedVariable + name);
 }
+
+
+
+const Value& Enviroment::Get(const LexicalAddress& address, const std::string& name) const {
+    std::optional<Value>* slot = Locate(address);
+    if (slot && *slot) {
+        return **slot;
+    }
+    throw EnviromentError(EnviromentError::kUndefinedVariable + name);
+}
+
+
+Value& Enviroment::Get(const LexicalAddress& address, const std::string& name) {
+    return const_cast<Value&>(std::as_const(*this).Get(address, name));
+}
+
+
+Value* Enviroment::Find(const LexicalAddress& address) {
+    std::optional<Value>* slot = Locate(address);
+    if (slot && *slot) {
+        return &**slot;
+    }
+    return nullptr;
+}
+
+
+void Enviroment::Set(const LexicalAddress& address, Value val) {
+    if (address.kind != LexicalAddress::Kind::Local) {
+        *Locate(address) = std::move(val);
+        return;
+    }
+
+    Enviroment* scope = this;
+    for (std::uint32_t i = 0; i < address.depth; ++i) {
+        scope = scope->parent_;
+    }
+    scope->SetLocal(address.slot, std::move(val));
+}
+
+
+// Parameters and loop variables are bound here whether or not they are
+// cells; a cell that already exists takes the value.
+void Enviroment::SetLocal(std::size_t slot, Value val) {
+    if (slot < cells_.size() && cells_[slot]) {
+        *cells_[slot] = std::move(val);
+        return;
+    }
+    if (slot >= slots_.size()) {
+        if (owned_.data() != slots_.data()) {
+            owned_.assign(std::make_move_iterator(slots_.begin()), std::make_move_iterator(slots_.end()));
+        }
+        owned_.resize(slot + 1);
+        slots_ = owned_;
+    }
+    slots_[slot] = std::move(val);
+}
+
+
+void Enviroment::ClearLocals() {
+    for (auto& slot : slots_) {
+        slot.reset();
+    }
+    cells_.clear();
+}
+
+
+std::vector<Enviroment::Cell> Enviroment::Capture(std::span<const LexicalAddress> captures) const {
+    std::vector<Cell> cells;
+    cells.reserve(captures.size());
+    for (const auto& address : captures) {
+        if (address.kind == LexicalAddress::Kind::Upvalue) {
+            cells.push_back((*upvalues_)[address.slot]);
+            continue;
+        }
+        const Enviroment* scope = this;
+        for (std::uint32_t i = 0; i < address.depth; ++i) {
+            scope = scope->parent_;
+        }
+        cells.push_back(scope->CellAt(address.slot));
+    }
+    return cells;
+}
+
+
+std::optional<Value>* Enviroment::Locate(const LexicalAddress& address) const {
+    if (address.kind == LexicalAddress::Kind::Upvalue) {
+        return (*upvalues_)[address.slot].get();
+    }
+
+    const Enviroment* scope = this;
+    for (std::uint32_t i = 0; i < address.depth; ++i) {
+        scope = scope->parent_;
+    }
+    if (address.kind == LexicalAddress::Kind::Cell) {
+        return scope->CellAt(address.slot).get();
+    }
+    return address.slot < scope->slots_.size() ? &scope->slots_[address.slot] : nullptr;
+}
+
+
+// The value already in the slot, such as a bound parameter, moves into the
+// cell when it is created.
+const Enviroment::Cell& Enviroment::CellAt(std::size_t slot) const {
+    if (slot >= cells_.size()) {
+        cells_.resize(slot + 1);
+    }
+    Cell& cell = cells_[slot];
+    if (!cell) {
+        cell = std::make_shared<std::optional<Value>>();
+        if (slot < slots_.size()) {
+            std::swap(*cell, slots_[slot]);
+        }
+    }
+    return cell;
+}
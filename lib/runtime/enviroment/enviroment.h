@@ -1,16 +1,37 @@
 #pragma once
 
+#include <optional>
+#include <span>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 #include <runtime/value/value.h>
+#include <runtime/function/function.h>
 #include <runtime/enviroment/errors/env_errors.h>
+#include <vls_and_sttmnts.h>
 
 
+// A scope of the running program. Variables live in slots assigned by
+// SemanticAnalizer and are reached through LexicalAddress; globals are kept
+// in GlobalTable. The name-keyed interface serves scopes filled by hand.
+// Slots are either owned or borrowed from a ValueStack for the lifetime of
+// the scope; a borrowed region that turns out too small is copied out.
+// A slot holding a Cell variable moves to a heap cell on first use, and the
+// cells of the enclosing functions a body captured are its upvalues.
 class Enviroment {
 public:
+    using Cell = FunctionalObject::Cell;
+
     Enviroment();
     Enviroment(Enviroment*);
+    Enviroment(Enviroment*, std::size_t);
+    Enviroment(Enviroment*, std::span<std::optional<Value>>);
+    // The outermost scope of a call of a function holding `upvalues`.
+    Enviroment(const std::vector<Cell>& upvalues, std::span<std::optional<Value>> = {});
+
+    Enviroment(const Enviroment&) = delete;
+    Enviroment& operator=(const Enviroment&) = delete;
 
 public:
     bool Define(const std::string&, Value);
@@ -19,7 +40,34 @@ public:
 
     Value Get(const std::string&) const;
 
+public:
+    const Value& Get(const LexicalAddress&, const std::string&) const;
+
+    Value& Get(const LexicalAddress&, const std::string&);
+
+    // Like Get, but nullptr for a variable that has no value yet.
+    Value* Find(const LexicalAddress&);
+
+    void Set(const LexicalAddress&, Value);
+
+    void SetLocal(std::size_t, Value);
+
+    void ClearLocals();
+
+    // The cells a function created in this scope takes, as listed by
+    // FunctionExpression::captures.
+    std::vector<Cell> Capture(std::span<const LexicalAddress>) const;
+
+private:
+    std::optional<Value>* Locate(const LexicalAddress&) const;
+    const Cell& CellAt(std::size_t) const;
+
 private:
     Enviroment* parent_ = nullptr;
+    const std::vector<Cell>* upvalues_ = nullptr;
     std::unordered_map<std::string, Value> values_;
+    std::span<std::optional<Value>> slots_;
+    std::vector<std::optional<Value>> owned_;
+    // Indexed by slot; created as Cell addresses reach them.
+    mutable std::vector<Cell> cells_;
 };
@@ -0,0 +1,66 @@
+#include <utility>
+
+#include <runtime/enviroment/global_table.h>
+
+
+std::size_t GlobalTable::Bind(const std::string& name) {
+    auto [it, inserted] = slots_.try_emplace(name, names_.size());
+    if (inserted) {
+        names_.push_back(name);
+        values_.emplace_back();
+    }
+    return it->second;
+}
+
+
+void GlobalTable::Define(const std::string& name, Value val) {
+    Set(Bind(name), std::move(val));
+}
+
+
+bool GlobalTable::Has(const std::string& name) const {
+    return slots_.contains(name);
+}
+
+
+Value GlobalTable::Get(const std::string& name) const {
+    auto it = slots_.find(name);
+    if (it == slots_.end()) {
+        throw EnviromentError(EnviromentError::kUndefinedVariable + name);
+    }
+    return Get(it->second);
+}
+
+
+const Value& GlobalTable::Get(std::size_t slot) const {
+    if (!values_[slot]) {
+        throw EnviromentError(EnviromentError::kUndefinedVariable + names_[slot]);
+    }
+    return *values_[slot];
+}
+
+
+Value& GlobalTable::Get(std::size_t slot) {
+    return const_cast<Value&>(std::as_const(*this).Get(slot));
+}
+
+
+Value* GlobalTable::Find(std::size_t slot) {
+    return values_[slot] ? &*values_[slot] : nullptr;
+}
+
+
+void GlobalTable::Set(std::size_t slot, Value val) {
+    values_[slot] = std::move(val);
+}
+
+
+// Values are only ever added, one per name, and never unset.
+std::size_t GlobalTable::Version() const {
+    return values_.size();
+}
+
+
+const std::vector<std::string>& GlobalTable::Names() const {
+    return names_;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <runtime/value/value.h>
+#include <runtime/enviroment/errors/env_errors.h>
+
+
+// Values of top-level names. Each name is bound once to a stable slot, so
+// resolved references index the table instead of hashing the name.
+class GlobalTable {
+public:
+    std::size_t Bind(const std::string&);
+
+    void Define(const std::string&, Value);
+
+    bool Has(const std::string&) const;
+
+    Value Get(const std::string&) const;
+
+    const Value& Get(std::size_t) const;
+
+    Value& Get(std::size_t);
+
+    // Like Get, but nullptr for a name that has no value yet.
+    Value* Find(std::size_t);
+
+    void Set(std::size_t, Value);
+
+    // Changes whenever binding a name may have moved the values, so a
+    // pointer Find returned stays valid while the version is the same.
+    std::size_t Version() const;
+
+    const std::vector<std::string>& Names() const;
+
+private:
+    std::unordered_map<std::string, std::size_t> slots_;
+    std::vector<std::string> names_;
+    std::vector<std::optional<Value>> values_;
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+
+// Storage for the arguments and local slots of the calls in progress.
+// Regions are taken and given back in LIFO order. Memory comes in chunks
+// that never move, so a region stays valid while later ones are pushed, and
+// once the chunks a program needs exist, taking a region allocates nothing.
+// Released elements are reset to T{}, so the values they held are dropped
+// when the call ends, as they would be with a scope of their own.
+template<typename T>
+class ValueStack {
+public:
+    // Everything pushed while a Scope is alive is released with it.
+    class Scope {
+    public:
+        explicit Scope(ValueStack& stack)
+            : stack_(stack)
+            , chunk_(stack.chunk_)
+            , top_(stack.top_)
+        {}
+
+        ~Scope() {
+            Release();
+        }
+
+        // Gives back what was pushed so far; later pushes are released
+        // again at the end of the Scope.
+        void Release() {
+            stack_.Release(chunk_, top_);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        ValueStack& stack_;
+        std::size_t chunk_;
+        std::size_t top_;
+    };
+
+public:
+    ValueStack() {
+        chunks_.push_back(Chunk{std::make_unique<T[]>(kChunkSize), kChunkSize, 0});
+    }
+
+    // `count` contiguous elements, all equal to T{}.
+    std::span<T> Push(std::size_t count) {
+        if (top_ + count > chunks_[chunk_].size) {
+            Advance(count);
+        }
+        std::span<T> region(chunks_[chunk_].data.get() + top_, count);
+        top_ += count;
+        return region;
+    }
+
+private:
+    static constexpr std::size_t kChunkSize = 4096;
+
+    struct Chunk {
+        std::unique_ptr<T[]> data;
+        std::size_t size;
+        // The top the chunk was left at when a region did not fit in it.
+        std::size_t used;
+    };
+
+    // Moves to the next chunk, replacing it when it is too small for a
+    // region of `count` elements.
+    void Advance(std::size_t count) {
+        chunks_[chunk_].used = top_;
+        ++chunk_;
+        top_ = 0;
+        if (chunk_ == chunks_.size()) {
+            chunks_.emplace_back();
+        }
+        Chunk& chunk = chunks_[chunk_];
+        if (chunk.size < count) {
+            chunk.size = std::max(kChunkSize, count);
+            chunk.data = std::make_unique<T[]>(chunk.size);
+        }
+    }
+
+    void Release(std::size_t chunk, std::size_t top) {
+        while (chunk_ > chunk) {
+            Reset(chunks_[chunk_], 0, top_);
+            --chunk_;
+            top_ = chunks_[chunk_].used;
+        }
+        Reset(chunks_[chunk_], top, top_);
+        top_ = top;
+    }
+
+    static void Reset(Chunk& chunk, std::size_t from, std::size_t to) {
+        std::fill(chunk.data.get() + from, chunk.data.get() + to, T{});
+    }
+
+private:
+    std::vector<Chunk> chunks_;
+    std::size_t chunk_ = 0;
+    std::size_t top_ = 0;
+};
@@ -11,6 +11,7 @@ public:
     static constexpr const char* kUndefinedVariable = "string index out of range";
     static constexpr const char* kArrayIndexOutOfRange = "Array index out of range";
     static constexpr const char* kInvalidArrayIndex = "Indexing non-indexable type";
+    static constexpr const char* kInvalidIndexAssignment = "Element assignment to non-list type";
     static constexpr const char* kInvalidSlice = "Slicing non-sliceable type";
     static constexpr const char* kUnsupportedBinaryOperation = "Unsupported binary operation";
     static constexpr const char* kUnsupportedUnaryOperation = "Unsupported unary operation";
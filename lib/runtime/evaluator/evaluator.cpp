@@ -1,6 +1,10 @@
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <iomanip>
 #include <memory>
+#include <optional>
+#include <span>
 
 #include <runtime/evaluator/evaluator.h>
 #include <runtime/interpreter/interpreter.h>
@@ -10,20 +14,65 @@
 #include <semantic.h>
 
 
-static void EnsInitialized() {
-    static bool initialized = false;
-    if (!initialized) {
-        Initialize();
-        initialized = true;
+namespace {
+
+constexpr auto kNumber = static_cast<std::uint8_t>(Value::Kind::Number);
+constexpr auto kList = static_cast<std::uint8_t>(Value::Kind::List);
+
+
+std::uint8_t KindOf(const Value& value) {
+    return static_cast<std::uint8_t>(value.GetKind());
+}
+
+
+bool IsComparison(TokenType op) {
+    switch (op) {
+        case TokenType::double_eq_:
+        case TokenType::not_eq_:
+        case TokenType::less_:
+        case TokenType::less_eq_:
+        case TokenType::greater_:
+        case TokenType::greater_eq_:
+            return true;
+        default:
+            return false;
     }
 }
 
+
+bool CompareNumbers(TokenType op, double x, double y) {
+    switch (op) {
+        case TokenType::double_eq_: return x == y;
+        case TokenType::not_eq_: return x != y;
+        case TokenType::less_: return x < y;
+        case TokenType::less_eq_: return x <= y;
+        case TokenType::greater_: return x > y;
+        case TokenType::greater_eq_: return x >= y;
+        default: throw EvaluatorErrors(EvaluatorErrors::kBadOperandsForBinaryOperation);
+    }
+}
+
+
+
+Value ApplyNumbers(TokenType op, double x, double y) {
+    switch (op) {
+        case TokenType::plus_: return Value(x + y);
+        case TokenType::minus_: return Value(x - y);
+        case TokenType::star_: return Value(x * y);
+        case TokenType::slash_: return Value(x / y);
+        case TokenType::percent_: return Value(std::fmod(x, y));
+        case TokenType::degree_: return Value(std::pow(x, y));
+        default: return Value(CompareNumbers(op, x, y));
+    }
+}
+
+} // namespace
+
+
 ExpressionEvaluator::ExpressionEvaluator(Interpreter* interpreter, Enviroment* env)
     : interpreter_(interpreter)
     , env_(env)
-{
-    EnsInitialized();
-}
+{}
 
 
 Value ExpressionEvaluator::operator()(const NumberExpression& expr) const {
@@ -47,15 +96,17 @@ Value ExpressionEvaluator::operator()(const NilExpression&) const {
 
 
 Value ExpressionEvaluator::operator()(const VariableExpression& expr) const {
-    return env_->Get(expr.name);
+    if (expr.address.kind != LexicalAddress::Kind::Global) {
+        return env_->Get(expr.address, expr.name);
+    }
+    return interpreter_->globals_.Get(expr.address.slot);
 }
 
 
 Value ExpressionEvaluator::operator()(const UnaryExpression& expr) const {
     Value operand = interpreter_->ParseNode(*expr.rhs, env_);
-    auto& registry = OperationRegistry::Get();
-    if (registry.SupportsUnary(expr.operation)) {
-        return registry.ExecuteUnary(expr.operation, operand);
+    if (auto op = OperationRegistry::ToUnary(expr.operation)) {
+        return OperationRegistry::Unary(*op, operand);
     }
     throw EvaluatorErrors(EvaluatorErrors::kBadOperandsForBinaryOperation);
 }
@@ -80,6 +131,26 @@ Value ExpressionEvaluator::operator()(const BinaryExpression& expr) const {
     Value left = interpreter_->ParseNode(*expr.lhs, env_);
     Value right = interpreter_->ParseNode(*expr.rhs, env_);
 
+    QuickeningSite& site = expr.site;
+    if (site.state == QuickeningSite::State::Quickened) {
+        if (site.Matches(kNumber, kNumber)) {
+            if (left.IsNumber() && right.IsNumber()) {
+                return ApplyNumbers(expr.operation, left.AsNumber(), right.AsNumber());
+            }
+        } else if (site.Matches(KindOf(left), KindOf(right))) {
+            return ApplyQuickened(expr, left, right);
+        }
+        site.state = QuickeningSite::State::Generic;
+    } else if (site.state == QuickeningSite::State::Warming) {
+        site.Observe(KindOf(left), KindOf(right));
+    }
+    return Apply(expr, left, right);
+}
+
+
+Value ExpressionEvaluator::Apply(const BinaryExpression& expr
+                            , const Value& left, const Value& right) const
+{
     if (expr.operation == TokenType::double_eq_) {
         return Value(interpreter_->IsEqual(left, right));
     }
@@ -87,31 +158,131 @@ Value ExpressionEvaluator::operator()(const BinaryExpression& expr) const {
         return Value(!interpreter_->IsEqual(left, right));
     }
 
-    auto& registry = OperationRegistry::Get();
-    if (registry.SupportsBinary(expr.operation)) {
-        return registry.ExecuteBinary(expr.operation, left, right);
+    if (auto op = OperationRegistry::ToBinary(expr.operation)) {
+        return OperationRegistry::Binary(*op, left, right);
     }
 
     throw EvaluatorErrors(EvaluatorErrors::kBadOperandsForBinaryOperation);
 }
 
 
-Value ExpressionEvaluator::operator()(const CallableExpression& expr) const {
-    Value callable = interpreter_->ParseNode(*expr.callable, env_);
+// The operands are known to have the kinds the node was quickened for,
+// other than two numbers.
+Value ExpressionEvaluator::ApplyQuickened(const BinaryExpression& expr
+                                    , const Value& left, const Value& right) const
+{
+    if (auto op = OperationRegistry::ToBinary(expr.operation)) {
+        return OperationRegistry::Lookup(*op, left.GetKind(), right.GetKind())(left, right);
+    }
+    return Apply(expr, left, right);
+}
+
+
+// Conditions of if and while. A comparison quickened for two numbers is
+// decided without building a Value for its result.
+bool ExpressionEvaluator::Test(const Expression& condition) const {
+    if (const auto* fused = std::get_if<FusedExpression>(&condition.value)) {
+        bool holds = false;
+        if (fused->kind == FusedExpression::Kind::Compare && TestFused(*fused, holds)) {
+            return holds;
+        }
+        return interpreter_->IsTrue((*this)(*fused));
+    }
+
+    const auto* expr = std::get_if<BinaryExpression>(&condition.value);
+    if (!expr) {
+        return interpreter_->IsTrue(interpreter_->ParseNode(condition, env_));
+    }
+    if (expr->operation == TokenType::and_) {
+        return Test(*expr->lhs) && Test(*expr->rhs);
+    }
+    if (expr->operation == TokenType::or_) {
+        return Test(*expr->lhs) || Test(*expr->rhs);
+    }
+
+    const QuickeningSite& site = expr->site;
+    if (!IsComparison(expr->operation)
+        || site.state != QuickeningSite::State::Quickened
+        || !site.Matches(kNumber, kNumber))
+    {
+        return interpreter_->IsTrue((*this)(*expr));
+    }
+
+    Value left = interpreter_->ParseNode(*expr->lhs, env_);
+    Value right = interpreter_->ParseNode(*expr->rhs, env_);
+    if (left.IsNumber() && right.IsNumber()) {
+        return CompareNumbers(expr->operation, left.AsNumber(), right.AsNumber());
+    }
+    expr->site.state = QuickeningSite::State::Generic;
+    return interpreter_->IsTrue(Apply(*expr, left, right));
+}
+
+
+// A callee read from a variable that still holds the cached function is
+// taken as is; anything else is evaluated and checked, and refills the
+// cache. A global callee is checked in the slot it was cached from, without
+// looking its address up again.
+Value ExpressionEvaluator::Callee(const CallableExpression& expr, bool& cached) const {
+    CallSiteCache& cache = expr.cache;
+    GlobalTable& globals = interpreter_->globals_;
+
+    if (cache.slot && cache.version == globals.Version()) {
+        if (cache.slot->IsFunction() && cache.slot->AsFunction().get() == cache.function.get()) {
+            cached = true;
+            ++cache.hits;
+            return *cache.slot;
+        }
+    } else if (const auto* var = std::get_if<VariableExpression>(&expr.callable->value);
+        var && !cache.slot && cache.function && var->address.kind != LexicalAddress::Kind::Unresolved)
+    {
+        const Value* current = Find(var->address);
+        if (current && current->IsFunction() && current->AsFunction().get() == cache.function.get()) {
+            cached = true;
+            ++cache.hits;
+            return *current;
+        }
+    }
 
-    if (!std::holds_alternative<Value::FuncPtr>(callable.data)) {
+    cached = false;
+    Value callable = interpreter_->ParseNode(*expr.callable, env_);
+    if (!callable.IsFunction()) {
         throw EvaluatorErrors(EvaluatorErrors::kCallOfNonFunction);
     }
+    if (cache.hits == 0 && cache.misses == 0) {
+        interpreter_->call_sites_.push_back(&expr);
+    }
+    ++cache.misses;
+    cache.function = callable.AsFunction();
+    cache.native = static_cast<bool>(cache.function->native);
+
+    const auto* var = std::get_if<VariableExpression>(&expr.callable->value);
+    if (var && var->address.kind == LexicalAddress::Kind::Global) {
+        cache.slot = globals.Find(var->address.slot);
+        cache.version = globals.Version();
+    } else {
+        cache.slot = nullptr;
+    }
+    return callable;
+}
 
-    auto function = std::get<Value::FuncPtr>(callable.data);
-    std::vector<Value> arguments;
-    arguments.reserve(expr.f_arguments.size());
 
-    for (const auto& arg : expr.f_arguments) {
-        arguments.push_back(interpreter_->ParseNode(*arg, env_));
+// The local copy of the callee keeps the function alive while it runs, even
+// if the call replaces the cache or the variable.
+Value ExpressionEvaluator::operator()(const CallableExpression& expr) const {
+    bool cached = false;
+    Value callable = Callee(expr, cached);
+
+    const Value::FuncPtr& function = callable.AsFunction();
+    ValueStack<Value>::Scope frame(interpreter_->arguments_);
+    std::span<Value> arguments = interpreter_->arguments_.Push(expr.f_arguments.size());
+    for (std::size_t i = 0; i < expr.f_arguments.size(); ++i) {
+        arguments[i] = interpreter_->ParseNode(*expr.f_arguments[i], env_);
     }
 
-    return interpreter_->PerformFunction(function, arguments);
+    if (cached && expr.cache.native) {
+        return function->native(arguments);
+    }
+    return interpreter_->PerformFunction(function, arguments, &expr);
 }
 
 
@@ -120,17 +291,21 @@ Value ExpressionEvaluator::operator()(const ListExpression& expr) const {
     array.reserve(expr.elements.size());
 
     for (const auto& element : expr.elements) {
-        array.push_back(std::make_shared<Value>(interpreter_->ParseNode(*element, env_)));
+        array.push_back(interpreter_->ParseNode(*element, env_));
     }
 
-    return Value(array);
+    if (!expr.escapes) {
+        return Value(std::move(array), interpreter_->lists_.Push(1)[0]);
+    }
+    return Value(std::move(array));
 }
 
 
 Value ExpressionEvaluator::operator()(const FunctionExpression& expr) const {
     auto function_obj = std::make_shared<FunctionalObject>(
-        expr.parameters, &expr.f_body, env_
+        expr.parameters, &expr.f_body, env_->Capture(expr.captures)
     );
+    function_obj->slots = expr.scope.slots;
     return Value(function_obj);
 }
 
@@ -138,8 +313,24 @@ Value ExpressionEvaluator::operator()(const FunctionExpression& expr) const {
 Value ExpressionEvaluator::operator()(const AssignExpression& expr) const {
     Value value = interpreter_->ParseNode(*expr.rhs, env_);
 
-    if (!env_->Assign(expr.name, value)) {
-        env_->Define(expr.name, value);
+    if (expr.operation != TokenType::assign_) {
+        Value& target = expr.address.kind != LexicalAddress::Kind::Global
+            ? env_->Get(expr.address, expr.name)
+            : interpreter_->globals_.Get(expr.address.slot);
+
+        if (expr.operation == TokenType::plus_eq_) {
+            AddInPlace(target, value);
+        } else {
+            target = OperationRegistry::ExecuteBinary(
+                CompoundBaseOperation(expr.operation), target, value);
+        }
+        return target;
+    }
+
+    if (expr.address.kind != LexicalAddress::Kind::Global) {
+        env_->Set(expr.address, value);
+    } else {
+        interpreter_->globals_.Set(expr.address.slot, value);
     }
 
     return value;
@@ -149,86 +340,198 @@ Value ExpressionEvaluator::operator()(const AssignExpression& expr) const {
 Value ExpressionEvaluator::operator()(const IndexExpression& expr) const {
     Value object = interpreter_->ParseNode(*expr.object, env_);
     Value index_value = interpreter_->ParseNode(*expr.index, env_);
-    int index = static_cast<int>(std::get<double>(index_value.data));
-
-    auto normalize_index = [](int idx, int size) constexpr -> int {
-        return idx < 0 ? idx + size : idx;
-    };
 
-    if (auto* str = std::get_if<std::string>(&object.data)) {
-        int size = static_cast<int>(str->size());
-        int normalized_idx = normalize_index(index, size);
-
-        if (normalized_idx < 0 || normalized_idx >= size) {
-            throw EvaluatorErrors(EvaluatorErrors::kUndefinedVariable);
+    // Only list[number] has a quickened form; ranges fail its guard.
+    QuickeningSite& site = expr.site;
+    if (site.state == QuickeningSite::State::Quickened) {
+        if (object.IsList() && index_value.IsNumber() && !object.IsRange()) {
+            const Value::Array& array = object.AsList();
+            int size = static_cast<int>(array.size());
+            int index = static_cast<int>(index_value.AsNumber());
+            if (index < 0) {
+                index += size;
+            }
+            if (index < 0 || index >= size) {
+                throw EvaluatorErrors(EvaluatorErrors::kArrayIndexOutOfRange);
+            }
+            return array[index];
+        }
+        site.state = QuickeningSite::State::Generic;
+    } else if (site.state == QuickeningSite::State::Warming) {
+        site.Observe(KindOf(object), KindOf(index_value));
+        if (site.state == QuickeningSite::State::Quickened && !site.Matches(kList, kNumber)) {
+            site.state = QuickeningSite::State::Generic;
         }
-
-        return Value(std::string(1, (*str)[normalized_idx]));
     }
+    return Index(object, index_value);
+}
 
-    if (auto* array = std::get_if<Value::Array>(&object.data)) {
-        int size = static_cast<int>(array->size());
-        int normalized_idx = normalize_index(index, size);
 
-        if (normalized_idx < 0 || normalized_idx >= size) {
-            throw EvaluatorErrors(EvaluatorErrors::kArrayIndexOutOfRange);
-        }
+Value ExpressionEvaluator::operator()(const SliceExpression& expr) const {
+    Value object = interpreter_->ParseNode(*expr.object, env_);
+
+    std::optional<Value> from;
+    if (expr.from_s) {
+        from = interpreter_->ParseNode(*expr.from_s, env_);
+    }
 
-        return *(*array)[normalized_idx];
+    std::optional<Value> to;
+    if (expr.to_s) {
+        to = interpreter_->ParseNode(*expr.to_s, env_);
     }
 
-    throw EvaluatorErrors(EvaluatorErrors::kInvalidArrayIndex);
+    return Slice(object, from ? &*from : nullptr, to ? &*to : nullptr);
 }
 
 
-Value ExpressionEvaluator::operator()(const SliceExpression& expr) const {
+Value ExpressionEvaluator::operator()(const IndexAssignExpression& expr) const {
     Value object = interpreter_->ParseNode(*expr.object, env_);
+    Value index_value = interpreter_->ParseNode(*expr.index, env_);
 
-    auto normalize_and_clamp = [](int idx, int size) constexpr -> int {
-        int normalized = idx < 0 ? idx + size : idx;
-        return std::clamp(normalized, 0, size);
-    };
-
-    int from = 0;
-    if (expr.from_s) {
-        from = static_cast<int>(std::get<double>(
-            interpreter_->ParseNode(*expr.from_s, env_).data));
+    if (expr.operation == TokenType::assign_) {
+        return SetIndex(object, index_value, interpreter_->ParseNode(*expr.rhs, env_));
     }
 
-    if (auto* str = std::get_if<std::string>(&object.data)) {
-        int size = static_cast<int>(str->size());
+    Value current = Index(object, index_value);
+    Value rhs = interpreter_->ParseNode(*expr.rhs, env_);
+    Value result = OperationRegistry::ExecuteBinary(
+        CompoundBaseOperation(expr.operation), current, rhs);
+    return SetIndex(object, index_value, result);
+}
+
+
+Value ExpressionEvaluator::operator()(const FusedExpression& expr) const {
+    using Kind = FusedExpression::Kind;
+
+    switch (expr.kind) {
+        case Kind::Increment: {
+            Value* target = Find(expr.target);
+            if (target && target->IsNumber()) {
+                ++expr.hits;
+                double x = target->AsNumber();
+                *target = Value(expr.operation == TokenType::plus_
+                    ? x + expr.constant : x - expr.constant);
+                return *target;
+            }
+            break;
+        }
+        case Kind::Compare: {
+            bool holds = false;
+            if (TestFused(expr, holds)) {
+                return Value(holds);
+            }
+            break;
+        }
+        case Kind::Index: {
+            Value* object = Find(expr.lhs);
+            double index = 0;
+            if (object && object->IsList() && !object->IsRange()
+                && ReadNumber(expr.rhs, expr.constant, index))
+            {
+                const Value::Array& array = object->AsList();
+                int size = static_cast<int>(array.size());
+                int position = static_cast<int>(index);
+                if (position < 0) {
+                    position += size;
+                }
+                if (position >= 0 && position < size) {
+                    ++expr.hits;
+                    return array[position];
+                }
+            }
+            break;
+        }
+        case Kind::AssignBinary: {
+            double x = 0;
+            double y = 0;
+            if (ReadNumber(expr.lhs, expr.constant, x) && ReadNumber(expr.rhs, expr.constant, y)) {
+                ++expr.hits;
+                Value result = ApplyNumbers(expr.operation, x, y);
+                if (expr.target.kind != LexicalAddress::Kind::Global) {
+                    env_->Set(expr.target, result);
+                } else {
+                    interpreter_->globals_.Set(expr.target.slot, result);
+                }
+                return result;
+            }
+            break;
+        }
+    }
 
-        int to = expr.to_s ?
-                static_cast<int>(std::get<double>(
-                interpreter_->ParseNode(*expr.to_s, env_).data))
-            :
-                size;
+    // Reading variables has no side effects, so the replaced subtree can
+    // simply run again; it also reports the errors.
+    ++expr.misses;
+    return interpreter_->ParseNode(*expr.original, env_);
+}
 
-        from = normalize_and_clamp(from, size);
-        to = normalize_and_clamp(to, size);
 
-        return Value(str->substr(from, to - from));
+Value* ExpressionEvaluator::Find(const LexicalAddress& address) const {
+    if (address.kind != LexicalAddress::Kind::Global) {
+        return env_->Find(address);
     }
+    return interpreter_->globals_.Find(address.slot);
+}
+
 
-    if (auto* array = std::get_if<Value::Array>(&object.data)) {
-        int size = static_cast<int>(array->size());
+// An unresolved address stands for the fused node's constant.
+bool ExpressionEvaluator::ReadNumber(const LexicalAddress& address
+                                , double constant, double& out) const
+{
+    if (address.kind == LexicalAddress::Kind::Unresolved) {
+        out = constant;
+        return true;
+    }
+    const Value* value = Find(address);
+    if (!value || !value->IsNumber()) {
+        return false;
+    }
+    out = value->AsNumber();
+    return true;
+}
 
-        int to = expr.to_s
-            ? static_cast<int>(std::get<double>(interpreter_->ParseNode(*expr.to_s, env_).data))
-            : size;
 
-        from = normalize_and_clamp(from, size);
-        to = normalize_and_clamp(to, size);
+// Decides a fused comparison of two numbers; false if the operands are not
+// numbers and the comparison has to run through the generic path.
+bool ExpressionEvaluator::TestFused(const FusedExpression& expr, bool& holds) const {
+    double x = 0;
+    double y = 0;
+    if (!ReadNumber(expr.lhs, expr.constant, x) || !ReadNumber(expr.rhs, expr.constant, y)) {
+        return false;
+    }
+    ++expr.hits;
+    holds = CompareNumbers(expr.operation, x, y);
+    return true;
+}
 
-        Value::Array result;
-        result.reserve(to - from);
 
-        for (int i = from; i < to; ++i) {
-            result.push_back(std::make_shared<Value>(*(*array)[i]));
-        }
+void DumpCallSiteStats(const std::vector<const CallableExpression*>& sites, std::ostream& out) {
+    struct Totals {
+        const char* name;
+        std::size_t sites = 0;
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+    };
+    std::array<Totals, 2> totals = {Totals{"builtin"}, Totals{"script"}};
 
-        return Value(result);
+    for (const auto* site : sites) {
+        auto& entry = totals[site->cache.native ? 0 : 1];
+        ++entry.sites;
+        entry.hits += site->cache.hits;
+        entry.misses += site->cache.misses;
     }
 
-    throw EvaluatorErrors(EvaluatorErrors::kInvalidSlice);
+    out << "call site       sites       calls  hit rate\n";
+    for (const auto& entry : totals) {
+        std::uint64_t calls = entry.hits + entry.misses;
+        out << std::left << std::setw(14) << entry.name << std::right
+            << std::setw(7) << entry.sites
+            << std::setw(12) << calls;
+        if (calls > 0) {
+            out << std::setw(9) << std::fixed << std::setprecision(1)
+                << 100.0 * static_cast<double>(entry.hits) / static_cast<double>(calls) << '%';
+        } else {
+            out << std::setw(10) << '-';
+        }
+        out << '\n';
+    }
 }
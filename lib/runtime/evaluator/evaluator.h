@@ -27,8 +27,29 @@ public:
     Value operator()(const AssignExpression&) const;
     Value operator()(const IndexExpression&) const;
     Value operator()(const SliceExpression&) const;
+    Value operator()(const IndexAssignExpression&) const;
+    Value operator()(const FusedExpression&) const;
+
+    bool Test(const Expression&) const;
+
+    // The function a call site calls, taken from the site's cache while the
+    // cache is valid; `cached` tells whether it was.
+    Value Callee(const CallableExpression&, bool& cached) const;
+
+private:
+    Value Apply(const BinaryExpression&, const Value&, const Value&) const;
+    Value ApplyQuickened(const BinaryExpression&, const Value&, const Value&) const;
+
+    Value* Find(const LexicalAddress&) const;
+    bool ReadNumber(const LexicalAddress&, double, double&) const;
+    bool TestFused(const FusedExpression&, bool&) const;
 
 private:
     Interpreter* interpreter_;
     Enviroment* env_;
 };
+
+
+// Per kind of cached callee, builtin or script function: how many call
+// sites ran, how many calls they made and how many found the cache valid.
+void DumpCallSiteStats(const std::vector<const CallableExpression*>&, std::ostream&);
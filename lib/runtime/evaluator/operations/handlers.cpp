@@ -1,28 +1,30 @@
+#include <algorithm>
+
 #include "handlers.h"
 
 
-constexpr double AsNumber(const Value& val) {
-    if (auto* num = std::get_if<double>(&val.data)) {
-        return *num;
+double AsNumber(const Value& val) {
+    if (val.IsNumber()) {
+        return val.AsNumber();
     }
-    if (auto* boolean = std::get_if<bool>(&val.data)) {
-        return *boolean ? 1.0 : 0.0;
+    if (val.IsBool()) {
+        return val.AsBool() ? 1.0 : 0.0;
     }
     throw EvaluatorErrors(EvaluatorErrors::kInvalidOperand);
 }
 
 
-constexpr bool IsTrue(const Value& val) {
-    if (auto* boolean = std::get_if<bool>(&val.data)) {
-        return *boolean;
+bool IsTrue(const Value& val) {
+    if (val.IsBool()) {
+        return val.AsBool();
     }
-    if (auto* num = std::get_if<double>(&val.data)) {
-        return *num != 0.0;
+    if (val.IsNumber()) {
+        return val.AsNumber() != 0.0;
     }
-    if (auto* str = std::get_if<std::string>(&val.data)) {
-        return !str->empty();
+    if (val.IsString()) {
+        return !val.AsString().empty();
     }
-    if (std::holds_alternative<NilType>(val.data)) {
+    if (val.IsNil()) {
         return false;
     }
     return true;
@@ -30,113 +32,202 @@ constexpr bool IsTrue(const Value& val) {
 
 
 Value Add(const Value& left, const Value& right) {
-    if (auto* str1 = std::get_if<std::string>(&left.data)) {
-        if (auto* str2 = std::get_if<std::string>(&right.data)) {
-            return Value(*str1 + *str2);
-        }
-    }
-    return Value(AsNumber(left) + AsNumber(right));
+    return OperationRegistry::Binary(BinaryOp::Add, left, right);
 }
 
 
-Value Substract(const Value& left, const Value& right) {
-    if (auto* str1 = std::get_if<std::string>(&left.data)) {
-        if (auto* str2 = std::get_if<std::string>(&right.data)) {
-            std::string result = *str1;
-            if (result.ends_with(*str2)) {
-                result.erase(result.size() - str2->size());
-            }
-            return Value(result);
+void AddInPlace(Value& target, const Value& right) {
+    if (target.IsString() && right.IsString()) {
+        target.AppendString(right.AsString());
+        return;
+    }
+    if (target.IsList() && right.IsList()) {
+        Value::Array& array = target.AsList();
+        const Value::Array& tail = right.AsList();
+        if (&array == &tail) {
+            Value::Array copy = tail;
+            array.insert(array.end(), copy.begin(), copy.end());
+        } else {
+            array.insert(array.end(), tail.begin(), tail.end());
         }
+        return;
     }
-
-    return Value(AsNumber(left) - AsNumber(right));
+    target = Add(target, right);
 }
 
 
-Value Multiply(const Value& left, const Value& right) {
-    if (auto* str = std::get_if<std::string>(&left.data)) {
-        int times = static_cast<int>(std::floor(AsNumber(right)));
-        std::string result;
-        result.reserve(str->size() * times);
-        for (int i = 0; i < times; ++i) {
-            result += *str;
-        }
-        return Value(result);
-    }
+Value Substract(const Value& left, const Value& right) {
+    return OperationRegistry::Binary(BinaryOp::Sub, left, right);
+}
 
-    if (auto* str = std::get_if<std::string>(&right.data)) {
-        int times = static_cast<int>(std::floor(AsNumber(left)));
-        std::string result;
-        result.reserve(str->size() * times);
-        for (int i = 0; i < times; ++i) {
-            result += *str;
-        }
-        return Value(result);
-    }
 
-    return Value(AsNumber(left) * AsNumber(right));
+Value Multiply(const Value& left, const Value& right) {
+    return OperationRegistry::Binary(BinaryOp::Mul, left, right);
 }
 
 
 Value Divide(const Value& left, const Value& right) {
-    return Value(AsNumber(left) / AsNumber(right));
+    return OperationRegistry::Binary(BinaryOp::Div, left, right);
 }
 
 
 Value Mod(const Value& left, const Value& right) {
-    return Value(std::fmod(AsNumber(left), AsNumber(right)));
+    return OperationRegistry::Binary(BinaryOp::Mod, left, right);
 }
 
 
 Value PowerOf(const Value& left, const Value& right) {
-    return Value(std::pow(AsNumber(left), AsNumber(right)));
+    return OperationRegistry::Binary(BinaryOp::Pow, left, right);
 }
 
 
 Value Less(const Value& left, const Value& right) {
-    return Compare(left, right, std::less{});
+    return OperationRegistry::Binary(BinaryOp::Lt, left, right);
 }
 
 
 Value LessEqual(const Value& left, const Value& right) {
-    return Compare(left, right, std::less_equal{});
+    return OperationRegistry::Binary(BinaryOp::Le, left, right);
 }
 
 
 Value Greater(const Value& left, const Value& right) {
-    return Compare(left, right, std::greater{});
+    return OperationRegistry::Binary(BinaryOp::Gt, left, right);
 }
 
 
 Value GreaterEqual(const Value& left, const Value& right) {
-    return Compare(left, right, std::greater_equal{});
+    return OperationRegistry::Binary(BinaryOp::Ge, left, right);
 }
 
 
 Value Negate(const Value& operand) {
-    return Value(-AsNumber(operand));
+    return OperationRegistry::Unary(UnaryOp::Neg, operand);
 }
 
 
 Value LogicalNot(const Value& operand) {
-    return Value(!IsTrue(operand));
+    return OperationRegistry::Unary(UnaryOp::Not, operand);
+}
+
+
+Value Index(const Value& object, const Value& index_value) {
+    int index = static_cast<int>(index_value.AsNumber());
+
+    auto normalize_index = [](int idx, int size) constexpr -> int {
+        return idx < 0 ? idx + size : idx;
+    };
+
+    if (object.IsString()) {
+        const std::string* str = &object.AsString();
+        int size = static_cast<int>(str->size());
+        int normalized_idx = normalize_index(index, size);
+
+        if (normalized_idx < 0 || normalized_idx >= size) {
+            throw EvaluatorErrors(EvaluatorErrors::kUndefinedVariable);
+        }
+
+        return Value(std::string(1, (*str)[normalized_idx]));
+    }
+
+    if (object.IsRange()) {
+        const Range* range = &object.AsRange();
+        int size = static_cast<int>(range->size);
+        int normalized_idx = normalize_index(index, size);
+
+        if (normalized_idx < 0 || normalized_idx >= size) {
+            throw EvaluatorErrors(EvaluatorErrors::kArrayIndexOutOfRange);
+        }
+
+        return Value(range->At(normalized_idx));
+    }
+
+    if (object.IsList()) {
+        const Value::Array* array = &object.AsList();
+        int size = static_cast<int>(array->size());
+        int normalized_idx = normalize_index(index, size);
+
+        if (normalized_idx < 0 || normalized_idx >= size) {
+            throw EvaluatorErrors(EvaluatorErrors::kArrayIndexOutOfRange);
+        }
+
+        return (*array)[normalized_idx];
+    }
+
+    throw EvaluatorErrors(EvaluatorErrors::kInvalidArrayIndex);
+}
+
+
+Value Slice(const Value& object, const Value* from_value, const Value* to_value) {
+    auto normalize_and_clamp = [](int idx, int size) constexpr -> int {
+        int normalized = idx < 0 ? idx + size : idx;
+        return std::clamp(normalized, 0, size);
+    };
+
+    auto bound = [](const Value* val, int fallback) -> int {
+        return val ? static_cast<int>(val->AsNumber()) : fallback;
+    };
+
+    if (object.IsString()) {
+        const std::string* str = &object.AsString();
+        int size = static_cast<int>(str->size());
+        int from = normalize_and_clamp(bound(from_value, 0), size);
+        int to = normalize_and_clamp(bound(to_value, size), size);
+
+        return Value(str->substr(from, to - from));
+    }
+
+    if (object.IsRange()) {
+        const Range* range = &object.AsRange();
+        int size = static_cast<int>(range->size);
+        int from = normalize_and_clamp(bound(from_value, 0), size);
+        int to = normalize_and_clamp(bound(to_value, size), size);
+
+        Range result = *range;
+        result.start = range->At(from);
+        result.size = static_cast<std::size_t>(std::max(to - from, 0));
+        return Value(result);
+    }
+
+    if (object.IsList()) {
+        const Value::Array* array = &object.AsList();
+        int size = static_cast<int>(array->size());
+        int from = normalize_and_clamp(bound(from_value, 0), size);
+        int to = normalize_and_clamp(bound(to_value, size), size);
+
+        Value::Array result;
+        result.reserve(to - from);
+
+        for (int i = from; i < to; ++i) {
+            result.push_back((*array)[i]);
+        }
+
+        return Value(std::move(result));
+    }
+
+    throw EvaluatorErrors(EvaluatorErrors::kInvalidSlice);
 }
 
 
-void Initialize() {
-    auto& registry = OperationRegistry::Get();
+// Lists are shared, so the element is replaced in the storage every
+// reference to `object` sees.
+Value SetIndex(const Value& object, const Value& index_value, const Value& value) {
+    if (!object.IsList()) {
+        throw EvaluatorErrors(EvaluatorErrors::kInvalidIndexAssignment);
+    }
+
+    Value::Array& array = object.AsList();
+    int size = static_cast<int>(array.size());
+    int index = static_cast<int>(index_value.AsNumber());
+    if (index < 0) {
+        index += size;
+    }
 
-    registry.AddBinary(TokenType::plus_, Add);
-    registry.AddBinary(TokenType::minus_, Substract);
-    registry.AddBinary(TokenType::star_, Multiply);
-    registry.AddBinary(TokenType::slash_, Divide);
-    registry.AddBinary(TokenType::percent_, Mod);
-    registry.AddBinary(TokenType::degree_, PowerOf);
-    registry.AddBinary(TokenType::less_, Less);
-    registry.AddBinary(TokenType::less_eq_, LessEqual);
-    registry.AddBinary(TokenType::greater_, Greater);
-    registry.AddBinary(TokenType::greater_eq_, GreaterEqual);
-    registry.AddUnary(TokenType::minus_, Negate);
-    registry.AddUnary(TokenType::not_, LogicalNot);
+    if (index < 0 || index >= size) {
+        throw EvaluatorErrors(EvaluatorErrors::kArrayIndexOutOfRange);
+    }
+
+    array[index] = value;
+    return value;
 }
+
@@ -1,16 +1,19 @@
 #pragma once
 
-#include <cmath>
 #include <runtime/evaluator/errors/ev_errors.h>
 #include <runtime/evaluator/operations/register.h>
 
 
-constexpr double AsNumber(const Value&);
+double AsNumber(const Value&);
 
-constexpr bool IsTrue(const Value&);
+bool IsTrue(const Value&);
 
 Value Add(const Value&, const Value&);
 
+// target += right. Strings and lists are extended in their existing buffer;
+// a list is updated for every alias of it.
+void AddInPlace(Value&, const Value&);
+
 Value Substract(const Value&, const Value&);
 
 Value Multiply(const Value&, const Value&);
@@ -21,17 +24,6 @@ Value Mod(const Value&, const Value&);
 
 Value PowerOf(const Value&, const Value&);
 
-
-template<typename Comparator>
-Value Compare(const Value& left, const Value& right, Comparator comp) {
-    if (auto* str1 = std::get_if<std::string>(&left.data)) {
-        if (auto* str2 = std::get_if<std::string>(&right.data)) {
-            return Value(comp(*str1, *str2));
-        }
-    }
-    return Value(comp(AsNumber(left), AsNumber(right)));
-}
-
 Value Less(const Value&, const Value&);
 
 Value LessEqual(const Value&, const Value&);
@@ -44,4 +36,8 @@ Value Negate(const Value&);
 
 Value LogicalNot(const Value&);
 
-void Initialize();
+Value Index(const Value&, const Value&);
+
+Value Slice(const Value&, const Value*, const Value*);
+
+Value SetIndex(const Value&, const Value&, const Value&);
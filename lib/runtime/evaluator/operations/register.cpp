@@ -1,38 +1,201 @@
-#include "errors/ev_errors.h"
+#include <utility>
+
 #include <runtime/evaluator/operations/register.h>
+#include <runtime/evaluator/operations/handlers.h>
+
+
+namespace {
+
+using Kind = Value::Kind;
+using BinaryHandler = OperationRegistry::BinaryHandler;
+using UnaryHandler = OperationRegistry::UnaryHandler;
 
 
-void OperationRegistry::AddBinary(TokenType op, BinaryHandler handler) {
-    binary_ops_[op] = std::move(handler);
+// Bools take part in arithmetic as 0 and 1.
+constexpr bool IsNumeric(Kind kind) {
+    return kind == Kind::Number || kind == Kind::Bool;
 }
 
 
-void OperationRegistry::AddUnary(TokenType op, UnaryHandler handler) {
-    unary_ops_[op] = std::move(handler);
+constexpr bool IsComparison(BinaryOp op) {
+    return op == BinaryOp::Lt || op == BinaryOp::Le
+        || op == BinaryOp::Gt || op == BinaryOp::Ge;
 }
 
 
-Value OperationRegistry::ExecuteBinary(TokenType op, const Value& left, const Value& right) const {
-    if (auto it = binary_ops_.find(op); it != binary_ops_.end()) {
-        return it->second(left, right);
+Value InvalidOperands(const Value&, const Value&) {
+    throw EvaluatorErrors(EvaluatorErrors::kInvalidOperand);
+}
+
+
+Value InvalidOperand(const Value&) {
+    throw EvaluatorErrors(EvaluatorErrors::kInvalidOperand);
+}
+
+
+template<BinaryOp Op>
+Value Numeric(const Value& left, const Value& right) {
+    return OperationRegistry::Binary(Op, Value(AsNumber(left)), Value(AsNumber(right)));
+}
+
+
+Value ConcatStrings(const Value& left, const Value& right) {
+    return Value(left.AsString() + right.AsString());
+}
+
+
+Value ConcatLists(const Value& left, const Value& right) {
+    const Value::Array& head = left.AsList();
+    const Value::Array& tail = right.AsList();
+    Value::Array result;
+    result.reserve(head.size() + tail.size());
+    result.insert(result.end(), head.begin(), head.end());
+    result.insert(result.end(), tail.begin(), tail.end());
+    return Value(std::move(result));
+}
+
+
+Value StripSuffix(const Value& left, const Value& right) {
+    std::string result = left.AsString();
+    const std::string& suffix = right.AsString();
+    if (result.ends_with(suffix)) {
+        result.erase(result.size() - suffix.size());
+    }
+    return Value(std::move(result));
+}
+
+
+template<bool StringOnLeft>
+Value RepeatString(const Value& left, const Value& right) {
+    const std::string& str = StringOnLeft ? left.AsString() : right.AsString();
+    double count = std::floor(AsNumber(StringOnLeft ? right : left));
+    std::size_t times = count > 0 ? static_cast<std::size_t>(count) : 0;
+
+    std::string result;
+    result.reserve(str.size() * times);
+    for (std::size_t i = 0; i < times; ++i) {
+        result += str;
+    }
+    return Value(std::move(result));
+}
+
+
+template<BinaryOp Op>
+Value CompareStrings(const Value& left, const Value& right) {
+    const std::string& x = left.AsString();
+    const std::string& y = right.AsString();
+    if constexpr (Op == BinaryOp::Lt) {
+        return Value(x < y);
+    } else if constexpr (Op == BinaryOp::Le) {
+        return Value(x <= y);
+    } else if constexpr (Op == BinaryOp::Gt) {
+        return Value(x > y);
+    } else {
+        return Value(x >= y);
+    }
+}
+
+
+Value NegateNumeric(const Value& operand) {
+    return Value(-AsNumber(operand));
+}
+
+
+Value Not(const Value& operand) {
+    return Value(!IsTrue(operand));
+}
+
+
+template<BinaryOp Op, Kind Left, Kind Right>
+constexpr BinaryHandler SelectBinary() {
+    constexpr bool strings = Left == Kind::String && Right == Kind::String;
+
+    if constexpr (IsNumeric(Left) && IsNumeric(Right)) {
+        return Numeric<Op>;
+    } else if constexpr (Op == BinaryOp::Add && strings) {
+        return ConcatStrings;
+    } else if constexpr (Op == BinaryOp::Add && Left == Kind::List && Right == Kind::List) {
+        return ConcatLists;
+    } else if constexpr (Op == BinaryOp::Sub && strings) {
+        return StripSuffix;
+    } else if constexpr (Op == BinaryOp::Mul && Left == Kind::String && IsNumeric(Right)) {
+        return RepeatString<true>;
+    } else if constexpr (Op == BinaryOp::Mul && IsNumeric(Left) && Right == Kind::String) {
+        return RepeatString<false>;
+    } else if constexpr (IsComparison(Op) && strings) {
+        return CompareStrings<Op>;
+    } else {
+        return InvalidOperands;
+    }
+}
+
+
+template<UnaryOp Op, Kind Operand>
+constexpr UnaryHandler SelectUnary() {
+    if constexpr (Op == UnaryOp::Not) {
+        return Not;
+    } else if constexpr (IsNumeric(Operand)) {
+        return NegateNumeric;
+    } else {
+        return InvalidOperand;
+    }
+}
+
+
+// Entry I of the flattened table is the operator I / kKindCount^2 applied to
+// the kinds (I / kKindCount) % kKindCount and I % kKindCount.
+template<std::size_t... I>
+constexpr OperationRegistry::BinaryTable MakeBinaryTable(std::index_sequence<I...>) {
+    constexpr std::size_t kPairs = kKindCount * kKindCount;
+    OperationRegistry::BinaryTable table{};
+    ((table[I / kPairs][I / kKindCount % kKindCount][I % kKindCount] = SelectBinary<
+        static_cast<BinaryOp>(I / kPairs),
+        static_cast<Kind>(I / kKindCount % kKindCount),
+        static_cast<Kind>(I % kKindCount)>()), ...);
+    return table;
+}
+
+
+template<std::size_t... I>
+constexpr OperationRegistry::UnaryTable MakeUnaryTable(std::index_sequence<I...>) {
+    OperationRegistry::UnaryTable table{};
+    ((table[I / kKindCount][I % kKindCount] = SelectUnary<
+        static_cast<UnaryOp>(I / kKindCount),
+        static_cast<Kind>(I % kKindCount)>()), ...);
+    return table;
+}
+
+} // namespace
+
+
+constinit const OperationRegistry::BinaryTable OperationRegistry::kBinaryTable =
+    MakeBinaryTable(std::make_index_sequence<kBinaryOpCount * kKindCount * kKindCount>{});
+
+constinit const OperationRegistry::UnaryTable OperationRegistry::kUnaryTable =
+    MakeUnaryTable(std::make_index_sequence<kUnaryOpCount * kKindCount>{});
+
+
+Value OperationRegistry::ExecuteBinary(TokenType op, const Value& left, const Value& right) {
+    if (auto binary = ToBinary(op)) {
+        return Binary(*binary, left, right);
     }
     throw EvaluatorErrors(EvaluatorErrors::kUnsupportedBinaryOperation);
 }
 
 
-Value OperationRegistry::ExecuteUnary(TokenType op, const Value& operand) const {
-    if (auto it = unary_ops_.find(op); it != unary_ops_.end()) {
-        return it->second(operand);
+Value OperationRegistry::ExecuteUnary(TokenType op, const Value& operand) {
+    if (auto unary = ToUnary(op)) {
+        return Unary(*unary, operand);
     }
     throw EvaluatorErrors(EvaluatorErrors::kUnsupportedBinaryOperation);
 }
 
 
-bool OperationRegistry::SupportsBinary(TokenType op) const {
-    return binary_ops_.contains(op);
+bool OperationRegistry::SupportsBinary(TokenType op) {
+    return ToBinary(op).has_value();
 }
 
 
-bool OperationRegistry::SupportsUnary(TokenType op) const {
-    return unary_ops_.contains(op);
+bool OperationRegistry::SupportsUnary(TokenType op) {
+    return ToUnary(op).has_value();
 }
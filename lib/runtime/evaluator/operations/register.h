@@ -1,35 +1,125 @@
 #pragma once
 
-#include <functional>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <optional>
 
 #include <runtime/value/value.h>
 #include <runtime/evaluator/errors/ev_errors.h>
 #include <token/token.h>
 
 
+enum class BinaryOp : std::uint8_t {
+    Add, Sub, Mul, Div, Mod, Pow, Lt, Le, Gt, Ge
+};
+
+enum class UnaryOp : std::uint8_t {
+    Neg, Not
+};
+
+inline constexpr std::size_t kBinaryOpCount = static_cast<std::size_t>(BinaryOp::Ge) + 1;
+inline constexpr std::size_t kUnaryOpCount = static_cast<std::size_t>(UnaryOp::Not) + 1;
+inline constexpr std::size_t kKindCount = static_cast<std::size_t>(Value::Kind::Function) + 1;
+
+
+// Operators are dispatched through tables generated at compile time and
+// indexed by the operator and the kinds of its operands, so every type pair
+// lands directly in the handler written for it. Two numbers never reach the
+// tables at all.
 class OperationRegistry {
 public:
-    using BinaryHandler = std::function<Value(const Value&, const Value&)>;
-    using UnaryHandler = std::function<Value(const Value&)>;
+    using BinaryHandler = Value (*)(const Value&, const Value&);
+    using UnaryHandler = Value (*)(const Value&);
 
-    static OperationRegistry& Get() {
-        static OperationRegistry instance;
-        return instance;
-    }
+    using BinaryTable = std::array<std::array<std::array<BinaryHandler, kKindCount>, kKindCount>, kBinaryOpCount>;
+    using UnaryTable = std::array<std::array<UnaryHandler, kKindCount>, kUnaryOpCount>;
+
+    static std::optional<BinaryOp> ToBinary(TokenType);
+
+    static std::optional<UnaryOp> ToUnary(TokenType);
 
-    void AddBinary(TokenType, BinaryHandler);
+    static Value Binary(BinaryOp, const Value&, const Value&);
 
-    void AddUnary(TokenType, UnaryHandler);
+    static Value Unary(UnaryOp, const Value&);
 
-    Value ExecuteBinary(TokenType, const Value&, const Value&) const;
+    // The handler the table holds for this operator and pair of kinds.
+    static BinaryHandler Lookup(BinaryOp, Value::Kind, Value::Kind);
 
-    Value ExecuteUnary(TokenType, const Value&) const;
+    static Value ExecuteBinary(TokenType, const Value&, const Value&);
 
-    bool SupportsBinary(TokenType) const;
+    static Value ExecuteUnary(TokenType, const Value&);
 
-    bool SupportsUnary(TokenType) const;
+    static bool SupportsBinary(TokenType);
+
+    static bool SupportsUnary(TokenType);
 
 private:
-    std::unordered_map<TokenType, BinaryHandler> binary_ops_;
-    std::unordered_map<TokenType, UnaryHandler> unary_ops_;
+    static const BinaryTable kBinaryTable;
+    static const UnaryTable kUnaryTable;
 };
+
+
+inline std::optional<BinaryOp> OperationRegistry::ToBinary(TokenType op) {
+    switch (op) {
+        case TokenType::plus_: return BinaryOp::Add;
+        case TokenType::minus_: return BinaryOp::Sub;
+        case TokenType::star_: return BinaryOp::Mul;
+        case TokenType::slash_: return BinaryOp::Div;
+        case TokenType::percent_: return BinaryOp::Mod;
+        case TokenType::degree_: return BinaryOp::Pow;
+        case TokenType::less_: return BinaryOp::Lt;
+        case TokenType::less_eq_: return BinaryOp::Le;
+        case TokenType::greater_: return BinaryOp::Gt;
+        case TokenType::greater_eq_: return BinaryOp::Ge;
+        default: return std::nullopt;
+    }
+}
+
+
+inline std::optional<UnaryOp> OperationRegistry::ToUnary(TokenType op) {
+    switch (op) {
+        case TokenType::minus_: return UnaryOp::Neg;
+        case TokenType::not_: return UnaryOp::Not;
+        default: return std::nullopt;
+    }
+}
+
+
+inline Value OperationRegistry::Binary(BinaryOp op, const Value& left, const Value& right) {
+    if (left.IsNumber() && right.IsNumber()) {
+        double x = left.AsNumber();
+        double y = right.AsNumber();
+        switch (op) {
+            case BinaryOp::Add: return Value(x + y);
+            case BinaryOp::Sub: return Value(x - y);
+            case BinaryOp::Mul: return Value(x * y);
+            case BinaryOp::Div: return Value(x / y);
+            case BinaryOp::Mod: return Value(std::fmod(x, y));
+            case BinaryOp::Pow: return Value(std::pow(x, y));
+            case BinaryOp::Lt: return Value(x < y);
+            case BinaryOp::Le: return Value(x <= y);
+            case BinaryOp::Gt: return Value(x > y);
+            case BinaryOp::Ge: return Value(x >= y);
+        }
+    }
+    return Lookup(op, left.GetKind(), right.GetKind())(left, right);
+}
+
+
+inline Value OperationRegistry::Unary(UnaryOp op, const Value& operand) {
+    if (op == UnaryOp::Neg && operand.IsNumber()) {
+        return Value(-operand.AsNumber());
+    }
+    auto kind = static_cast<std::size_t>(operand.GetKind());
+    return kUnaryTable[static_cast<std::size_t>(op)][kind](operand);
+}
+
+
+inline OperationRegistry::BinaryHandler OperationRegistry::Lookup(BinaryOp op
+                                    , Value::Kind left, Value::Kind right)
+{
+    return kBinaryTable[static_cast<std::size_t>(op)]
+                       [static_cast<std::size_t>(left)]
+                       [static_cast<std::size_t>(right)];
+}
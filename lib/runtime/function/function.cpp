@@ -3,10 +3,10 @@
 
 FunctionalObject::FunctionalObject(std::vector<std::string> params
                                 , const std::vector<Statement>* body
-                                , Enviroment* clsr)
+                                , std::vector<Cell> captured)
     : parameters(std::move(params))
     , f_body(body)
-    , closure(clsr)
+    , upvalues(std::move(captured))
     , native(nullptr)
 {}
 
@@ -14,6 +14,13 @@ FunctionalObject::FunctionalObject(std::vector<std::string> params
 FunctionalObject::FunctionalObject(NativeFn fn)
     : parameters()
     , f_body(nullptr)
-    , closure(nullptr)
     , native(std::move(fn))
 {}
+
+
+FunctionalObject::FunctionalObject(std::shared_ptr<CompiledClosure> clsr)
+    : parameters()
+    , f_body(nullptr)
+    , native(nullptr)
+    , compiled(std::move(clsr))
+{}
@@ -1,28 +1,51 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <span>
 #include <vector>
 #include <string>
 
 #include <runtime/value/value.h>
 #include <vls_and_sttmnts.h>
-#include <runtime/function/errors/func_errors.h>
 
 
-class Enviroment;
+struct CompiledClosure;
+
+class JitFunction;
 
 
 struct FunctionalObject {
-    using NativeFn = std::function<Value(const std::vector<Value>&)>;
+    // Arguments are passed as a view, usually of the interpreter's value
+    // stack; a callee that keeps them must copy them.
+    using Arguments = std::span<const Value>;
+    using NativeFn = std::function<Value(Arguments)>;
+    // A variable some function captures, shared by the scope that declares
+    // it and the functions that capture it, so that it outlives the scope.
+    // Empty until the variable is assigned.
+    using Cell = std::shared_ptr<std::optional<Value>>;
 
     std::vector<std::string> parameters;
     const std::vector<Statement>* f_body;
-    Enviroment* closure;
+    // The variables of enclosing functions the body uses, in the order of
+    // FunctionExpression::captures.
+    std::vector<Cell> upvalues;
+    // Slots of the function's own scope, parameters included.
+    std::size_t slots = 0;
     NativeFn native;
+    std::shared_ptr<CompiledClosure> compiled;
+    // Calls counted by the tree-walker, and the native code it compiled once
+    // the function got hot.
+    std::uint32_t calls = 0;
+    std::shared_ptr<JitFunction> jit;
 
     FunctionalObject(std::vector<std::string>
                     , const std::vector<Statement>*
-                    , Enviroment*);
+                    , std::vector<Cell> upvalues);
 
     FunctionalObject(NativeFn fn);
+
+    FunctionalObject(std::shared_ptr<CompiledClosure>);
 };
@@ -0,0 +1,276 @@
+#include <array>
+#include <iomanip>
+#include <optional>
+
+#include <runtime/fusion/fusion.h>
+
+
+namespace {
+
+// A variable or number literal as an operand of a fused node; a literal
+// leaves the address unresolved.
+struct Operand {
+    LexicalAddress address;
+    double constant = 0;
+};
+
+
+bool IsResolved(const LexicalAddress& address) {
+    return address.kind != LexicalAddress::Kind::Unresolved;
+}
+
+
+bool SameAddress(const LexicalAddress& a, const LexicalAddress& b) {
+    return a.kind == b.kind && a.depth == b.depth && a.slot == b.slot;
+}
+
+
+const LexicalAddress* VariableAddress(const Expression& expr) {
+    auto* var = std::get_if<VariableExpression>(&expr.value);
+    return var && IsResolved(var->address) ? &var->address : nullptr;
+}
+
+
+std::optional<Operand> AsOperand(const Expression& expr) {
+    if (auto* address = VariableAddress(expr)) {
+        return Operand{*address};
+    }
+    if (auto* number = std::get_if<NumberExpression>(&expr.value)) {
+        return Operand{LexicalAddress{}, number->value};
+    }
+    return std::nullopt;
+}
+
+
+bool IsArithmetic(TokenType op) {
+    switch (op) {
+        case TokenType::plus_:
+        case TokenType::minus_:
+        case TokenType::star_:
+        case TokenType::slash_:
+        case TokenType::percent_:
+        case TokenType::degree_:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+bool IsComparison(TokenType op) {
+    switch (op) {
+        case TokenType::double_eq_:
+        case TokenType::not_eq_:
+        case TokenType::less_:
+        case TokenType::less_eq_:
+        case TokenType::greater_:
+        case TokenType::greater_eq_:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+// Two operands of which at most one is a literal, which becomes the
+// constant of the fused node.
+struct Operands {
+    LexicalAddress lhs;
+    LexicalAddress rhs;
+    double constant = 0;
+};
+
+
+std::optional<Operands> AsOperands(const Expression& lhs, const Expression& rhs) {
+    auto left = AsOperand(lhs);
+    auto right = AsOperand(rhs);
+    if (!left || !right || (!IsResolved(left->address) && !IsResolved(right->address))) {
+        return std::nullopt;
+    }
+    double constant = IsResolved(left->address) ? right->constant : left->constant;
+    return Operands{left->address, right->address, constant};
+}
+
+
+std::optional<FusedExpression> Match(const Expression& expr) {
+    using Kind = FusedExpression::Kind;
+
+    if (auto* binary = std::get_if<BinaryExpression>(&expr.value)) {
+        if (!IsComparison(binary->operation)) {
+            return std::nullopt;
+        }
+        if (auto operands = AsOperands(*binary->lhs, *binary->rhs)) {
+            return FusedExpression{Kind::Compare, binary->operation, {}
+                , operands->lhs, operands->rhs, operands->constant};
+        }
+        return std::nullopt;
+    }
+
+    if (auto* index = std::get_if<IndexExpression>(&expr.value)) {
+        auto* object = VariableAddress(*index->object);
+        auto position = AsOperand(*index->index);
+        if (object && position) {
+            return FusedExpression{Kind::Index, TokenType::l_bracket_, {}
+                , *object, position->address, position->constant};
+        }
+        return std::nullopt;
+    }
+
+    auto* assign = std::get_if<AssignExpression>(&expr.value);
+    if (!assign || !IsResolved(assign->address)) {
+        return std::nullopt;
+    }
+
+    if (assign->operation == TokenType::plus_eq_ || assign->operation == TokenType::minus_eq_) {
+        if (auto* number = std::get_if<NumberExpression>(&assign->rhs->value)) {
+            return FusedExpression{Kind::Increment, CompoundBaseOperation(assign->operation)
+                , assign->address, {}, {}, number->value};
+        }
+        return std::nullopt;
+    }
+
+    auto* binary = std::get_if<BinaryExpression>(&assign->rhs->value);
+    if (assign->operation != TokenType::assign_ || !binary || !IsArithmetic(binary->operation)) {
+        return std::nullopt;
+    }
+
+    auto* self = VariableAddress(*binary->lhs);
+    auto* step = std::get_if<NumberExpression>(&binary->rhs->value);
+    bool additive = binary->operation == TokenType::plus_ || binary->operation == TokenType::minus_;
+    if (additive && self && step && SameAddress(*self, assign->address)) {
+        return FusedExpression{Kind::Increment, binary->operation
+            , assign->address, {}, {}, step->value};
+    }
+
+    if (auto operands = AsOperands(*binary->lhs, *binary->rhs)) {
+        return FusedExpression{Kind::AssignBinary, binary->operation
+            , assign->address, operands->lhs, operands->rhs, operands->constant};
+    }
+    return std::nullopt;
+}
+
+
+constexpr std::array<const char*, 4> kKindNames = {
+    "increment", "compare", "index", "assign-binary"
+};
+
+} // namespace
+
+
+void FusionPass::Run(std::vector<Statement>& program) {
+    for (auto& stmt : program) {
+        Visit(stmt);
+    }
+}
+
+
+const std::vector<const FusedExpression*>& FusionPass::Fused() const {
+    return fused_;
+}
+
+
+void FusionPass::Visit(Statement& stmt) {
+    std::visit([this](auto& node) {
+        using T = std::decay_t<decltype(node)>;
+
+        if constexpr (std::is_same_v<T, ExpressionStatement>) {
+            Visit(node.expression);
+        } else if constexpr (std::is_same_v<T, IfStatement>) {
+            Visit(node.condition);
+            for (auto& child : node.then_case) { Visit(child); }
+            for (auto& child : node.else_case) { Visit(child); }
+        } else if constexpr (std::is_same_v<T, WhileStatement>) {
+            Visit(node.condition);
+            for (auto& child : node.body) { Visit(child); }
+        } else if constexpr (std::is_same_v<T, ForStatement>) {
+            Visit(node.iter);
+            for (auto& child : node.body) { Visit(child); }
+        } else if constexpr (std::is_same_v<T, ReturnStatement>) {
+            if (node.value) { Visit(*node.value); }
+        } else if constexpr (std::is_same_v<T, BlockStatement>) {
+            for (auto& child : node.statements) { Visit(child); }
+        }
+    }, stmt.value);
+}
+
+
+// Children are fused first; a node is only fused when its operands are
+// plain variables and literals, so it never contains a fused node itself.
+void FusionPass::Visit(Expression& expr) {
+    std::visit([this](auto& node) {
+        using T = std::decay_t<decltype(node)>;
+
+        if constexpr (std::is_same_v<T, UnaryExpression>) {
+            Visit(*node.rhs);
+        } else if constexpr (std::is_same_v<T, BinaryExpression>) {
+            Visit(*node.lhs);
+            Visit(*node.rhs);
+        } else if constexpr (std::is_same_v<T, CallableExpression>) {
+            Visit(*node.callable);
+            for (auto& arg : node.f_arguments) { Visit(*arg); }
+        } else if constexpr (std::is_same_v<T, ListExpression>) {
+            for (auto& element : node.elements) { Visit(*element); }
+        } else if constexpr (std::is_same_v<T, FunctionExpression>) {
+            for (auto& stmt : node.f_body) { Visit(stmt); }
+        } else if constexpr (std::is_same_v<T, AssignExpression>) {
+            Visit(*node.rhs);
+        } else if constexpr (std::is_same_v<T, IndexExpression>) {
+            Visit(*node.object);
+            Visit(*node.index);
+        } else if constexpr (std::is_same_v<T, SliceExpression>) {
+            Visit(*node.object);
+            if (node.from_s) { Visit(*node.from_s); }
+            if (node.to_s) { Visit(*node.to_s); }
+        } else if constexpr (std::is_same_v<T, IndexAssignExpression>) {
+            Visit(*node.object);
+            Visit(*node.index);
+            Visit(*node.rhs);
+        }
+    }, expr.value);
+
+    Fuse(expr);
+}
+
+
+void FusionPass::Fuse(Expression& expr) {
+    auto fused = Match(expr);
+    if (!fused) {
+        return;
+    }
+    fused->original = std::make_unique<Expression>(std::move(expr));
+    expr.value = std::move(*fused);
+    fused_.push_back(&std::get<FusedExpression>(expr.value));
+}
+
+
+void DumpFusionStats(const std::vector<const FusedExpression*>& fused, std::ostream& out) {
+    struct Totals {
+        std::size_t sites = 0;
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+    };
+    std::array<Totals, kKindNames.size()> totals;
+
+    for (const auto* node : fused) {
+        auto& entry = totals[static_cast<std::size_t>(node->kind)];
+        ++entry.sites;
+        entry.hits += node->hits;
+        entry.misses += node->misses;
+    }
+
+    out << "fused node      sites        runs  hit rate\n";
+    for (std::size_t i = 0; i < totals.size(); ++i) {
+        const auto& entry = totals[i];
+        std::uint64_t runs = entry.hits + entry.misses;
+        out << std::left << std::setw(14) << kKindNames[i] << std::right
+            << std::setw(7) << entry.sites
+            << std::setw(12) << runs;
+        if (runs > 0) {
+            out << std::setw(9) << std::fixed << std::setprecision(1)
+                << 100.0 * static_cast<double>(entry.hits) / static_cast<double>(runs) << '%';
+        } else {
+            out << std::setw(10) << '-';
+        }
+        out << '\n';
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include <vls_and_sttmnts.h>
+
+
+// Rewrites common idioms of a program into FusedExpression nodes, which the
+// tree-walker runs in one step. It relies on the addresses SemanticAnalizer
+// assigns, so it runs after analysis and before execution.
+class FusionPass {
+public:
+    void Run(std::vector<Statement>&);
+
+    const std::vector<const FusedExpression*>& Fused() const;
+
+private:
+    void Visit(Statement&);
+    void Visit(Expression&);
+    void Fuse(Expression&);
+
+private:
+    std::vector<const FusedExpression*> fused_;
+};
+
+
+// Per kind of fused node: how many were created, how often they ran and
+// how often their operands had the types the fused path handles.
+void DumpFusionStats(const std::vector<const FusedExpression*>&, std::ostream&);
@@ -9,7 +9,7 @@
 #include <runtime/interpreter/builtins/errors/bltns_errors.h>
 
 
-void BuiltinRegistry::RegisterAll(Enviroment& globals
+void BuiltinRegistry::RegisterAll(GlobalTable& globals
         , std::ostream& output, std::istream& input)
 {
     RegisterIOFunctions(globals, output, input);
@@ -21,7 +21,7 @@ void BuiltinRegistry::RegisterAll(Enviroment& globals
 }
 
 
-void BuiltinRegistry::CheckArgumentCount(const std::vector<Value>& args
+void BuiltinRegistry::CheckArgumentCount(FunctionalObject::Arguments args
                     , std::size_t expected, const std::string& func_name)
 {
     if (args.size() != expected) {
@@ -34,7 +34,7 @@ void BuiltinRegistry::CheckArgumentCount(const std::vector<Value>& args
 }
 
 
-void BuiltinRegistry::CheckMinArgumentCount(const std::vector<Value>& args
+void BuiltinRegistry::CheckMinArgumentCount(FunctionalObject::Arguments args
                         , std::size_t min_count, const std::string& func_name)
 {
     if (args.size() < min_count) {
@@ -50,8 +50,8 @@ void BuiltinRegistry::CheckMinArgumentCount(const std::vector<Value>& args
 double BuiltinRegistry::ExtractNumber(const Value& val
                         , const std::string& func_name)
 {
-    if (auto* num = std::get_if<double>(&val.data)) {
-        return *num;
+    if (val.IsNumber()) {
+        return val.AsNumber();
     }
     throw BuiltinError(func_name
         + BuiltinError::kExpectedNumericArgument
@@ -62,8 +62,8 @@ double BuiltinRegistry::ExtractNumber(const Value& val
 std::string BuiltinRegistry::ExtractString(const Value& val
                         , const std::string& func_name)
 {
-    if (auto* str = std::get_if<std::string>(&val.data)) {
-        return *str;
+    if (val.IsString()) {
+        return val.AsString();
     }
     throw BuiltinError(func_name
         + BuiltinError::kExpectedStringArgument
@@ -71,11 +71,11 @@ std::string BuiltinRegistry::ExtractString(const Value& val
 }
 
 
-Value::Array BuiltinRegistry::ExtractArray(const Value& val
+Value::Array& BuiltinRegistry::ExtractArray(const Value& val
                             , const std::string& func_name)
 {
-    if (auto* arr = std::get_if<Value::Array>(&val.data)) {
-        return *arr;
+    if (val.IsList()) {
+        return val.AsList();
     }
     throw BuiltinError(func_name
         + BuiltinError::kExpectedArrayArgument
@@ -89,9 +89,9 @@ Value BuiltinRegistry::CreateStringArray(const
     Value::Array result;
     result.reserve(strings.size());
     for (const auto& str : strings) {
-        result.push_back(std::make_shared<Value>(str));
+        result.emplace_back(str);
     }
-    return Value(result);
+    return Value(std::move(result));
 }
 
 
@@ -102,38 +102,39 @@ void BuiltinRegistry::Register(const std::string& name
 }
 
 
-void BuiltinRegistry::AddToEnvironment(Enviroment& env
+void BuiltinRegistry::AddToEnvironment(GlobalTable& globals
                             , const std::string& name)
 {
     auto func_obj = std::make_shared<FunctionalObject>(functions_[name]);
-    env.Define(name, Value(func_obj));
+    globals.Define(name, Value(func_obj));
 }
 
 
-void BuiltinRegistry::RegisterIOFunctions(Enviroment& globals
+void BuiltinRegistry::RegisterIOFunctions(GlobalTable& globals
                 , std::ostream& output, std::istream& input)
 {
-    Register("print", [&output](const std::vector<Value>& args) -> Value
+    Register("print", [&output](FunctionalObject::Arguments args) -> Value
     {
         if (!args.empty()) {
-            const auto& v = args[0].data;
-            if (auto* num = std::get_if<double>(&v)) {
-                double d = *num;
+            const Value& v = args[0];
+            if (v.IsNumber()) {
+                double d = v.AsNumber();
                 if (d == static_cast<int64_t>(d)) {
                     output << static_cast<int64_t>(d);
                 } else {
                     output << d;
                 }
             }
-            else if (auto* str = std::get_if<std::string>(&v)) {
-                if (str->find(' ') != std::string::npos) {
-                    output << '"' << *str << '"';
+            else if (v.IsString()) {
+                const std::string& str = v.AsString();
+                if (str.find(' ') != std::string::npos) {
+                    output << '"' << str << '"';
                 } else {
-                    output << *str;
+                    output << str;
                 }
             }
-            else if (auto* boolean = std::get_if<bool>(&v)) {
-                output << (*boolean ? "true" : "false");
+            else if (v.IsBool()) {
+                output << (v.AsBool() ? "true" : "false");
             }
             else {
                 output << "nil";
@@ -143,7 +144,7 @@ void BuiltinRegistry::RegisterIOFunctions(Enviroment& globals
     });
     AddToEnvironment(globals, "print");
 
-    Register("println", [&output, this](const std::vector<Value>& args) -> Value
+    Register("println", [&output, this](FunctionalObject::Arguments args) -> Value
     {
         functions_["print"](args);
         output << '\n';
@@ -151,7 +152,7 @@ void BuiltinRegistry::RegisterIOFunctions(Enviroment& globals
     });
     AddToEnvironment(globals, "println");
 
-    Register("read", [&input](const std::vector<Value>& args) -> Value {
+    Register("read", [&input](FunctionalObject::Arguments args) -> Value {
         std::string line;
         if (std::getline(input, line)) {
             return Value(line);
@@ -162,40 +163,43 @@ void BuiltinRegistry::RegisterIOFunctions(Enviroment& globals
 }
 
 
-void BuiltinRegistry::RegisterUtilityFunctions(Enviroment& globals) {
-    Register("len", [this](const std::vector<Value>& args) -> Value
+void BuiltinRegistry::RegisterUtilityFunctions(GlobalTable& globals) {
+    Register("len", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 1, "len");
-        const auto& val = args[0].data;
-        if (auto* str = std::get_if<std::string>(&val)) {
-            return Value(static_cast<double>(str->size()));
+        const Value& val = args[0];
+        if (val.IsString()) {
+            return Value(static_cast<double>(val.AsString().size()));
         }
-        if (auto* array = std::get_if<Value::Array>(&val)) {
-            return Value(static_cast<double>(array->size()));
+        if (val.IsRange()) {
+            return Value(static_cast<double>(val.AsRange().size));
+        }
+        if (val.IsList()) {
+            return Value(static_cast<double>(val.AsList().size()));
         }
         throw BuiltinError(BuiltinError::kArgumentMustBeStringOrArray);
     });
     AddToEnvironment(globals, "len");
 
-    Register("type", [this](const std::vector<Value>& args) -> Value
+    Register("type", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 1, "type");
 
-        const auto& val = args[0].data;
-        if (std::holds_alternative<double>(val)) { return Value("number"); }
-        if (std::holds_alternative<std::string>(val)) { return Value("string"); }
-        if (std::holds_alternative<bool>(val)) { return Value("boolean"); }
-        if (std::holds_alternative<NilType>(val)) { return Value("nil"); }
-        if (std::holds_alternative<Value::Array>(val)) { return Value("array"); }
-        if (std::holds_alternative<Value::FuncPtr>(val)) { return Value("function"); }
+        const Value& val = args[0];
+        if (val.IsNumber()) { return Value("number"); }
+        if (val.IsString()) { return Value("string"); }
+        if (val.IsBool()) { return Value("boolean"); }
+        if (val.IsNil()) { return Value("nil"); }
+        if (val.IsList()) { return Value("array"); }
+        if (val.IsFunction()) { return Value("function"); }
         return Value("unknown");
     });
     AddToEnvironment(globals, "type");
 }
 
 
-void BuiltinRegistry::RegisterMathFunctions(Enviroment& globals) {
-    Register("abs", [this](const std::vector<Value>& args) -> Value
+void BuiltinRegistry::RegisterMathFunctions(GlobalTable& globals) {
+    Register("abs", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 1, "abs");
         double val = ExtractNumber(args[0], "abs");
@@ -203,7 +207,7 @@ void BuiltinRegistry::RegisterMathFunctions(Enviroment& globals) {
     });
     AddToEnvironment(globals, "abs");
 
-    Register("ceil", [this](const std::vector<Value>& args) -> Value
+    Register("ceil", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 1, "ceil");
         double val = ExtractNumber(args[0], "ceil");
@@ -211,7 +215,7 @@ void BuiltinRegistry::RegisterMathFunctions(Enviroment& globals) {
     });
     AddToEnvironment(globals, "ceil");
 
-    Register("floor", [this](const std::vector<Value>& args) -> Value
+    Register("floor", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 1, "floor");
         double val = ExtractNumber(args[0], "floor");
@@ -219,7 +223,7 @@ void BuiltinRegistry::RegisterMathFunctions(Enviroment& globals) {
     });
     AddToEnvironment(globals, "floor");
 
-    Register("round", [this](const std::vector<Value>& args) -> Value
+    Register("round", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 1, "round");
         double val = ExtractNumber(args[0], "round");
@@ -227,7 +231,7 @@ void BuiltinRegistry::RegisterMathFunctions(Enviroment& globals) {
     });
     AddToEnvironment(globals, "round");
 
-    Register("rnd", [this](const std::vector<Value>& args) -> Value {
+    Register("rnd", [this](FunctionalObject::Arguments args) -> Value {
         CheckArgumentCount(args, 1, "rnd");
         int n = static_cast<int>(ExtractNumber(args[0], "rnd"));
         if (n <= 0) {
@@ -240,7 +244,7 @@ void BuiltinRegistry::RegisterMathFunctions(Enviroment& globals) {
         return Value(static_cast<double>(dis(gen)));
     });
 
-    Register("sqrt", [this](const std::vector<Value>& args) -> Value
+    Register("sqrt", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 1, "sqrt");
         double val = ExtractNumber(args[0], "sqrt");
@@ -251,7 +255,7 @@ void BuiltinRegistry::RegisterMathFunctions(Enviroment& globals) {
     });
     AddToEnvironment(globals, "sqrt");
 
-    Register("parse_num", [this](const std::vector<Value>& args) -> Value
+    Register("parse_num", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 1, "parse_num");
         const std::string& str = ExtractString(args[0], "parse_num");
@@ -264,7 +268,7 @@ void BuiltinRegistry::RegisterMathFunctions(Enviroment& globals) {
     });
     AddToEnvironment(globals, "parse_num");
 
-    Register("to_string", [this](const std::vector<Value>& args) -> Value
+    Register("to_string", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 1, "to_string");
         double val = ExtractNumber(args[0], "to_string");
@@ -275,7 +279,7 @@ void BuiltinRegistry::RegisterMathFunctions(Enviroment& globals) {
     });
     AddToEnvironment(globals, "to_string");
 
-    Register("min", [this](const std::vector<Value>& args) -> Value
+    Register("min", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckMinArgumentCount(args, 2, "min");
         double min_val = ExtractNumber(args[0], "min");
@@ -286,7 +290,7 @@ void BuiltinRegistry::RegisterMathFunctions(Enviroment& globals) {
     });
     AddToEnvironment(globals, "min");
 
-    Register("max", [this](const std::vector<Value>& args) -> Value
+    Register("max", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckMinArgumentCount(args, 2, "max");
         double max_val = ExtractNumber(args[0], "max");
@@ -299,8 +303,8 @@ void BuiltinRegistry::RegisterMathFunctions(Enviroment& globals) {
 }
 
 
-void BuiltinRegistry::RegisterStringFunctions(Enviroment& globals) {
-    Register("lower", [this](const std::vector<Value>& args) -> Value
+void BuiltinRegistry::RegisterStringFunctions(GlobalTable& globals) {
+    Register("lower", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 1, "lower");
         std::string str = ExtractString(args[0], "lower");
@@ -309,7 +313,7 @@ void BuiltinRegistry::RegisterStringFunctions(Enviroment& globals) {
     });
     AddToEnvironment(globals, "lower");
 
-    Register("upper", [this](const std::vector<Value>& args) -> Value
+    Register("upper", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 1, "upper");
         std::string str = ExtractString(args[0], "upper");
@@ -318,7 +322,7 @@ void BuiltinRegistry::RegisterStringFunctions(Enviroment& globals) {
     });
     AddToEnvironment(globals, "upper");
 
-    Register("split", [this](const std::vector<Value>& args) -> Value
+    Register("split", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 2, "split");
         const std::string& str = ExtractString(args[0], "split");
@@ -343,23 +347,23 @@ void BuiltinRegistry::RegisterStringFunctions(Enviroment& globals) {
     });
     AddToEnvironment(globals, "split");
 
-    Register("join", [this](const std::vector<Value>& args) -> Value
+    Register("join", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 2, "join");
-        Value::Array array = ExtractArray(args[0], "join");
+        const Value::Array& array = ExtractArray(args[0], "join");
         const std::string& delim = ExtractString(args[1], "join");
 
         std::ostringstream oss;
         for (std::size_t i = 0; i < array.size(); ++i) {
             if (i > 0) oss << delim;
 
-            const auto& v = array[i]->data;
-            if (auto* str = std::get_if<std::string>(&v)) {
-                oss << *str;
-            } else if (auto* num = std::get_if<double>(&v)) {
-                oss << *num;
-            } else if (auto* boolean = std::get_if<bool>(&v)) {
-                oss << (*boolean ? "true" : "false");
+            const Value& v = array[i];
+            if (v.IsString()) {
+                oss << v.AsString();
+            } else if (v.IsNumber()) {
+                oss << v.AsNumber();
+            } else if (v.IsBool()) {
+                oss << (v.AsBool() ? "true" : "false");
             } else {
                 oss << "nil";
             }
@@ -369,7 +373,7 @@ void BuiltinRegistry::RegisterStringFunctions(Enviroment& globals) {
     });
     AddToEnvironment(globals, "join");
 
-    Register("replace", [this](const std::vector<Value>& args) -> Value
+    Register("replace", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 3, "replace");
         std::string str = ExtractString(args[0], "replace");
@@ -392,8 +396,8 @@ void BuiltinRegistry::RegisterStringFunctions(Enviroment& globals) {
 }
 
 
-void BuiltinRegistry::RegisterArrayFunctions(Enviroment& globals) {
-    Register("range", [this](const std::vector<Value>& args) -> Value
+void BuiltinRegistry::RegisterArrayFunctions(GlobalTable& globals) {
+    Register("range", [this](FunctionalObject::Arguments args) -> Value
         {
         if (args.empty() || args.size() > 3) {
             throw BuiltinError(BuiltinError::kRangeInvalidArguments);
@@ -417,47 +421,39 @@ void BuiltinRegistry::RegisterArrayFunctions(Enviroment& globals) {
         if (step == 0) {
             throw BuiltinError(BuiltinError::kRangeStepCannotBeZero);
         }
-
-        Value::Array result;
-        if (step > 0) {
-            for (double v = start; v < end; v += step) {
-                result.push_back(std::make_shared<Value>(v));
-            }
-        } else {
-            for (double v = start; v > end; v += step) {
-                result.push_back(std::make_shared<Value>(v));
-            }
+        if (!Range::Size(start, end, step)) {
+            throw BuiltinError(BuiltinError::kRangeTooLarge);
         }
-        return Value(result);
+
+        return Value(Range(start, end, step));
     });
     AddToEnvironment(globals, "range");
 
-    Register("push", [this](const std::vector<Value>& args) -> Value
+    Register("push", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 2, "push");
-        Value::Array array = ExtractArray(args[0], "push");
-        array.push_back(std::make_shared<Value>(args[1]));
-        return Value(array);
+        ExtractArray(args[0], "push").push_back(args[1]);
+        return args[0];
     });
     AddToEnvironment(globals, "push");
 
-    Register("pop", [this](const std::vector<Value>& args) -> Value
+    Register("pop", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 1, "pop");
-        Value::Array array = ExtractArray(args[0], "pop");
+        Value::Array& array = ExtractArray(args[0], "pop");
         if (array.empty()) {
             throw BuiltinError(BuiltinError::kPopFromEmptyArray);
         }
-        Value result = *array.back();
+        Value result = array.back();
         array.pop_back();
         return result;
     });
     AddToEnvironment(globals, "pop");
 
-    Register("insert", [this](const std::vector<Value>& args) -> Value
+    Register("insert", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 3, "insert");
-        Value::Array array = ExtractArray(args[0], "insert");
+        Value::Array& array = ExtractArray(args[0], "insert");
         int index = static_cast<int>(ExtractNumber(args[1], "insert"));
 
         if (index < 0) {
@@ -467,16 +463,16 @@ void BuiltinRegistry::RegisterArrayFunctions(Enviroment& globals) {
             throw BuiltinError(BuiltinError::kInsertIndexOutOfRange);
         }
 
-        array.insert(array.begin() + index, std::make_shared<Value>(args[2]));
-        return Value(array);
+        array.insert(array.begin() + index, args[2]);
+        return args[0];
     });
 
     AddToEnvironment(globals, "insert");
 
-    Register("remove", [this](const std::vector<Value>& args) -> Value
+    Register("remove", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 2, "remove");
-        Value::Array array = ExtractArray(args[0], "remove");
+        Value::Array& array = ExtractArray(args[0], "remove");
         int index = static_cast<int>(ExtractNumber(args[1], "remove"));
 
         if (index < 0)  {
@@ -486,44 +482,42 @@ void BuiltinRegistry::RegisterArrayFunctions(Enviroment& globals) {
             throw BuiltinError(BuiltinError::kRemoveIndexOutOfRange);
         }
 
-        Value result = *array[index];
+        Value result = array[index];
         array.erase(array.begin() + index);
         return result;
     });
 
     AddToEnvironment(globals, "remove");
 
-    Register("sort", [this](const std::vector<Value>& args) -> Value
+    Register("sort", [this](FunctionalObject::Arguments args) -> Value
     {
         CheckArgumentCount(args, 1, "sort");
-        Value::Array array = ExtractArray(args[0], "sort");
+        Value::Array& array = ExtractArray(args[0], "sort");
 
         std::sort(array.begin(), array.end(), [](const auto& a, const auto& b) {
-            if (std::holds_alternative<double>(a->data)
-                && std::holds_alternative<double>(b->data))
-            {
-                return (std::get<double>(a->data) < std::get<double>(b->data));
+            if (a.IsNumber() && b.IsNumber()) {
+                return (a.AsNumber() < b.AsNumber());
             }
 
-            if (std::holds_alternative<std::string>(a->data)
-                && std::holds_alternative<std::string>(b->data))
-            {
-                return (std::get<std::string>(a->data) < std::get<std::string>(b->data));
+            if (a.IsString() && b.IsString()) {
+                return (a.AsString() < b.AsString());
             }
             return false;
         });
 
-        return Value(array);
+        return args[0];
     });
 
     AddToEnvironment(globals, "sort");
 }
 
 
-void BuiltinRegistry::RegisterSystemFunctions(Enviroment& globals) {
-    Register("stacktrace", [](const std::vector<Value>& args) -> Value
+// Engines that track script calls define their own stacktrace over this
+// one, which only knows the program itself.
+void BuiltinRegistry::RegisterSystemFunctions(GlobalTable& globals) {
+    Register("stacktrace", [](FunctionalObject::Arguments args) -> Value
     {
-        return Value(Interpreter::GetStackTrace());
+        return Value(Interpreter::FormatStackTrace({"[global]"}));
     });
     AddToEnvironment(globals, "stacktrace");
 }
@@ -6,49 +6,46 @@
 
 #include <runtime/value/value.h>
 #include <runtime/function/function.h>
-#include <runtime/enviroment/enviroment.h>
-
-
-class Enviroment;
+#include <runtime/enviroment/global_table.h>
 
 
 class BuiltinRegistry {
 public:
-    using BuiltinFunction = std::function<Value(const std::vector<Value>&)>;
+    using BuiltinFunction = FunctionalObject::NativeFn;
 
     static BuiltinRegistry& Get() {
         static BuiltinRegistry instance;
         return instance;
     }
 
-    void RegisterAll(Enviroment&, std::ostream&, std::istream&);
+    void RegisterAll(GlobalTable&, std::ostream&, std::istream&);
 
 private:
-    void RegisterIOFunctions(Enviroment&, std::ostream&, std::istream&);
-    void RegisterUtilityFunctions(Enviroment&);
-    void RegisterMathFunctions(Enviroment&);
-    void RegisterStringFunctions(Enviroment&);
-    void RegisterArrayFunctions(Enviroment&);
-    void RegisterSystemFunctions(Enviroment&);
+    void RegisterIOFunctions(GlobalTable&, std::ostream&, std::istream&);
+    void RegisterUtilityFunctions(GlobalTable&);
+    void RegisterMathFunctions(GlobalTable&);
+    void RegisterStringFunctions(GlobalTable&);
+    void RegisterArrayFunctions(GlobalTable&);
+    void RegisterSystemFunctions(GlobalTable&);
 
 private:
-    void CheckArgumentCount(const std::vector<Value>&
+    void CheckArgumentCount(FunctionalObject::Arguments
                 , std::size_t, const std::string&);
 
-    void CheckMinArgumentCount(const std::vector<Value>&
+    void CheckMinArgumentCount(FunctionalObject::Arguments
                 , std::size_t, const std::string&);
 
     double ExtractNumber(const Value&, const std::string&);
 
     std::string ExtractString(const Value&, const std::string&);
 
-    Value::Array ExtractArray(const Value&, const std::string&);
+    Value::Array& ExtractArray(const Value&, const std::string&);
 
     Value CreateStringArray(const std::vector<std::string>&);
 
     void Register(const std::string&, BuiltinFunction);
 
-    void AddToEnvironment(Enviroment&, const std::string&);
+    void AddToEnvironment(GlobalTable&, const std::string&);
 
 private:
     std::unordered_map<std::string, BuiltinFunction> functions_;
@@ -15,6 +15,7 @@ public:
     static constexpr const char* kReplaceOldStringCannotBeEmpty = "replace() old string cannot be empty";
     static constexpr const char* kRangeInvalidArguments = "range() expects 1, 2 or 3 arguments";
     static constexpr const char* kRangeStepCannotBeZero = "range() step cannot be zero";
+    static constexpr const char* kRangeTooLarge = "range() bounds give too many elements";
     static constexpr const char* kPopFromEmptyArray = "pop() from empty array";
     static constexpr const char* kInsertIndexOutOfRange = "insert() index out of range";
     static constexpr const char* kRemoveIndexOutOfRange = "remove() index out of range";
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <string>
+
+#include <pthread.h>
+
+#include <runtime/interpreter/call_stack/call_stack.h>
+#include <runtime/interpreter/errors/intrptr_errors.h>
+
+
+namespace {
+
+// Native stack a nested script call may take, with room for the expressions
+// and blocks between two calls, and what the program needs besides calls.
+// Calls nested in deeper blocks than that still stop at the stack limit
+// with the same error, only before reaching the configured depth.
+constexpr std::size_t kStackPerCall = 8 * 1024;
+constexpr std::size_t kStackBase = 1024 * 1024;
+
+// Left unused below the limit checked by calls: builtins and whatever runs
+// between two checks must still fit.
+constexpr std::size_t kStackReserve = 256 * 1024;
+
+// Deeper limits than this could not be given a stack of their size anyway;
+// they are lowered so that the size does not overflow.
+constexpr std::size_t kMaxCallDepth = (std::numeric_limits<std::size_t>::max() - kStackBase) / kStackPerCall;
+
+
+// The lowest address of the current thread's stack. Its bounds are unknown
+// only if glibc cannot read them, and then no more than twice kStackBase
+// below `top` is assumed to be left.
+const char* StackBottom(const char* top) {
+    const char* bottom = top - 2 * kStackBase;
+
+    pthread_attr_t attributes;
+    if (pthread_getattr_np(pthread_self(), &attributes) == 0) {
+        void* address = nullptr;
+        std::size_t size = 0;
+        if (pthread_attr_getstack(&attributes, &address, &size) == 0) {
+            bottom = static_cast<const char*>(address);
+        }
+        pthread_attr_destroy(&attributes);
+    }
+    return bottom;
+}
+
+
+// Runs `body` on a thread whose stack holds `bytes`. The memory is only
+// reserved; the kernel commits pages as the stack grows into them. `body`
+// gets the lowest address it should let calls reach and the size of the
+// stack it runs on. When no thread can be started, for instance because the
+// address space is limited, it runs on the caller's stack, whose real
+// bounds give both.
+void RunOnStack(std::size_t bytes, const std::function<void(const char*, std::size_t)>& body) {
+    struct Task {
+        const std::function<void(const char*, std::size_t)>& body;
+        std::size_t bytes;
+        std::exception_ptr error;
+    };
+    Task task{body, bytes, nullptr};
+
+    auto entry = [](void* data) -> void* {
+        auto& task = *static_cast<Task*>(data);
+        const auto* top = static_cast<const char*>(__builtin_frame_address(0));
+        try {
+            task.body(top - task.bytes + kStackReserve, task.bytes);
+        } catch (...) {
+            task.error = std::current_exception();
+        }
+        return nullptr;
+    };
+
+    pthread_attr_t attributes;
+    pthread_t thread;
+    bool started = false;
+    if (pthread_attr_init(&attributes) == 0) {
+        started = pthread_attr_setstacksize(&attributes, bytes) == 0
+               && pthread_create(&thread, &attributes, entry, &task) == 0;
+        pthread_attr_destroy(&attributes);
+    }
+
+    if (!started) {
+        const auto* top = static_cast<const char*>(__builtin_frame_address(0));
+        const char* bottom = StackBottom(top);
+        body(bottom + kStackReserve, static_cast<std::size_t>(top - bottom));
+        return;
+    }
+    pthread_join(thread, nullptr);
+    if (task.error) {
+        std::rethrow_exception(task.error);
+    }
+}
+
+} // namespace
+
+
+void RunOnCallStack(std::size_t max_depth, const std::function<void(const char*, std::size_t)>& body) {
+    max_depth = std::min(max_depth, kMaxCallDepth);
+    RunOnStack(kStackBase + max_depth * kStackPerCall, [&](const char* stack_limit, std::size_t bytes) {
+        std::size_t fits = bytes > kStackBase ? (bytes - kStackBase) / kStackPerCall : 0;
+        body(stack_limit, std::min(max_depth, fits));
+    });
+}
+
+
+CallDepth::CallDepth(std::size_t max_depth, const char* stack_limit)
+    : max_depth_(max_depth)
+    , stack_limit_(stack_limit)
+{}
+
+
+CallDepth::Scope::Scope(CallDepth& calls)
+    : calls_(calls)
+{
+    if (calls_.depth_ == calls_.max_depth_ || PastStackLimit(calls_.stack_limit_)) {
+        throw InterpreterError(InterpreterError::kStackOverflow + std::to_string(calls_.max_depth_));
+    }
+    ++calls_.depth_;
+}
+
+
+CallDepth::Scope::~Scope() {
+    --calls_.depth_;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+
+// Script calls that may be in progress at once before a run fails with a
+// stack overflow.
+inline constexpr std::size_t kDefaultMaxCallDepth = 200000;
+
+
+// Runs `body` on a native stack of its own, sized for `max_depth` nested
+// script calls. `body` gets the lowest address calls should let the stack
+// reach and the number of nested calls that fit on the stack it runs on,
+// which is less than `max_depth` only when a smaller stack was all there
+// was. Exceptions thrown by `body` are rethrown to the caller.
+void RunOnCallStack(std::size_t max_depth, const std::function<void(const char*, std::size_t)>& body);
+
+
+// Whether the caller's frame lies below `stack_limit`; false without one.
+inline bool PastStackLimit(const char* stack_limit) {
+    const auto* frame = static_cast<const char*>(__builtin_frame_address(0));
+    return stack_limit && std::less<const char*>{}(frame, stack_limit);
+}
+
+
+// Bounds the nesting of script calls for engines that run script functions
+// as plain native calls: the closure engine and compiled programs. A call
+// one deeper than the limit, or one that reaches the stack limit first,
+// fails with the same stack overflow error as in the tree-walker.
+class CallDepth {
+public:
+    CallDepth(std::size_t max_depth, const char* stack_limit);
+
+    // Counts a call as in progress for as long as it lives.
+    class Scope {
+    public:
+        explicit Scope(CallDepth&);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        CallDepth& calls_;
+    };
+
+private:
+    std::size_t max_depth_;
+    const char* stack_limit_;
+    std::size_t depth_ = 0;
+};
@@ -3,9 +3,11 @@
 #include <stdexcept>
 
 
-class InterpreterError : std::runtime_error {
+class InterpreterError : public std::runtime_error {
 public:
     static constexpr const char* kCanOnlyIterateArrays = "Can only iterate arrays";
+    static constexpr const char* kUnexpectedCompletion = "break, continue or return outside of its construct";
+    static constexpr const char* kStackOverflow = "stack overflow: more nested calls than the limit of ";
     static constexpr const char* kUnknownError = "Interpreter error: unknown\n";
 
 public:
@@ -1,12 +1,37 @@
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <span>
 #include <sstream>
 
 #include <runtime/interpreter/errors/intrptr_errors.h>
 #include <semantic.h>
 #include <syntax.h>
 #include <runtime/interpreter/interpreter.h>
+#include <runtime/jit/jit.h>
+
+
+namespace {
+
+// The variable a function was called through, or else its parameter
+// count, and the line of the call.
+std::string FrameName(const CallFrame& frame) {
+    const auto* var = frame.site ? std::get_if<VariableExpression>(&frame.site->callable->value) : nullptr;
+    std::string name;
+    if (var) {
+        name = var->name;
+    } else if (frame.function->parameters.empty()) {
+        name = "[anonymous]";
+    } else {
+        name = "[function(" + std::to_string(frame.function->parameters.size()) + " params)]";
+    }
+    if (frame.site) {
+        name += " (line " + std::to_string(frame.site->line) + ")";
+    }
+    return name;
+}
 
-std::stack<CallFrame> Interpreter::call_stack_;
+} // namespace
 
 
 bool RunInterpreter(std::istream& in, std::ostream& out) {
@@ -14,29 +39,72 @@ bool RunInterpreter(std::istream& in, std::ostream& out) {
 }
 
 
-Enviroment& Interpreter::GetGlobals() {
+GlobalTable& Interpreter::GetGlobals() {
     return globals_;
 }
 
 
-bool Interpreter::Interpret(std::istream& in, std::ostream& out) {
+bool Interpreter::Interpret(std::istream& in, std::ostream& out, std::ostream* fusion_stats
+                        , std::ostream* call_stats, std::size_t max_depth)
+{
+    bool success = false;
+    // Compiled functions recurse on the native stack up to the depth limit,
+    // so a smaller stack than asked for lowers it.
+    RunOnCallStack(max_depth, [&](const char* stack_limit, std::size_t fits) {
+        success = Run(in, out, fusion_stats, call_stats, fits, stack_limit);
+    });
+    return success;
+}
+
+
+bool Interpreter::Run(std::istream& in, std::ostream& out, std::ostream* fusion_stats
+                    , std::ostream* call_stats, std::size_t max_depth, const char* stack_limit)
+{
+    // The calls an error escaped from, printed after the error.
+    std::string trace;
     try {
         SyntaxAnalizer parser(in);
         auto program = parser.Parse();
-        SemanticAnalizer sem(out);
-        if (!sem.Analyse(program)) { return false; }
 
         Interpreter interp(out);
         interp.RegisterBuiltins();
-        PushCallFrame(CallFrame("[global]"));
-        interp.ParseList(program, &interp.globals_);
-        PopCallFrame();
+        interp.max_depth_ = max_depth;
+        interp.stack_limit_ = stack_limit;
+
+        SemanticAnalizer sem(out, interp.globals_.Names());
+        if (!sem.Analyse(program)) { return false; }
+        for (const auto& name : sem.GlobalNames()) {
+            interp.globals_.Bind(name);
+        }
+
+        FusionPass fusion;
+        fusion.Run(program);
+
+        Completion completion;
+        try {
+            completion = interp.PerformList(program, &interp.top_level_);
+        } catch (...) {
+            if (!interp.frames_.empty()) {
+                trace = interp.GetStackTrace() + "\n";
+            }
+            throw;
+        }
+        if (!completion.IsNormal()) {
+            throw InterpreterError(InterpreterError::kUnexpectedCompletion);
+        }
+
+        if (fusion_stats) {
+            DumpFusionStats(fusion.Fused(), *fusion_stats);
+        }
+        if (call_stats) {
+            DumpCallSiteStats(interp.call_sites_, *call_stats);
+        }
         return true;
     } catch (const std::exception& e) {
-        std::cerr << "Interpreter error: " << e.what() << "\n";
+        std::cerr << "Interpreter error: " << e.what() << "\n" << trace;
         return false;
     } catch (...) {
-        std::cerr << InterpreterError::kUnknownError;
+        std::cerr << InterpreterError::kUnknownError << trace;
         return false;
     }
 }
@@ -44,6 +112,7 @@ bool Interpreter::Interpret(std::istream& in, std::ostream& out) {
 
 Interpreter::Interpreter(std::ostream& out)
     : globals_()
+    , top_level_()
     , output_(out)
     , statement_processor_(std::make_unique<StatementProcessor>(this))
 {}
@@ -54,124 +123,210 @@ Value Interpreter::ParseNode(const Expression& expr, Enviroment* env) {
 }
 
 
-void Interpreter::Perform(const Statement& stmt, Enviroment* env) {
-    std::visit([&](const auto& s) {
-        statement_processor_->Process(s, env);
+bool Interpreter::ParseCondition(const Expression& expr, Enviroment* env) {
+    return ExpressionEvaluator{this, env}.Test(expr);
+}
+
+
+Completion Interpreter::Perform(const Statement& stmt, Enviroment* env) {
+    return std::visit([&](const auto& s) {
+        return statement_processor_->Process(s, env);
     }, stmt.value);
 }
 
 
-Value Interpreter::ParseList(const std::vector<Statement>& stmts, Enviroment* parent) {
-    Enviroment block(parent);
+Completion Interpreter::ParseList(const std::vector<Statement>& stmts
+    , Enviroment* parent, const ScopeLayout& layout)
+{
+    if (layout.elided) {
+        return PerformList(stmts, parent);
+    }
+    ValueStack<std::optional<Value>>::Scope frame(locals_);
+    Enviroment block(parent, locals_.Push(layout.slots));
+    return PerformList(stmts, &block);
+}
+
+
+Completion Interpreter::PerformList(const std::vector<Statement>& stmts, Enviroment* env) {
     for (const auto& stmt : stmts) {
-        Perform(stmt, &block);
+        Completion completion = Perform(stmt, env);
+        if (!completion.IsNormal()) {
+            return completion;
+        }
     }
-    return Value(NilType{});
+    return Completion::Normal();
 }
 
 
-Value Interpreter::PerformFunction(const Value::FuncPtr& fn, const std::vector<Value>& args) {
+// Tail calls do not nest: the body completes with the function to call next
+// and leaves its arguments on top of arguments_, and the loop runs it after
+// releasing the frame, so tail recursion takes constant space.
+Value Interpreter::PerformFunction(const Value::FuncPtr& fn, FunctionalObject::Arguments args
+                                 , const CallableExpression* site)
+{
     if (fn->native) {
         return fn->native(args);
     }
 
-    std::string func_name = "[anonymous]";
-    if (!fn->parameters.empty()) {
-        func_name = "[function(" + std::to_string(fn->parameters.size()) + " params)]";
+    if (frames_.size() == max_depth_ || PastStackLimit(stack_limit_)) {
+        StackOverflow();
     }
+    frames_.push_back({fn.get(), site});
 
-    Enviroment local(fn->closure);
-    for (std::size_t i = 0; i < fn->parameters.size(); ++i) {
-        Value v = (i < args.size()) ? args[i] : Value(NilType{});
-        local.Define(fn->parameters[i], v);
-    }
+    ValueStack<Value>::Scope pending(arguments_);
+    FunctionalObject* function = fn.get();
+    Value callee;
+    Value result;
 
-    try {
-        for (const auto& stmt : *fn->f_body) {
-            Perform(stmt, &local);
+    while (true) {
+        if (function->native) {
+            result = function->native(args);
+            break;
         }
-    } catch (const ReturnException& r) {
-        return r.value;
+        frames_.back() = {function, site};
+
+        if (!function->jit && function->calls < kJitThreshold && ++function->calls == kJitThreshold) {
+            function->jit = JitFunction::Compile(*function, globals_);
+        }
+        if (function->jit) {
+            std::optional<Value> compiled;
+            try {
+                compiled = function->jit->Call(args, globals_, max_depth_ - frames_.size());
+            } catch (const JitFunction::DepthExceeded&) {
+                StackOverflow(max_depth_ - frames_.size());
+            }
+            if (compiled) {
+                result = *std::move(compiled);
+                break;
+            }
+            if (function->jit->Exhausted()) {
+                function->jit.reset();
+            }
+        }
+
+        Completion completion;
+        {
+            // Declared first, so that the slots holding its lists are
+            // cleared before it is released.
+            ValueStack<Value::ListStorage>::Scope lists(lists_);
+            ValueStack<std::optional<Value>>::Scope frame(locals_);
+            std::span<std::optional<Value>> slots = locals_.Push(std::max(function->slots, function->parameters.size()));
+            for (std::size_t i = 0; i < function->parameters.size(); ++i) {
+                slots[i] = (i < args.size()) ? args[i] : Value(NilType{});
+            }
+            pending.Release();
+
+            Enviroment local(function->upvalues, slots);
+            completion = PerformList(*function->f_body, &local);
+        }
+
+        if (completion.kind == Completion::Kind::TailCall) {
+            callee = std::move(completion.value);
+            function = callee.AsFunction().get();
+            args = tail_arguments_;
+            site = tail_site_;
+            continue;
+        }
+        if (completion.kind == Completion::Kind::Return) {
+            result = std::move(completion.value);
+        } else if (!completion.IsNormal()) {
+            throw InterpreterError(InterpreterError::kUnexpectedCompletion);
+        }
+        break;
     }
 
-    PopCallFrame();
+    frames_.pop_back();
+    return result;
+}
+
 
-    return Value(NilType{});
+Completion Interpreter::PrepareTailCall(const CallableExpression& call, Enviroment* env) {
+    bool cached = false;
+    Value callee = ExpressionEvaluator{this, env}.Callee(call, cached);
+
+    std::span<Value> arguments = arguments_.Push(call.f_arguments.size());
+    for (std::size_t i = 0; i < call.f_arguments.size(); ++i) {
+        arguments[i] = ParseNode(*call.f_arguments[i], env);
+    }
+    tail_arguments_ = arguments;
+    tail_site_ = &call;
+    return Completion::TailCall(std::move(callee));
 }
 
 
-bool Interpreter::IsTrue(const Value& v) const {
-    if (auto* boolean = std::get_if<bool>(&v.data)) {
-        return *boolean;
+bool Interpreter::IsTrue(const Value& v) {
+    if (v.IsBool()) {
+        return v.AsBool();
     }
-    if (std::holds_alternative<NilType>(v.data)) {
+    if (v.IsNil()) {
         return false;
     }
     return true;
 }
 
 
-void Interpreter::PushCallFrame(const CallFrame& frame) {
-    call_stack_.push(frame);
-}
-
-
-void Interpreter::PopCallFrame() {
-    if (!call_stack_.empty()) {
-        call_stack_.pop();
+// The calls compiled code made are not on frames_; they are recorded as
+// calls of the innermost function from an unknown place.
+void Interpreter::StackOverflow(std::size_t recursed) {
+    if (recursed > 0) {
+        frames_.insert(frames_.end(), recursed, CallFrame{frames_.back().function, nullptr});
     }
+    throw InterpreterError(InterpreterError::kStackOverflow + std::to_string(max_depth_));
 }
 
 
-std::string Interpreter::GetStackTrace() {
-    if (call_stack_.empty()) {
-        return "stacktrace: [empty stack]";
-    }
+std::string Interpreter::FormatStackTrace(const std::vector<std::string>& names) {
+    constexpr std::size_t kShown = 5;
 
     std::ostringstream oss;
     oss << "stacktrace: ";
-
-    std::stack<CallFrame> temp_stack = call_stack_;
-    std::vector<CallFrame> frames;
-
-    while (!temp_stack.empty()) {
-        frames.push_back(temp_stack.top());
-        temp_stack.pop();
-    }
-
-    for (int i = frames.size() - 1; i >= 0; --i) {
-        oss << frames[i].function_name;
+    for (std::size_t i = 0; i < names.size(); ++i) {
+        if (names.size() > 2 * kShown + 1 && i == kShown) {
+            oss << " -> ... " << names.size() - 2 * kShown << " more ...";
+            i = names.size() - kShown - 1;
+            continue;
+        }
         if (i > 0) {
             oss << " -> ";
         }
+        oss << names[i];
     }
-
     return oss.str();
 }
 
 
-bool Interpreter::IsEqual(const Value& a, const Value& b) const {
-    if (a.data.index() != b.data.index()) {
-        return false;
+std::string Interpreter::GetStackTrace() const {
+    std::vector<std::string> names{"[global]"};
+    names.reserve(frames_.size() + 1);
+    for (const CallFrame& frame : frames_) {
+        names.push_back(FrameName(frame));
     }
+    return FormatStackTrace(names);
+}
 
-    if (auto* num_a = std::get_if<double>(&a.data)) {
-        return *num_a == std::get<double>(b.data);
-    }
-    if (auto* str_a = std::get_if<std::string>(&a.data)) {
-        return *str_a == std::get<std::string>(b.data);
-    }
-    if (auto* bool_a = std::get_if<bool>(&a.data)) {
-        return *bool_a == std::get<bool>(b.data);
-    }
-    if (std::holds_alternative<NilType>(a.data)) {
-        return true;
+
+bool Interpreter::IsEqual(const Value& a, const Value& b) {
+    if (a.GetKind() != b.GetKind()) {
+        return false;
     }
 
-    return false;
+    switch (a.GetKind()) {
+        case Value::Kind::Number: return a.AsNumber() == b.AsNumber();
+        case Value::Kind::String: return a.AsString() == b.AsString();
+        case Value::Kind::Bool: return a.AsBool() == b.AsBool();
+        case Value::Kind::Nil: return true;
+        default: return false;
+    }
 }
 
 
 void Interpreter::RegisterBuiltins() {
     BuiltinRegistry::Get().RegisterAll(globals_, output_, std::cin);
+
+    auto stacktrace = std::make_shared<FunctionalObject>(
+        [this](FunctionalObject::Arguments) -> Value {
+            return Value(GetStackTrace());
+        }
+    );
+    globals_.Define("stacktrace", Value(stacktrace));
 }
@@ -2,19 +2,23 @@
 
 #include <iostream>
 #include <memory>
+#include <string>
 #include <vector>
-#include <stack>
 
 #include <runtime/value/value.h>
 #include <runtime/function/function.h>
 #include <runtime/enviroment/enviroment.h>
+#include <runtime/enviroment/global_table.h>
+#include <runtime/enviroment/value_stack.h>
 #include <vls_and_sttmnts.h>
 #include <semantic.h>
 #include <syntax.h>
 #include <runtime/evaluator/evaluator.h>
+#include <runtime/fusion/fusion.h>
 #include <runtime/interpreter/interpreter.h>
 #include <runtime/interpreter/statements/statements.h>
 #include <runtime/interpreter/builtins/builtins.h>
+#include <runtime/interpreter/call_stack/call_stack.h>
 
 
 
@@ -23,49 +27,83 @@ class ExpressionEvaluator;
 class StatementProcessor;
 
 
+// A script call in progress. Names and lines are only looked up when a
+// trace is printed.
 struct CallFrame {
-    std::string function_name;
-    std::vector<std::string> parameters;
-    std::vector<Value> arguments;
-
-    CallFrame(const std::string& name,
-              const std::vector<std::string>& params = {},
-              const std::vector<Value>& args = {})
-        : function_name(name)
-        , parameters(params)
-        , arguments(args)
-    {}
+    const FunctionalObject* function;
+    // nullptr when the call has no place in the source.
+    const CallableExpression* site;
 };
 
 
 class Interpreter {
 public:
-    static bool Interpret(std::istream&, std::ostream&);
+    // With `fusion_stats` and `call_stats`, the hit rates of fused nodes and
+    // of call-site caches are written there after a successful run. The
+    // program runs on a native stack of its own, sized for `max_depth`
+    // nested script calls; one call more is a stack overflow error.
+    static bool Interpret(std::istream&, std::ostream&, std::ostream* fusion_stats = nullptr
+                        , std::ostream* call_stats = nullptr
+                        , std::size_t max_depth = kDefaultMaxCallDepth);
 
     Value ParseNode(const Expression&, Enviroment*);
-    void Perform(const Statement&, Enviroment*);
-    Value ParseList(const std::vector<Statement>&, Enviroment*);
-    Value PerformFunction(const Value::FuncPtr&, const std::vector<Value>&);
-
-    bool IsTrue(const Value&) const;
-    bool IsEqual(const Value&, const Value&) const;
-    Enviroment& GetGlobals();
-
-    static void PushCallFrame(const CallFrame& frame);
-    static void PopCallFrame();
-    static std::string GetStackTrace();
+    bool ParseCondition(const Expression&, Enviroment*);
+    Completion Perform(const Statement&, Enviroment*);
+    Completion ParseList(const std::vector<Statement>&, Enviroment*, const ScopeLayout&);
+    Completion PerformList(const std::vector<Statement>&, Enviroment*);
+    Value PerformFunction(const Value::FuncPtr&, FunctionalObject::Arguments
+                        , const CallableExpression* site = nullptr);
+    // Evaluates the callee and arguments of a call in tail position; the
+    // enclosing PerformFunction makes the call once the frame is released.
+    Completion PrepareTailCall(const CallableExpression&, Enviroment*);
+
+    static bool IsTrue(const Value&);
+    static bool IsEqual(const Value&, const Value&);
+    GlobalTable& GetGlobals();
+
+    // The calls in progress, outermost first.
+    std::string GetStackTrace() const;
+
+    // A trace of `names`, outermost first, with the middle of a long one
+    // left out.
+    static std::string FormatStackTrace(const std::vector<std::string>& names);
 
 private:
-    Enviroment globals_;
+    GlobalTable globals_;
+    Enviroment top_level_;
     std::ostream& output_;
     std::unique_ptr<StatementProcessor> statement_processor_;
-
-    static std::stack<CallFrame> call_stack_;
+    // Every call site that has run, in the order it first ran.
+    std::vector<const CallableExpression*> call_sites_;
+    // Arguments being passed and the slots of the scopes in progress, so
+    // that calls and blocks do not allocate.
+    ValueStack<Value> arguments_;
+    ValueStack<std::optional<Value>> locals_;
+    // Cells of the lists a call makes that EscapeAnalysis found never
+    // outlive it, reclaimed together when the call ends.
+    ValueStack<Value::ListStorage> lists_;
+    // The arguments and the call site of the last prepared tail call; the
+    // arguments are on top of arguments_.
+    FunctionalObject::Arguments tail_arguments_;
+    const CallableExpression* tail_site_ = nullptr;
+    // Script calls in progress, innermost last. A tail call replaces the
+    // caller's entry. An error escaping a call leaves its entries behind,
+    // so they describe where the error happened.
+    std::vector<CallFrame> frames_;
+    std::size_t max_depth_ = kDefaultMaxCallDepth;
+    // Calls fail once the native stack reaches this address; nullptr when
+    // the bounds of the stack are unknown.
+    const char* stack_limit_ = nullptr;
 
     Interpreter(std::ostream&);
+    static bool Run(std::istream&, std::ostream&, std::ostream* fusion_stats, std::ostream* call_stats
+                  , std::size_t max_depth, const char* stack_limit);
     void RegisterBuiltins();
+    // `recursed` more calls of the innermost function ran as native code.
+    [[noreturn]] void StackOverflow(std::size_t recursed = 0);
 
     friend class ExpressionEvaluator;
+    friend class StatementProcessor;
 };
 
 bool RunInterpreter(std::istream& in, std::ostream& out);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+#include <runtime/value/value.h>
+
+
+// Outcome of executing a statement. Non-normal completions travel up through
+// ParseList until a loop (break/continue) or a function call (return)
+// consumes them, replacing the former C++ exceptions. A tail call returns
+// the function to call in `value`; the caller's frame is gone by the time
+// the call runs.
+struct Completion {
+    enum class Kind : std::uint8_t {
+        Normal,
+        Break,
+        Continue,
+        Return,
+        TailCall,
+    };
+
+    Kind kind = Kind::Normal;
+    Value value;
+
+    bool IsNormal() const { return kind == Kind::Normal; }
+    bool LeavesFunction() const { return kind == Kind::Return || kind == Kind::TailCall; }
+
+    static Completion Normal() { return {}; }
+    static Completion Break() { return {Kind::Break, Value()}; }
+    static Completion Continue() { return {Kind::Continue, Value()}; }
+    static Completion Return(Value value) { return {Kind::Return, std::move(value)}; }
+    static Completion TailCall(Value function) { return {Kind::TailCall, std::move(function)}; }
+};
@@ -0,0 +1,28 @@
+#include <utility>
+
+#include <runtime/interpreter/statements/loop.h>
+#include <runtime/interpreter/errors/intrptr_errors.h>
+
+
+LoopScope::LoopScope(Enviroment* outer, const ScopeLayout& layout, std::span<std::optional<Value>> slots)
+    : outer_(outer)
+    , layout_(layout)
+{
+    if (!Shared(layout_)) {
+        return;
+    }
+    if (slots.empty()) {
+        shared_.emplace(outer_, layout_.slots);
+    } else {
+        shared_.emplace(outer_, slots);
+    }
+}
+
+
+LoopSequence::LoopSequence(Value iterable)
+    : iterable_(std::move(iterable))
+{
+    if (!iterable_.IsList()) {
+        throw InterpreterError(InterpreterError::kCanOnlyIterateArrays);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <span>
+
+#include <runtime/value/value.h>
+#include <runtime/enviroment/enviroment.h>
+#include <vls_and_sttmnts.h>
+
+
+// The environments the iterations of a loop body run in, chosen the same
+// way by every engine. Iterations no closure can observe share one
+// environment, cleared before each. A body a closure captures gets a fresh
+// one every time, and a body without slots runs in the outer environment.
+class LoopScope {
+public:
+    // The shared environment borrows `slots` when they are given.
+    LoopScope(Enviroment* outer, const ScopeLayout&, std::span<std::optional<Value>> slots = {});
+
+    LoopScope(const LoopScope&) = delete;
+    LoopScope& operator=(const LoopScope&) = delete;
+
+    static bool Shared(const ScopeLayout& layout) { return !layout.elided && !layout.captured; }
+
+    // The environment of the next iteration.
+    Enviroment* Next() {
+        if (shared_) {
+            shared_->ClearLocals();
+            return &*shared_;
+        }
+        if (layout_.elided) {
+            return outer_;
+        }
+        fresh_.reset();
+        return &fresh_.emplace(outer_, layout_.slots);
+    }
+
+private:
+    Enviroment* outer_;
+    ScopeLayout layout_;
+    std::optional<Enviroment> shared_;
+    std::optional<Enviroment> fresh_;
+};
+
+
+// The elements a for loop walks: a lazy range or a list, which may grow
+// while the loop runs. Ranges are walked with a counter instead of being
+// materialized; a range the loop changes is materialized and read as a list
+// from then on.
+class LoopSequence {
+public:
+    explicit LoopSequence(Value);
+
+    std::size_t Size() const { return iterable_.IsRange() ? iterable_.AsRange().size : iterable_.AsList().size(); }
+
+    Value At(std::size_t index) const {
+        return iterable_.IsRange() ? Value(iterable_.AsRange().At(index)) : iterable_.AsList()[index];
+    }
+
+private:
+    Value iterable_;
+};
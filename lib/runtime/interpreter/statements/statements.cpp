@@ -1,123 +1,139 @@
+#include <optional>
+
 #include <runtime/interpreter/errors/intrptr_errors.h>
 #include <runtime/interpreter/statements/statements.h>
-#include <runtime/function/errors/func_errors.h>
+#include <runtime/interpreter/statements/loop.h>
 #include <runtime/interpreter/interpreter.h>
 
 
 template<>
-void StatementProcessor::Process(const ExpressionStatement& stmt, Enviroment* env) {
-    ProcessExpression(stmt, env);
+Completion StatementProcessor::Process(const ExpressionStatement& stmt, Enviroment* env) {
+    return ProcessExpression(stmt, env);
 }
 
 
 template<>
-void StatementProcessor::Process(const IfStatement& stmt, Enviroment* env) {
-    ProcessIf(stmt, env);
+Completion StatementProcessor::Process(const IfStatement& stmt, Enviroment* env) {
+    return ProcessIf(stmt, env);
 }
 
 
 template<>
-void StatementProcessor::Process(const WhileStatement& stmt, Enviroment* env) {
-    ProcessWhile(stmt, env);
+Completion StatementProcessor::Process(const WhileStatement& stmt, Enviroment* env) {
+    return ProcessWhile(stmt, env);
 }
 
 
 template<>
-void StatementProcessor::Process(const ForStatement& stmt, Enviroment* env) {
-    ProcessFor(stmt, env);
+Completion StatementProcessor::Process(const ForStatement& stmt, Enviroment* env) {
+    return ProcessFor(stmt, env);
 }
 
 
 template<>
-void StatementProcessor::Process(const ReturnStatement& stmt, Enviroment* env) {
-    ProcessReturn(stmt, env);
+Completion StatementProcessor::Process(const ReturnStatement& stmt, Enviroment* env) {
+    return ProcessReturn(stmt, env);
 }
 
 
 template<>
-void StatementProcessor::Process(const BlockStatement& stmt, Enviroment* env) {
-    ProcessBlock(stmt, env);
+Completion StatementProcessor::Process(const BlockStatement& stmt, Enviroment* env) {
+    return ProcessBlock(stmt, env);
 }
 
 
 template<>
-void StatementProcessor::Process(const BreakStatement& stmt, Enviroment* env) {
-    ProcessBreak(stmt, env);
+Completion StatementProcessor::Process(const BreakStatement& stmt, Enviroment* env) {
+    return ProcessBreak(stmt, env);
 }
 
 
 template<>
-void StatementProcessor::Process(const ContinueStatement& stmt, Enviroment* env) {
-    ProcessContinue(stmt, env);
+Completion StatementProcessor::Process(const ContinueStatement& stmt, Enviroment* env) {
+    return ProcessContinue(stmt, env);
 }
 
 
-void StatementProcessor::ProcessExpression(const ExpressionStatement& stmt, Enviroment* env) {
+Completion StatementProcessor::ProcessExpression(const ExpressionStatement& stmt, Enviroment* env) {
     interpreter_->ParseNode(stmt.expression, env);
+    return Completion::Normal();
 }
 
 
-void StatementProcessor::ProcessIf(const IfStatement& stmt, Enviroment* env) {
-    if (interpreter_->IsTrue(interpreter_->ParseNode(stmt.condition, env))) {
-        interpreter_->ParseList(stmt.then_case, env);
+Completion StatementProcessor::ProcessIf(const IfStatement& stmt, Enviroment* env) {
+    if (interpreter_->ParseCondition(stmt.condition, env)) {
+        return interpreter_->ParseList(stmt.then_case, env, stmt.then_scope);
     } else if (!stmt.else_case.empty()) {
-        interpreter_->ParseList(stmt.else_case, env);
+        return interpreter_->ParseList(stmt.else_case, env, stmt.else_scope);
     }
+    return Completion::Normal();
 }
 
 
-void StatementProcessor::ProcessWhile(const WhileStatement& stmt, Enviroment* env) {
-    try {
-        while (interpreter_->IsTrue(interpreter_->ParseNode(stmt.condition, env))) {
-            try {
-                interpreter_->ParseList(stmt.body, env);
-            } catch (const ContinueException&) {
-                continue;
-            }
+Completion StatementProcessor::ProcessWhile(const WhileStatement& stmt, Enviroment* env) {
+    const ScopeLayout& layout = stmt.body_scope;
+    ValueStack<std::optional<Value>>::Scope frame(interpreter_->locals_);
+    LoopScope scope(env, layout, LoopScope::Shared(layout) ? interpreter_->locals_.Push(layout.slots)
+                                                           : std::span<std::optional<Value>>{});
+
+    while (interpreter_->ParseCondition(stmt.condition, env)) {
+        Completion completion = interpreter_->PerformList(stmt.body, scope.Next());
+        if (completion.kind == Completion::Kind::Break) {
+            break;
+        }
+        if (completion.LeavesFunction()) {
+            return completion;
         }
-    } catch (const BreakException&) { }
+    }
+    return Completion::Normal();
 }
 
 
-void StatementProcessor::ProcessFor(const ForStatement& stmt, Enviroment* env) {
-    Value iterable = interpreter_->ParseNode(stmt.iter, env);
-    if (!std::holds_alternative<Value::Array>(iterable.data)) {
-        throw InterpreterError(InterpreterError::kCanOnlyIterateArrays);
-    }
+Completion StatementProcessor::ProcessFor(const ForStatement& stmt, Enviroment* env) {
+    LoopSequence sequence(interpreter_->ParseNode(stmt.iter, env));
 
-    auto& array = std::get<Value::Array>(iterable.data);
-    try {
-        for (const auto& element : array) {
-            Enviroment loop_env(env);
-            loop_env.Define(stmt.var, *element);
-            try {
-                interpreter_->ParseList(stmt.body, &loop_env);
-            } catch (const ContinueException&) {
-                continue;
-            }
+    const ScopeLayout& layout = stmt.body_scope;
+    ValueStack<std::optional<Value>>::Scope frame(interpreter_->locals_);
+    LoopScope scope(env, layout, LoopScope::Shared(layout) ? interpreter_->locals_.Push(layout.slots)
+                                                           : std::span<std::optional<Value>>{});
+
+    for (std::size_t i = 0; i < sequence.Size(); ++i) {
+        Enviroment* loop_env = scope.Next();
+        loop_env->SetLocal(0, sequence.At(i));
+
+        Completion completion = interpreter_->PerformList(stmt.body, loop_env);
+        if (completion.kind == Completion::Kind::Break) {
+            break;
+        }
+        if (completion.LeavesFunction()) {
+            return completion;
         }
-    } catch (const BreakException&) { }
+    }
+    return Completion::Normal();
 }
 
 
-void StatementProcessor::ProcessReturn(const ReturnStatement& stmt, Enviroment* env) {
+Completion StatementProcessor::ProcessReturn(const ReturnStatement& stmt, Enviroment* env) {
+    if (stmt.tail_call) {
+        return interpreter_->PrepareTailCall(std::get<CallableExpression>(stmt.value->value), env);
+    }
     if (stmt.value) {
-        throw ReturnException(interpreter_->ParseNode(*stmt.value, env));
+        return Completion::Return(interpreter_->ParseNode(*stmt.value, env));
     }
-    throw ReturnException(Value(NilType{}));
+    return Completion::Return(Value(NilType{}));
 }
 
 
-void StatementProcessor::ProcessBlock(const BlockStatement& stmt, Enviroment* env) {
-    interpreter_->ParseList(stmt.statements, env);
+Completion StatementProcessor::ProcessBlock(const BlockStatement& stmt, Enviroment* env) {
+    return interpreter_->ParseList(stmt.statements, env, stmt.scope);
 }
 
 
-void StatementProcessor::ProcessBreak(const BreakStatement&, Enviroment*) {
-    throw BreakException();
+Completion StatementProcessor::ProcessBreak(const BreakStatement&, Enviroment*) {
+    return Completion::Break();
 }
 
 
-void StatementProcessor::ProcessContinue(const ContinueStatement&, Enviroment*) {
-    throw ContinueException();
+Completion StatementProcessor::ProcessContinue(const ContinueStatement&, Enviroment*) {
+    return Completion::Continue();
 }
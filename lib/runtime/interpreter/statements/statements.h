@@ -1,6 +1,7 @@
 #pragma once
 #include <runtime/value/value.h>
 #include <runtime/enviroment/enviroment.h>
+#include <runtime/interpreter/statements/completion.h>
 #include <vls_and_sttmnts.h>
 #include <semantic.h>
 
@@ -11,17 +12,17 @@ public:
     StatementProcessor(Interpreter* interpreter) : interpreter_(interpreter) {}
 
     template<StatementLike T>
-    void Process(const T&, Enviroment*);
+    Completion Process(const T&, Enviroment*);
 
 
-    void ProcessExpression(const ExpressionStatement&, Enviroment*);
-    void ProcessIf(const IfStatement&, Enviroment*);
-    void ProcessWhile(const WhileStatement&, Enviroment*);
-    void ProcessFor(const ForStatement&, Enviroment*);
-    void ProcessReturn(const ReturnStatement&, Enviroment*);
-    void ProcessBlock(const BlockStatement&, Enviroment*);
-    void ProcessBreak(const BreakStatement&, Enviroment*);
-    void ProcessContinue(const ContinueStatement&, Enviroment*);
+    Completion ProcessExpression(const ExpressionStatement&, Enviroment*);
+    Completion ProcessIf(const IfStatement&, Enviroment*);
+    Completion ProcessWhile(const WhileStatement&, Enviroment*);
+    Completion ProcessFor(const ForStatement&, Enviroment*);
+    Completion ProcessReturn(const ReturnStatement&, Enviroment*);
+    Completion ProcessBlock(const BlockStatement&, Enviroment*);
+    Completion ProcessBreak(const BreakStatement&, Enviroment*);
+    Completion ProcessContinue(const ContinueStatement&, Enviroment*);
 
 private:
     Interpreter* interpreter_;
@@ -0,0 +1,217 @@
+#include <bit>
+#include <cstring>
+
+#include <runtime/jit/assembler/assembler.h>
+
+
+namespace {
+
+constexpr std::uint8_t kRex64 = 0x48;
+
+
+std::uint8_t Code(Assembler::Xmm reg) {
+    return static_cast<std::uint8_t>(reg);
+}
+
+
+// ModRM for two registers.
+std::uint8_t Direct(std::uint8_t reg, std::uint8_t rm) {
+    return 0xC0 | (reg << 3) | rm;
+}
+
+
+std::int32_t SlotOffset(std::int32_t slot) {
+    return -8 * (slot + 1);
+}
+
+} // namespace
+
+
+Assembler::Label Assembler::NewLabel() {
+    labels_.push_back(kUnbound);
+    return Label{labels_.size() - 1};
+}
+
+
+void Assembler::Bind(Label label) {
+    labels_[label.id] = code_.size();
+}
+
+
+void Assembler::Prologue() {
+    Emit({0x55});                       // push rbp
+    Emit({kRex64, 0x89, 0xE5});         // mov rbp, rsp
+    Emit({kRex64, 0x81, 0xEC});         // sub rsp, imm32
+    frame_size_at_ = code_.size();
+    Emit32(0);
+}
+
+
+void Assembler::SetFrameSize(std::int32_t bytes) {
+    std::memcpy(code_.data() + frame_size_at_, &bytes, sizeof(bytes));
+}
+
+
+void Assembler::Epilogue() {
+    Emit({kRex64, 0x89, 0xEC});         // mov rsp, rbp
+    Emit({0x5D});                       // pop rbp
+    Emit({0xC3});                       // ret
+}
+
+
+void Assembler::LoadSlot(Xmm reg, std::int32_t slot) {
+    Emit({0xF2, 0x0F, 0x10});           // movsd xmm, [rbp + disp32]
+    EmitSlotOperand(reg, slot);
+}
+
+
+void Assembler::StoreSlot(std::int32_t slot, Xmm reg) {
+    Emit({0xF2, 0x0F, 0x11});           // movsd [rbp + disp32], xmm
+    EmitSlotOperand(reg, slot);
+}
+
+
+void Assembler::LoadArgument(Xmm reg, std::int32_t index) {
+    Emit({0xF2, 0x0F, 0x10, static_cast<std::uint8_t>(0x87 | (Code(reg) << 3))});
+    Emit32(8 * index);                  // movsd xmm, [rdi + disp32]
+}
+
+
+void Assembler::LoadConstant(Xmm reg, double value) {
+    Emit({kRex64, 0xB8});               // mov rax, imm64
+    Emit64(std::bit_cast<std::uint64_t>(value));
+    Emit({0x66, kRex64, 0x0F, 0x6E, Direct(Code(reg), 0)});   // movq xmm, rax
+}
+
+
+void Assembler::Move(Xmm to, Xmm from) {
+    Emit({0x66, 0x0F, 0x28, Direct(Code(to), Code(from))});   // movapd
+}
+
+
+void Assembler::StoreDepth(std::int32_t slot) {
+    Emit({kRex64, 0x89, 0xB5});         // mov [rbp + disp32], rsi
+    Emit32(SlotOffset(slot));
+}
+
+
+void Assembler::LoadDepth(std::int32_t slot) {
+    Emit({kRex64, 0x8B, 0xB5});         // mov rsi, [rbp + disp32]
+    Emit32(SlotOffset(slot));
+}
+
+
+void Assembler::DecrementDepth() {
+    Emit({kRex64, 0x83, 0xEE, 0x01});   // sub rsi, 1
+}
+
+
+void Assembler::Push(Xmm reg) {
+    Emit({kRex64, 0x83, 0xEC, 0x08});   // sub rsp, 8
+    Emit({0xF2, 0x0F, 0x11, static_cast<std::uint8_t>(0x04 | (Code(reg) << 3)), 0x24});
+}
+
+
+void Assembler::Pop(Xmm reg) {
+    Emit({0xF2, 0x0F, 0x10, static_cast<std::uint8_t>(0x04 | (Code(reg) << 3)), 0x24});
+    Emit({kRex64, 0x83, 0xC4, 0x08});   // add rsp, 8
+}
+
+
+void Assembler::AdjustStack(std::int32_t bytes) {
+    if (bytes > 0) {
+        Emit({kRex64, 0x81, 0xC4});     // add rsp, imm32
+        Emit32(bytes);
+    } else if (bytes < 0) {
+        Emit({kRex64, 0x81, 0xEC});     // sub rsp, imm32
+        Emit32(-bytes);
+    }
+}
+
+
+void Assembler::Apply(Arithmetic op, Xmm to, Xmm from) {
+    Emit({0xF2, 0x0F, static_cast<std::uint8_t>(op), Direct(Code(to), Code(from))});
+}
+
+
+void Assembler::Negate(Xmm reg, Xmm scratch) {
+    Emit({kRex64, 0xB8});               // mov rax, sign bit
+    Emit64(0x8000'0000'0000'0000);
+    Emit({0x66, kRex64, 0x0F, 0x6E, Direct(Code(scratch), 0)});
+    Emit({0x66, 0x0F, 0x57, Direct(Code(reg), Code(scratch))});   // xorpd
+}
+
+
+void Assembler::Compare(Xmm lhs, Xmm rhs) {
+    Emit({0x66, 0x0F, 0x2E, Direct(Code(lhs), Code(rhs))});      // ucomisd
+}
+
+
+void Assembler::Jump(Label label) {
+    Emit({0xE9});
+    fixups_.push_back({code_.size(), label.id});
+    Emit32(0);
+}
+
+
+void Assembler::JumpIf(Condition condition, Label label) {
+    Emit({0x0F, static_cast<std::uint8_t>(0x80 | static_cast<std::uint8_t>(condition))});
+    fixups_.push_back({code_.size(), label.id});
+    Emit32(0);
+}
+
+
+void Assembler::PointArguments(std::int32_t slot) {
+    Emit({kRex64, 0x8D, 0xBD});         // lea rdi, [rbp + disp32]
+    Emit32(SlotOffset(slot));
+}
+
+
+void Assembler::CallStart() {
+    Emit({0xE8});                       // call rel32
+    Emit32(-static_cast<std::int32_t>(code_.size() + 4));
+}
+
+
+void Assembler::CallAddress(const void* target) {
+    Emit({kRex64, 0xB8});               // mov rax, imm64
+    Emit64(reinterpret_cast<std::uint64_t>(target));
+    Emit({0xFF, 0xD0});                 // call rax
+}
+
+
+const std::vector<std::uint8_t>& Assembler::Finish() {
+    for (const auto& fixup : fixups_) {
+        auto target = static_cast<std::int64_t>(labels_[fixup.label]);
+        auto rel = static_cast<std::int32_t>(target - static_cast<std::int64_t>(fixup.at + 4));
+        std::memcpy(code_.data() + fixup.at, &rel, sizeof(rel));
+    }
+    fixups_.clear();
+    return code_;
+}
+
+
+void Assembler::Emit(std::initializer_list<std::uint8_t> bytes) {
+    code_.insert(code_.end(), bytes);
+}
+
+
+void Assembler::Emit32(std::int32_t value) {
+    auto bits = static_cast<std::uint32_t>(value);
+    for (int i = 0; i < 4; ++i) {
+        code_.push_back(static_cast<std::uint8_t>(bits >> (8 * i)));
+    }
+}
+
+
+void Assembler::Emit64(std::uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        code_.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+}
+
+
+void Assembler::EmitSlotOperand(Xmm reg, std::int32_t slot) {
+    Emit({static_cast<std::uint8_t>(0x85 | (Code(reg) << 3))});
+    Emit32(SlotOffset(slot));
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+
+// Emits the handful of x86-64 instructions the JIT needs. Doubles live in
+// xmm0-xmm2 and in 8-byte frame slots addressed from rbp; rdi points at the
+// arguments of the function being entered and rsi holds how many more calls
+// it may nest. Jumps go to labels, which are resolved by Finish.
+class Assembler {
+public:
+    enum class Xmm : std::uint8_t { X0, X1, X2 };
+
+    // Conditions as the low nibble of the two-byte Jcc opcode, read after
+    // ucomisd: unordered operands set ZF, PF and CF.
+    enum class Condition : std::uint8_t {
+        Below = 0x2,
+        AboveEqual = 0x3,
+        Equal = 0x4,
+        NotEqual = 0x5,
+        BelowEqual = 0x6,
+        Above = 0x7,
+        Parity = 0xA,
+    };
+
+    enum class Arithmetic : std::uint8_t {
+        Add = 0x58,
+        Mul = 0x59,
+        Sub = 0x5C,
+        Div = 0x5E,
+    };
+
+    struct Label {
+        std::size_t id;
+    };
+
+public:
+    Label NewLabel();
+    void Bind(Label);
+
+    // push rbp; mov rbp, rsp; sub rsp, <frame>. The frame size is known only
+    // once the body is emitted and is filled in by SetFrameSize.
+    void Prologue();
+    void SetFrameSize(std::int32_t);
+    void Epilogue();
+
+    void LoadSlot(Xmm, std::int32_t slot);
+    void StoreSlot(std::int32_t slot, Xmm);
+    void LoadArgument(Xmm, std::int32_t index);
+    void LoadConstant(Xmm, double);
+    void Move(Xmm to, Xmm from);
+
+    // The nesting budget in rsi: kept in a slot, reloaded and decremented
+    // for each call. The decrement sets the carry flag once it runs out.
+    void StoreDepth(std::int32_t slot);
+    void LoadDepth(std::int32_t slot);
+    void DecrementDepth();
+
+    // Temporaries are pushed below the frame, 8 bytes each.
+    void Push(Xmm);
+    void Pop(Xmm);
+    void AdjustStack(std::int32_t bytes);
+
+    void Apply(Arithmetic, Xmm to, Xmm from);
+    void Negate(Xmm, Xmm scratch);
+    void Compare(Xmm, Xmm);
+
+    void Jump(Label);
+    void JumpIf(Condition, Label);
+
+    // rdi = address of `slot`. Slots grow downwards, so argument i of the
+    // call is read from slot `slot - i`.
+    void PointArguments(std::int32_t slot);
+    // Calls the code at offset 0, i.e. the function being emitted.
+    void CallStart();
+    void CallAddress(const void*);
+
+    // The code with every jump resolved.
+    const std::vector<std::uint8_t>& Finish();
+
+private:
+    void Emit(std::initializer_list<std::uint8_t>);
+    void Emit32(std::int32_t);
+    void Emit64(std::uint64_t);
+    void EmitSlotOperand(Xmm, std::int32_t slot);
+
+private:
+    static constexpr std::size_t kUnbound = static_cast<std::size_t>(-1);
+
+    struct Fixup {
+        std::size_t at;
+        std::size_t label;
+    };
+
+    std::vector<std::uint8_t> code_;
+    std::vector<std::size_t> labels_;
+    std::vector<Fixup> fixups_;
+    std::size_t frame_size_at_ = 0;
+};
@@ -0,0 +1,785 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <csetjmp>
+#include <optional>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define ITMO_JIT_X86_64 1
+#include <sys/mman.h>
+#endif
+
+#include <runtime/jit/jit.h>
+#include <runtime/jit/assembler/assembler.h>
+
+
+namespace {
+
+constexpr std::size_t kMaxArity = 16;
+constexpr std::uint32_t kMaxDeopts = 64;
+
+using Xmm = Assembler::Xmm;
+using Condition = Assembler::Condition;
+using Label = Assembler::Label;
+
+
+// Where native code that cannot go on jumps back to; set by JitFunction::Call.
+// Native frames own nothing, so leaving them with longjmp is safe.
+thread_local std::jmp_buf* bailout = nullptr;
+
+
+constexpr int kBailout = 1;
+constexpr int kDepthExceeded = 2;
+
+
+[[noreturn]] void Bailout() {
+    std::longjmp(*bailout, kBailout);
+}
+
+
+[[noreturn]] void ExceedDepth() {
+    std::longjmp(*bailout, kDepthExceeded);
+}
+
+
+// range() with a zero step or too many elements fails; the interpreter
+// reports it when the call runs again.
+double RangeSize(double start, double stop, double step) {
+    std::optional<std::size_t> size;
+    if (step == 0 || !(size = Range::Size(start, stop, step))) {
+        Bailout();
+    }
+    return static_cast<double>(*size);
+}
+
+
+double Mod(double x, double y) {
+    return std::fmod(x, y);
+}
+
+
+double Power(double x, double y) {
+    return std::pow(x, y);
+}
+
+
+// Thrown while compiling a body that uses something the JIT does not handle.
+struct Unsupported {};
+
+
+const Expression& Unfused(const Expression& expr) {
+    if (const auto* fused = std::get_if<FusedExpression>(&expr.value)) {
+        return Unfused(*fused->original);
+    }
+    return expr;
+}
+
+
+// Lowers a function body to native code. Every local of the function and
+// of the scopes inside it gets a frame slot; a local may only be read where
+// it is assigned on every path, so it always holds a number.
+class JitCompiler {
+public:
+    using Guard = std::pair<std::size_t, const FunctionalObject*>;
+
+    JitCompiler(const FunctionalObject& function, GlobalTable& globals)
+        : function_(function)
+        , globals_(globals)
+    {}
+
+    std::vector<std::uint8_t> Compile();
+
+    const std::vector<Guard>& Guards() const { return guards_; }
+
+private:
+    struct Scope {
+        std::vector<std::int32_t> slots;
+        std::vector<bool> assigned;
+    };
+
+    struct Loop {
+        Label next;
+        Label exit;
+    };
+
+private:
+    void CompileStatements(const std::vector<Statement>&);
+    void CompileScope(const std::vector<Statement>&, const ScopeLayout&);
+    void CompileStatement(const Statement&);
+    void CompileIf(const IfStatement&);
+    void CompileWhile(const WhileStatement&);
+    void CompileFor(const ForStatement&);
+
+    void CompileExpression(const Expression&);
+    void CompileOperands(const Expression&, const Expression&);
+    void CompileArithmetic(TokenType);
+    void CompileAssign(const AssignExpression&);
+    void CompileCall(const CallableExpression&);
+    void CompileTailCall(const CallableExpression&);
+    void CompileBranch(const Expression&, bool, Label);
+    void CompileComparison(TokenType, bool, Label);
+
+    void CallHelper(const void*);
+    std::int32_t Resolve(const LexicalAddress&, bool);
+    bool IsAssigned(const LexicalAddress&) const;
+    std::int32_t NewSlot();
+    const FunctionalObject& GuardGlobal(const Expression&);
+
+    std::vector<std::vector<bool>> SaveAssigned() const;
+    void RestoreAssigned(const std::vector<std::vector<bool>>&);
+
+private:
+    const FunctionalObject& function_;
+    GlobalTable& globals_;
+    Assembler asm_;
+    std::vector<Scope> scopes_;
+    std::vector<Loop> loops_;
+    std::vector<Guard> guards_;
+    Label return_{};
+    Label body_{};
+    std::vector<std::int32_t> parameters_;
+    std::int32_t depth_ = 0;
+    std::int32_t slots_ = 0;
+    int pushed_ = 0;
+};
+
+
+std::vector<std::uint8_t> JitCompiler::Compile() {
+    if (function_.native || !function_.f_body || function_.parameters.size() > kMaxArity) {
+        throw Unsupported{};
+    }
+
+    asm_.Prologue();
+    return_ = asm_.NewLabel();
+
+    depth_ = NewSlot();
+    asm_.StoreDepth(depth_);
+
+    scopes_.emplace_back();
+    auto arity = static_cast<std::uint32_t>(function_.parameters.size());
+    for (std::uint32_t i = 0; i < arity; ++i) {
+        parameters_.push_back(Resolve({LexicalAddress::Kind::Local, 0, i}, true));
+        asm_.LoadArgument(Xmm::X0, static_cast<std::int32_t>(i));
+        asm_.StoreSlot(parameters_.back(), Xmm::X0);
+    }
+    body_ = asm_.NewLabel();
+    asm_.Bind(body_);
+
+    CompileStatements(*function_.f_body);
+
+    // Falling off the end returns nil, which only the interpreter can do.
+    CallHelper(reinterpret_cast<const void*>(&Bailout));
+
+    asm_.Bind(return_);
+    asm_.Epilogue();
+    asm_.SetFrameSize((8 * slots_ + 15) / 16 * 16);
+    return asm_.Finish();
+}
+
+
+void JitCompiler::CompileStatements(const std::vector<Statement>& stmts) {
+    for (const auto& stmt : stmts) {
+        CompileStatement(stmt);
+    }
+}
+
+
+void JitCompiler::CompileScope(const std::vector<Statement>& stmts, const ScopeLayout& layout) {
+    if (layout.elided) {
+        CompileStatements(stmts);
+        return;
+    }
+    scopes_.emplace_back();
+    CompileStatements(stmts);
+    scopes_.pop_back();
+}
+
+
+void JitCompiler::CompileStatement(const Statement& stmt) {
+    std::visit([this](const auto& node) {
+        using T = std::decay_t<decltype(node)>;
+
+        if constexpr (std::is_same_v<T, ExpressionStatement>) {
+            CompileExpression(node.expression);
+        } else if constexpr (std::is_same_v<T, IfStatement>) {
+            CompileIf(node);
+        } else if constexpr (std::is_same_v<T, WhileStatement>) {
+            CompileWhile(node);
+        } else if constexpr (std::is_same_v<T, ForStatement>) {
+            CompileFor(node);
+        } else if constexpr (std::is_same_v<T, ReturnStatement>) {
+            if (!node.value) {
+                throw Unsupported{};
+            }
+            if (const auto* call = std::get_if<CallableExpression>(&Unfused(*node.value).value)) {
+                CompileTailCall(*call);
+                return;
+            }
+            CompileExpression(*node.value);
+            asm_.Jump(return_);
+        } else if constexpr (std::is_same_v<T, BlockStatement>) {
+            CompileScope(node.statements, node.scope);
+        } else if constexpr (std::is_same_v<T, BreakStatement>) {
+            if (loops_.empty()) {
+                throw Unsupported{};
+            }
+            asm_.Jump(loops_.back().exit);
+        } else if constexpr (std::is_same_v<T, ContinueStatement>) {
+            if (loops_.empty()) {
+                throw Unsupported{};
+            }
+            asm_.Jump(loops_.back().next);
+        }
+    }, stmt.value);
+}
+
+
+// What a branch or a loop body assigns does not count after it, since it
+// may not have run.
+void JitCompiler::CompileIf(const IfStatement& stmt) {
+    Label otherwise = asm_.NewLabel();
+    CompileBranch(stmt.condition, false, otherwise);
+
+    auto assigned = SaveAssigned();
+    CompileScope(stmt.then_case, stmt.then_scope);
+    RestoreAssigned(assigned);
+
+    if (stmt.else_case.empty()) {
+        asm_.Bind(otherwise);
+        return;
+    }
+
+    Label end = asm_.NewLabel();
+    asm_.Jump(end);
+    asm_.Bind(otherwise);
+    CompileScope(stmt.else_case, stmt.else_scope);
+    RestoreAssigned(assigned);
+    asm_.Bind(end);
+}
+
+
+void JitCompiler::CompileWhile(const WhileStatement& stmt) {
+    Label top = asm_.NewLabel();
+    Label exit = asm_.NewLabel();
+
+    asm_.Bind(top);
+    CompileBranch(stmt.condition, false, exit);
+
+    auto assigned = SaveAssigned();
+    loops_.push_back({top, exit});
+    CompileScope(stmt.body, stmt.body_scope);
+    loops_.pop_back();
+    RestoreAssigned(assigned);
+
+    asm_.Jump(top);
+    asm_.Bind(exit);
+}
+
+
+// Only `for v in range(...)` with a range() that is still the builtin. The
+// loop walks a counter and computes v the way Range::At does.
+void JitCompiler::CompileFor(const ForStatement& stmt) {
+    const auto* call = std::get_if<CallableExpression>(&Unfused(stmt.iter).value);
+    if (!call || call->f_arguments.empty() || call->f_arguments.size() > 3) {
+        throw Unsupported{};
+    }
+    const auto* callee = std::get_if<VariableExpression>(&Unfused(*call->callable).value);
+    if (!callee || callee->name != "range" || !GuardGlobal(*call->callable).native) {
+        throw Unsupported{};
+    }
+
+    std::int32_t start = NewSlot();
+    std::int32_t stop = NewSlot();
+    std::int32_t step = NewSlot();
+    std::int32_t size = NewSlot();
+    std::int32_t counter = NewSlot();
+
+    const auto& args = call->f_arguments;
+    asm_.LoadConstant(Xmm::X0, 0);
+    asm_.StoreSlot(start, Xmm::X0);
+    asm_.LoadConstant(Xmm::X0, 1);
+    asm_.StoreSlot(step, Xmm::X0);
+    if (args.size() == 1) {
+        CompileExpression(*args[0]);
+        asm_.StoreSlot(stop, Xmm::X0);
+    } else {
+        CompileExpression(*args[0]);
+        asm_.StoreSlot(start, Xmm::X0);
+        CompileExpression(*args[1]);
+        asm_.StoreSlot(stop, Xmm::X0);
+        if (args.size() == 3) {
+            CompileExpression(*args[2]);
+            asm_.StoreSlot(step, Xmm::X0);
+        }
+    }
+
+    asm_.LoadSlot(Xmm::X0, start);
+    asm_.LoadSlot(Xmm::X1, stop);
+    asm_.LoadSlot(Xmm::X2, step);
+    CallHelper(reinterpret_cast<const void*>(&RangeSize));
+    asm_.StoreSlot(size, Xmm::X0);
+    asm_.LoadConstant(Xmm::X0, 0);
+    asm_.StoreSlot(counter, Xmm::X0);
+
+    Label top = asm_.NewLabel();
+    Label next = asm_.NewLabel();
+    Label exit = asm_.NewLabel();
+
+    asm_.Bind(top);
+    asm_.LoadSlot(Xmm::X0, counter);
+    asm_.LoadSlot(Xmm::X1, size);
+    asm_.Compare(Xmm::X0, Xmm::X1);
+    asm_.JumpIf(Condition::AboveEqual, exit);
+
+    auto assigned = SaveAssigned();
+    scopes_.emplace_back();
+    asm_.LoadSlot(Xmm::X1, step);
+    asm_.Apply(Assembler::Arithmetic::Mul, Xmm::X0, Xmm::X1);
+    asm_.LoadSlot(Xmm::X1, start);
+    asm_.Apply(Assembler::Arithmetic::Add, Xmm::X1, Xmm::X0);
+    asm_.StoreSlot(Resolve({LexicalAddress::Kind::Local, 0, 0}, true), Xmm::X1);
+
+    loops_.push_back({next, exit});
+    CompileStatements(stmt.body);
+    loops_.pop_back();
+    scopes_.pop_back();
+    RestoreAssigned(assigned);
+
+    asm_.Bind(next);
+    asm_.LoadSlot(Xmm::X0, counter);
+    asm_.LoadConstant(Xmm::X1, 1);
+    asm_.Apply(Assembler::Arithmetic::Add, Xmm::X0, Xmm::X1);
+    asm_.StoreSlot(counter, Xmm::X0);
+    asm_.Jump(top);
+    asm_.Bind(exit);
+}
+
+
+// Leaves the value of the expression in xmm0.
+void JitCompiler::CompileExpression(const Expression& expr) {
+    std::visit([this](const auto& node) {
+        using T = std::decay_t<decltype(node)>;
+
+        if constexpr (std::is_same_v<T, NumberExpression>) {
+            asm_.LoadConstant(Xmm::X0, node.value);
+        } else if constexpr (std::is_same_v<T, VariableExpression>) {
+            asm_.LoadSlot(Xmm::X0, Resolve(node.address, false));
+        } else if constexpr (std::is_same_v<T, UnaryExpression>) {
+            if (node.operation != TokenType::minus_) {
+                throw Unsupported{};
+            }
+            CompileExpression(*node.rhs);
+            asm_.Negate(Xmm::X0, Xmm::X1);
+        } else if constexpr (std::is_same_v<T, BinaryExpression>) {
+            CompileOperands(*node.lhs, *node.rhs);
+            CompileArithmetic(node.operation);
+        } else if constexpr (std::is_same_v<T, AssignExpression>) {
+            CompileAssign(node);
+        } else if constexpr (std::is_same_v<T, CallableExpression>) {
+            CompileCall(node);
+        } else if constexpr (std::is_same_v<T, FusedExpression>) {
+            CompileExpression(*node.original);
+        } else {
+            throw Unsupported{};
+        }
+    }, expr.value);
+}
+
+
+// Left operand in xmm0, right operand in xmm1. A literal or a variable on
+// the right is loaded directly instead of going through the stack.
+void JitCompiler::CompileOperands(const Expression& lhs, const Expression& rhs) {
+    const Expression& right = Unfused(rhs);
+    if (const auto* number = std::get_if<NumberExpression>(&right.value)) {
+        CompileExpression(lhs);
+        asm_.LoadConstant(Xmm::X1, number->value);
+        return;
+    }
+    if (const auto* var = std::get_if<VariableExpression>(&right.value); var && IsAssigned(var->address)) {
+        CompileExpression(lhs);
+        asm_.LoadSlot(Xmm::X1, Resolve(var->address, false));
+        return;
+    }
+
+    CompileExpression(lhs);
+    asm_.Push(Xmm::X0);
+    ++pushed_;
+    CompileExpression(rhs);
+    asm_.Move(Xmm::X1, Xmm::X0);
+    asm_.Pop(Xmm::X0);
+    --pushed_;
+}
+
+
+void JitCompiler::CompileArithmetic(TokenType op) {
+    switch (op) {
+        case TokenType::plus_:
+            asm_.Apply(Assembler::Arithmetic::Add, Xmm::X0, Xmm::X1);
+            break;
+        case TokenType::minus_:
+            asm_.Apply(Assembler::Arithmetic::Sub, Xmm::X0, Xmm::X1);
+            break;
+        case TokenType::star_:
+            asm_.Apply(Assembler::Arithmetic::Mul, Xmm::X0, Xmm::X1);
+            break;
+        case TokenType::slash_:
+            asm_.Apply(Assembler::Arithmetic::Div, Xmm::X0, Xmm::X1);
+            break;
+        case TokenType::percent_:
+            CallHelper(reinterpret_cast<const void*>(&Mod));
+            break;
+        case TokenType::degree_:
+            CallHelper(reinterpret_cast<const void*>(&Power));
+            break;
+        default:
+            throw Unsupported{};
+    }
+}
+
+
+void JitCompiler::CompileAssign(const AssignExpression& expr) {
+    if (expr.operation == TokenType::assign_) {
+        CompileExpression(*expr.rhs);
+        asm_.StoreSlot(Resolve(expr.address, true), Xmm::X0);
+        return;
+    }
+
+    std::int32_t slot = Resolve(expr.address, false);
+    CompileExpression(*expr.rhs);
+    asm_.Move(Xmm::X1, Xmm::X0);
+    asm_.LoadSlot(Xmm::X0, slot);
+    CompileArithmetic(CompoundBaseOperation(expr.operation));
+    asm_.StoreSlot(slot, Xmm::X0);
+}
+
+
+// Only calls of the function itself, through the global it is stored in.
+// The arguments are stored in consecutive slots the callee reads them from.
+void JitCompiler::CompileCall(const CallableExpression& expr) {
+    if (&GuardGlobal(*expr.callable) != &function_
+        || expr.f_arguments.size() != function_.parameters.size())
+    {
+        throw Unsupported{};
+    }
+
+    auto arity = static_cast<std::int32_t>(expr.f_arguments.size());
+    std::int32_t base = slots_;
+    slots_ += arity;
+    for (std::int32_t i = 0; i < arity; ++i) {
+        CompileExpression(*expr.f_arguments[i]);
+        asm_.StoreSlot(base + arity - 1 - i, Xmm::X0);
+    }
+    asm_.PointArguments(base + arity - 1);
+
+    Label nested = asm_.NewLabel();
+    asm_.LoadDepth(depth_);
+    asm_.DecrementDepth();
+    asm_.JumpIf(Condition::AboveEqual, nested);
+    CallHelper(reinterpret_cast<const void*>(&ExceedDepth));
+    asm_.Bind(nested);
+
+    bool pad = pushed_ % 2 != 0;
+    if (pad) {
+        asm_.AdjustStack(-8);
+    }
+    asm_.CallStart();
+    if (pad) {
+        asm_.AdjustStack(8);
+    }
+}
+
+
+// A self-call in tail position reuses the frame: the arguments replace the
+// parameters and the body starts over, so tail recursion runs as a loop.
+void JitCompiler::CompileTailCall(const CallableExpression& expr) {
+    if (&GuardGlobal(*expr.callable) != &function_
+        || expr.f_arguments.size() != function_.parameters.size())
+    {
+        throw Unsupported{};
+    }
+
+    std::vector<std::int32_t> values;
+    for (const auto& argument : expr.f_arguments) {
+        CompileExpression(*argument);
+        values.push_back(NewSlot());
+        asm_.StoreSlot(values.back(), Xmm::X0);
+    }
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        asm_.LoadSlot(Xmm::X0, values[i]);
+        asm_.StoreSlot(parameters_[i], Xmm::X0);
+    }
+    asm_.Jump(body_);
+}
+
+
+// Jumps to `target` when the truth of the condition equals `when`. Only
+// comparisons, boolean literals and not/and/or over them are handled.
+void JitCompiler::CompileBranch(const Expression& condition, bool when, Label target) {
+    const Expression& expr = Unfused(condition);
+
+    if (const auto* literal = std::get_if<BoolExpression>(&expr.value)) {
+        if (literal->value == when) {
+            asm_.Jump(target);
+        }
+        return;
+    }
+
+    if (const auto* unary = std::get_if<UnaryExpression>(&expr.value)) {
+        if (unary->operation != TokenType::not_) {
+            throw Unsupported{};
+        }
+        CompileBranch(*unary->rhs, !when, target);
+        return;
+    }
+
+    const auto* binary = std::get_if<BinaryExpression>(&expr.value);
+    if (!binary) {
+        throw Unsupported{};
+    }
+
+    bool conjunction = binary->operation == TokenType::and_;
+    if (conjunction || binary->operation == TokenType::or_) {
+        // `a and b` is false as soon as `a` is, `a or b` true as soon as `a` is.
+        if (when != conjunction) {
+            CompileBranch(*binary->lhs, when, target);
+            CompileBranch(*binary->rhs, when, target);
+        } else {
+            Label skip = asm_.NewLabel();
+            CompileBranch(*binary->lhs, !when, skip);
+            CompileBranch(*binary->rhs, when, target);
+            asm_.Bind(skip);
+        }
+        return;
+    }
+
+    CompileOperands(*binary->lhs, *binary->rhs);
+    CompileComparison(binary->operation, when, target);
+}
+
+
+// Compares xmm0 with xmm1. After ucomisd an unordered result sets ZF, PF and
+// CF, so every comparison with a NaN comes out false, as in C++.
+void JitCompiler::CompileComparison(TokenType op, bool when, Label target) {
+    switch (op) {
+        case TokenType::less_:
+            asm_.Compare(Xmm::X1, Xmm::X0);
+            asm_.JumpIf(when ? Condition::Above : Condition::BelowEqual, target);
+            return;
+        case TokenType::less_eq_:
+            asm_.Compare(Xmm::X1, Xmm::X0);
+            asm_.JumpIf(when ? Condition::AboveEqual : Condition::Below, target);
+            return;
+        case TokenType::greater_:
+            asm_.Compare(Xmm::X0, Xmm::X1);
+            asm_.JumpIf(when ? Condition::Above : Condition::BelowEqual, target);
+            return;
+        case TokenType::greater_eq_:
+            asm_.Compare(Xmm::X0, Xmm::X1);
+            asm_.JumpIf(when ? Condition::AboveEqual : Condition::Below, target);
+            return;
+        case TokenType::double_eq_:
+        case TokenType::not_eq_:
+            break;
+        default:
+            throw Unsupported{};
+    }
+
+    asm_.Compare(Xmm::X0, Xmm::X1);
+    if (when == (op == TokenType::double_eq_)) {
+        Label skip = asm_.NewLabel();
+        asm_.JumpIf(Condition::Parity, skip);
+        asm_.JumpIf(Condition::Equal, target);
+        asm_.Bind(skip);
+    } else {
+        asm_.JumpIf(Condition::Parity, target);
+        asm_.JumpIf(Condition::NotEqual, target);
+    }
+}
+
+
+// Helpers take their arguments in xmm0-xmm2 and need rsp aligned to 16.
+void JitCompiler::CallHelper(const void* helper) {
+    bool pad = pushed_ % 2 != 0;
+    if (pad) {
+        asm_.AdjustStack(-8);
+    }
+    asm_.CallAddress(helper);
+    if (pad) {
+        asm_.AdjustStack(8);
+    }
+}
+
+
+// The frame slot of a local of this function. Names of enclosing functions
+// and globals are not handled.
+std::int32_t JitCompiler::Resolve(const LexicalAddress& address, bool write) {
+    if (address.kind != LexicalAddress::Kind::Local || address.depth >= scopes_.size()) {
+        throw Unsupported{};
+    }
+    Scope& scope = scopes_[scopes_.size() - 1 - address.depth];
+    if (address.slot >= scope.slots.size()) {
+        scope.slots.resize(address.slot + 1, -1);
+        scope.assigned.resize(address.slot + 1, false);
+    }
+    if (!write && !scope.assigned[address.slot]) {
+        throw Unsupported{};
+    }
+    if (scope.slots[address.slot] < 0) {
+        scope.slots[address.slot] = NewSlot();
+    }
+    if (write) {
+        scope.assigned[address.slot] = true;
+    }
+    return scope.slots[address.slot];
+}
+
+
+bool JitCompiler::IsAssigned(const LexicalAddress& address) const {
+    if (address.kind != LexicalAddress::Kind::Local || address.depth >= scopes_.size()) {
+        return false;
+    }
+    const Scope& scope = scopes_[scopes_.size() - 1 - address.depth];
+    return address.slot < scope.assigned.size() && scope.assigned[address.slot];
+}
+
+
+std::int32_t JitCompiler::NewSlot() {
+    return slots_++;
+}
+
+
+// The function object a global callee holds now; the compiled code checks
+// on entry that it still does.
+const FunctionalObject& JitCompiler::GuardGlobal(const Expression& callee) {
+    const auto* var = std::get_if<VariableExpression>(&Unfused(callee).value);
+    if (!var || var->address.kind != LexicalAddress::Kind::Global) {
+        throw Unsupported{};
+    }
+    const Value* value = globals_.Find(var->address.slot);
+    if (!value || !value->IsFunction()) {
+        throw Unsupported{};
+    }
+
+    const FunctionalObject* function = value->AsFunction().get();
+    Guard guard{var->address.slot, function};
+    if (std::find(guards_.begin(), guards_.end(), guard) == guards_.end()) {
+        guards_.push_back(guard);
+    }
+    return *function;
+}
+
+
+std::vector<std::vector<bool>> JitCompiler::SaveAssigned() const {
+    std::vector<std::vector<bool>> assigned;
+    assigned.reserve(scopes_.size());
+    for (const auto& scope : scopes_) {
+        assigned.push_back(scope.assigned);
+    }
+    return assigned;
+}
+
+
+void JitCompiler::RestoreAssigned(const std::vector<std::vector<bool>>& assigned) {
+    for (std::size_t i = 0; i < assigned.size(); ++i) {
+        scopes_[i].assigned = assigned[i];
+        scopes_[i].assigned.resize(scopes_[i].slots.size(), false);
+    }
+}
+
+} // namespace
+
+
+JitFunction::JitFunction(void* code, std::size_t size, std::size_t arity
+                        , std::vector<GlobalGuard> guards)
+    : code_(code)
+    , size_(size)
+    , arity_(arity)
+    , guards_(std::move(guards))
+{}
+
+
+std::shared_ptr<JitFunction> JitFunction::Compile(const FunctionalObject& function, GlobalTable& globals) {
+#ifdef ITMO_JIT_X86_64
+    JitCompiler compiler(function, globals);
+    std::vector<std::uint8_t> code;
+    try {
+        code = compiler.Compile();
+    } catch (const Unsupported&) {
+        return nullptr;
+    }
+
+    void* memory = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE
+                        , MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(memory, code.data(), code.size());
+    if (mprotect(memory, code.size(), PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, code.size());
+        return nullptr;
+    }
+
+    std::vector<GlobalGuard> guards;
+    for (const auto& [slot, expected] : compiler.Guards()) {
+        guards.push_back({slot, expected});
+    }
+    return std::shared_ptr<JitFunction>(
+        new JitFunction(memory, code.size(), function.parameters.size(), std::move(guards)));
+#else
+    (void)function;
+    (void)globals;
+    return nullptr;
+#endif
+}
+
+
+JitFunction::~JitFunction() {
+#ifdef ITMO_JIT_X86_64
+    munmap(code_, size_);
+#endif
+}
+
+
+std::optional<Value> JitFunction::Call(FunctionalObject::Arguments args, GlobalTable& globals
+                                    , std::size_t depth)
+{
+    std::array<double, kMaxArity> values{};
+    bool admitted = args.size() >= arity_;
+    for (std::size_t i = 0; admitted && i < arity_; ++i) {
+        admitted = args[i].IsNumber();
+        if (admitted) {
+            values[i] = args[i].AsNumber();
+        }
+    }
+    for (std::size_t i = 0; admitted && i < guards_.size(); ++i) {
+        const Value* value = globals.Find(guards_[i].slot);
+        admitted = value && value->IsFunction() && value->AsFunction().get() == guards_[i].expected;
+    }
+    if (!admitted) {
+        ++deopts_;
+        return std::nullopt;
+    }
+
+    std::jmp_buf buffer;
+    std::jmp_buf* outer = bailout;
+    bailout = &buffer;
+    if (int reason = setjmp(buffer); reason != 0) {
+        bailout = outer;
+        if (reason == kDepthExceeded) {
+            throw DepthExceeded{};
+        }
+        ++deopts_;
+        return std::nullopt;
+    }
+    double result = reinterpret_cast<Entry>(code_)(values.data(), depth);
+    bailout = outer;
+    return Value(result);
+}
+
+
+bool JitFunction::Exhausted() const {
+    return deopts_ >= kMaxDeopts;
+}
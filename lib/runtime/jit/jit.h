@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <runtime/value/value.h>
+#include <runtime/function/function.h>
+#include <runtime/enviroment/global_table.h>
+
+
+// Calls a script function makes through the tree-walker before it is handed
+// to the JIT.
+inline constexpr std::uint32_t kJitThreshold = 16;
+
+
+// Native x86-64 code for a script function that only computes with numbers:
+// it reads its own parameters and locals, number literals and arithmetic,
+// branches on comparisons, loops with while and for over range(), and calls
+// itself. Such a function has no side effects, so whenever the native code
+// cannot continue it is abandoned and the whole call runs again in the
+// interpreter. Doubles stay unboxed in registers and frame slots.
+class JitFunction {
+public:
+    // nullptr when the body uses anything the JIT does not handle, or when
+    // the build does not target x86-64 Linux.
+    static std::shared_ptr<JitFunction> Compile(const FunctionalObject&, GlobalTable&);
+
+    ~JitFunction();
+
+    // Thrown by Call when the function recursed more than `depth` times.
+    struct DepthExceeded {};
+
+    // The result of the call, or nullopt when a guard failed: an argument is
+    // not a number, or a global the code relies on was reassigned. The call
+    // may nest `depth` more calls of itself.
+    std::optional<Value> Call(FunctionalObject::Arguments, GlobalTable&, std::size_t depth);
+
+    // Failed guards are counted; past a limit the code is not worth keeping.
+    bool Exhausted() const;
+
+private:
+    // The code relies on a global still holding this function object: the
+    // function itself for recursive calls, or the range builtin.
+    struct GlobalGuard {
+        std::size_t slot;
+        const FunctionalObject* expected;
+    };
+
+    using Entry = double (*)(const double*, std::size_t);
+
+    JitFunction(void*, std::size_t, std::size_t, std::vector<GlobalGuard>);
+
+private:
+    void* code_;
+    std::size_t size_;
+    std::size_t arity_;
+    std::vector<GlobalGuard> guards_;
+    std::uint32_t deopts_ = 0;
+};
@@ -1,121 +1,183 @@
+#include <cmath>
+#include <limits>
+#include <new>
 #include <sstream>
 
 #include <value.h>
 #include <errors/val_errors.h>
 
 
-Value::Value()
-    : data(NilType{})
+Range::Range(double start, double stop, double step)
+    : start(start)
+    , step(step)
+    , size(Size(start, stop, step).value_or(0))
 {}
 
-Value::Value(double val)
-    : data(val)
-{}
+
+std::optional<std::size_t> Range::Size(double start, double stop, double step) {
+    double count = std::ceil((stop - start) / step);
+    if (!std::isfinite(count) || count >= std::ldexp(1.0, std::numeric_limits<std::size_t>::digits)) {
+        return std::nullopt;
+    }
+    return count > 0 ? static_cast<std::size_t>(count) : 0;
+}
+
 
 Value::Value(const std::string& val)
-    : data(val)
+    : bits_(Box(Kind::String, new Boxed<std::string>(val)))
 {}
 
-Value::Value(const char* str)
-    : data(std::string(str))
+Value::Value(std::string&& val)
+    : bits_(Box(Kind::String, new Boxed<std::string>(std::move(val))))
 {}
 
-Value::Value(NilType val)
-    : data(val)
+Value::Value(const char* str)
+    : Value(std::string(str))
 {}
 
 Value::Value(const Array& val)
-    : data(val)
+    : bits_(Box(Kind::List, new Boxed<List>(List(val))))
 {}
 
-Value::Value(FuncPtr val)
-    : data(val)
+Value::Value(Array&& val)
+    : bits_(Box(Kind::List, new Boxed<List>(List(std::move(val)))))
 {}
 
+Value::Value(Array&& val, ListStorage& storage)
+    : bits_(Box(Kind::List, new (storage.bytes) Boxed<List>(List(std::move(val)))))
+{
+    static_assert(sizeof(Boxed<List>) <= sizeof(ListStorage));
+    static_assert(alignof(Boxed<List>) <= alignof(ListStorage));
+    GetCell()->borrowed = true;
+}
 
-bool Value::IsNumber() const { return std::holds_alternative<double>(data); }
+Value::Value(FuncPtr val)
+    : bits_(Box(Kind::Function, new Boxed<FuncPtr>(std::move(val))))
+{}
 
-bool Value::IsString() const { return std::holds_alternative<std::string>(data); }
+Value::Value(Range val)
+    : bits_(Box(Kind::List, new Boxed<List>(List(val))))
+{}
 
-bool Value::IsBool() const { return std::holds_alternative<bool>(data); }
 
-bool Value::IsNil() const { return std::holds_alternative<NilType>(data); }
+std::uint64_t Value::Box(Kind kind, const Cell* cell) {
+    static_assert(TagOf(Kind::Nil) == kBoxedBase);
+    static_assert(TagOf(Kind::String) == kHeapBase);
+    return TagOf(kind) | (reinterpret_cast<std::uint64_t>(cell) & kPayloadMask);
+}
 
-bool Value::IsList() const { return std::holds_alternative<Array>(data); }
 
-bool Value::IsFunction() const { return std::holds_alternative<FuncPtr>(data); }
+void Value::Destroy() {
+    switch (GetKind()) {
+        case Kind::String: delete static_cast<Boxed<std::string>*>(GetCell()); break;
+        case Kind::List: {
+            auto* list = static_cast<Boxed<List>*>(GetCell());
+            if (list->borrowed) {
+                list->~Boxed();
+            } else {
+                delete list;
+            }
+            break;
+        }
+        case Kind::Function: delete static_cast<Boxed<FuncPtr>*>(GetCell()); break;
+        default: break;
+    }
+}
 
 
-double Value::AsNumber() const {
-    if (auto* ptr = std::get_if<double>(&data)) {
-        return *ptr;
-    }
+void Value::ThrowNotNumber() {
     throw ValueErrors(ValueErrors::kValueNotNumber);
 }
 
 
 const std::string& Value::AsString() const {
-    if (auto* ptr = std::get_if<std::string>(&data)) {
-        return *ptr;
+    if (IsString()) {
+        return Payload<std::string>();
     }
     throw ValueErrors(ValueErrors::kValueNotString);
 }
 
 
 bool Value::AsBool() const {
-    if (auto* ptr = std::get_if<bool>(&data)) {
-        return *ptr;
+    if (IsBool()) {
+        return (bits_ & kPayloadMask) != 0;
     }
     throw ValueErrors(ValueErrors::kValueNotBool);
 }
 
 
-const Value::Array& Value::AsList() const {
-    if (auto* ptr = std::get_if<Array>(&data)) {
-        return *ptr;
+Value::Array& Value::AsList() const {
+    if (IsList()) {
+        return Payload<List>().Elements();
     }
     throw ValueErrors(ValueErrors::kValueNotList);
 }
 
 
-Value::Array& Value::AsList() {
-    if (auto* ptr = std::get_if<Array>(&data)) {
-        return *ptr;
+const Range& Value::AsRange() const {
+    if (IsRange()) {
+        return Payload<List>().GetRange();
     }
     throw ValueErrors(ValueErrors::kValueNotList);
 }
 
 
-Value::FuncPtr Value::AsFunction() const {
-    if (auto* ptr = std::get_if<FuncPtr>(&data)) {
-        return *ptr;
+Value::Array Value::Materialize(const Range& range) {
+    Array result;
+    result.reserve(range.size);
+    for (std::size_t i = 0; i < range.size; ++i) {
+        result.emplace_back(range.At(i));
+    }
+    return result;
+}
+
+
+void Value::AppendString(const std::string& suffix) {
+    if (!IsString()) {
+        throw ValueErrors(ValueErrors::kValueNotString);
+    }
+    if (GetCell()->refs == 1) {
+        Payload<std::string>() += suffix;
+        return;
+    }
+    std::string result;
+    result.reserve(AsString().size() + suffix.size());
+    result += AsString();
+    result += suffix;
+    *this = Value(std::move(result));
+}
+
+
+const Value::FuncPtr& Value::AsFunction() const {
+    if (IsFunction()) {
+        return Payload<FuncPtr>();
     }
     throw ValueErrors(ValueErrors::kValueNotFunction);
 }
 
 
 std::string Value::ToString() const {
-    return std::visit([](const auto& val) -> std::string {
-        using type = std::decay_t<decltype(val)>;
-
-        if constexpr (std::is_same_v<type, double>) { return std::to_string(val); }
-        else if constexpr (std::is_same_v<type, std::string>) { return val; }
-        else if constexpr (std::is_same_v<type, bool>) { return val ? "true" : "false"; }
-        else if constexpr (std::is_same_v<type, FuncPtr>) { return "<function>"; }
-        else if constexpr (std::is_same_v<type, NilType>) { return "nil"; }
-        else if constexpr (std::is_same_v<type, Array>) {
+    switch (GetKind()) {
+        case Kind::Number: return std::to_string(AsNumber());
+        case Kind::String: return AsString();
+        case Kind::Bool: return AsBool() ? "true" : "false";
+        case Kind::Function: return "<function>";
+        case Kind::Nil: return "nil";
+        case Kind::List: {
+            const Array& list = AsList();
             std::stringstream ss;
             ss << "[ ";
-            for (std::size_t i = 0; i < val.size(); ++i) {
+            for (std::size_t i = 0; i < list.size(); ++i) {
                 if (i > 0) {
                     ss << ", ";
                 }
-                ss << val[i]->ToString();
+                ss << list[i].ToString();
             }
             ss << "]";
             return ss.str();
         }
-    }, data);
+    }
+    return "nil";
 }
 
 
@@ -1,6 +1,9 @@
 #pragma once
 
-#include <variant>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 #include <memory>
@@ -16,35 +19,89 @@ struct NilType { };
 struct FunctionalObject;
 
 
+class List;
+
+
+// Arithmetic progression produced by range(). Elements are computed on
+// demand, so a range costs the same regardless of its length; it turns into
+// an Array only when something needs its elements.
+struct Range {
+    double start = 0;
+    double step = 1;
+    std::size_t size = 0;
+
+    Range() = default;
+
+    // Takes bounds for which Size has a value.
+    Range(double start, double stop, double step);
+
+    // The number of elements, or nullopt when it is not finite or does not
+    // fit in a size_t.
+    static std::optional<std::size_t> Size(double start, double stop, double step);
+
+    double At(std::size_t index) const { return start + static_cast<double>(index) * step; }
+};
+
+
+// A Value is one NaN-boxed 64-bit word. Numbers are stored as plain doubles;
+// every other kind is a quiet NaN whose upper bits carry a tag and whose low
+// 48 bits carry the payload. Strings, lists and functions live in
+// reference-counted heap cells, so copying a Value never copies them. Lists
+// are shared by reference: every copy sees mutations made through another.
 class Value {
 public:
-    using Array = std::vector<std::shared_ptr<Value>>;
+    using Array = std::vector<Value>;
     using FuncPtr = std::shared_ptr<FunctionalObject>;
 
-public:
-    std::variant<double, std::string
-                , bool, NilType
-                , Array, FuncPtr> data;
+    enum class Kind : std::uint8_t {
+        Number, Nil, Bool, String, List, Function
+    };
 
+    // Room for the heap cell of one list, for lists whose owner knows they
+    // die before a point it controls. A list built in it is destroyed with
+    // its last Value, but the memory is the owner's to reclaim.
+    struct ListStorage {
+        alignas(std::uint64_t) std::byte bytes[64];
+    };
+
+public:
     Value();
 
     Value(double);
 
     Value(const std::string&);
 
+    Value(std::string&&);
+
     Value(const char* str);
 
-    explicit Value(bool val)
-        : data(val)
-    {}
+    explicit Value(bool val);
 
     Value(NilType);
 
     Value(const Array&);
 
+    Value(Array&&);
+
+    Value(Array&&, ListStorage&);
+
     Value(FuncPtr);
 
+    Value(Range);
+
+    Value(const Value&);
+
+    Value(Value&&) noexcept;
+
+    Value& operator=(const Value&);
+
+    Value& operator=(Value&&) noexcept;
+
+    ~Value();
+
 public:
+    Kind GetKind() const;
+
     bool IsNumber() const;
 
     bool IsString() const;
@@ -55,6 +112,9 @@ public:
 
     bool IsList() const;
 
+    // A list produced by range() whose elements have not been needed yet.
+    bool IsRange() const;
+
     bool IsFunction() const;
 
 public:
@@ -64,12 +124,194 @@ public:
 
     const std::string& AsString() const;
 
-    const Array& AsList() const;
+    // Materializes a range. Like a shared_ptr, a const Value still gives
+    // mutable access: the array is the storage shared by every copy.
+    Array& AsList() const;
+
+    const Range& AsRange() const;
 
-    FuncPtr AsFunction() const;
+    const FuncPtr& AsFunction() const;
 
-    Array& AsList();
+    static Array Materialize(const Range&);
+
+    // Appends to a string. The buffer is extended in place when no other
+    // Value shares it, so building a string piece by piece stays linear.
+    void AppendString(const std::string&);
 
     std::string ToString() const;
     friend std::ostream& operator<<(std::ostream&, const Value&);
+
+private:
+    struct Cell {
+        std::uint32_t refs = 1;
+        // Built in a ListStorage rather than allocated.
+        bool borrowed = false;
+    };
+
+    template<typename T>
+    struct Boxed : Cell {
+        T payload;
+
+        explicit Boxed(T value)
+            : payload(std::move(value))
+        {}
+    };
+
+    static constexpr std::uint64_t kTagBase = 0xFFF8'0000'0000'0000;
+    static constexpr std::uint64_t kPayloadMask = 0x0000'FFFF'FFFF'FFFF;
+    static constexpr std::uint64_t kCanonicalNaN = 0x7FF8'0000'0000'0000;
+    static constexpr int kTagShift = 48;
+
+    static constexpr std::uint64_t TagOf(Kind kind) {
+        return kTagBase + (static_cast<std::uint64_t>(kind) << kTagShift);
+    }
+
+    // Every pattern at or above the first tag is boxed: NaNs produced by
+    // arithmetic are canonicalized, so no double ever lands in that range.
+    static constexpr std::uint64_t kBoxedBase = 0xFFF9'0000'0000'0000;
+    static constexpr std::uint64_t kHeapBase = 0xFFFB'0000'0000'0000;
+
+    static std::uint64_t Box(Kind, const Cell*);
+
+    bool Is(Kind kind) const { return (bits_ & ~kPayloadMask) == TagOf(kind); }
+
+    Cell* GetCell() const { return reinterpret_cast<Cell*>(bits_ & kPayloadMask); }
+
+    template<typename T>
+    T& Payload() const { return static_cast<Boxed<T>*>(GetCell())->payload; }
+
+    void Retain() const {
+        if (bits_ >= kHeapBase) {
+            ++GetCell()->refs;
+        }
+    }
+
+    void Release() {
+        if (bits_ >= kHeapBase && --GetCell()->refs == 0) {
+            Destroy();
+        }
+    }
+
+    void Destroy();
+
+    [[noreturn]] static void ThrowNotNumber();
+
+private:
+    std::uint64_t bits_;
+};
+
+
+static_assert(sizeof(Value) == sizeof(std::uint64_t));
+static_assert(sizeof(void*) == sizeof(std::uint64_t));
+
+
+inline Value::Value()
+    : bits_(TagOf(Kind::Nil))
+{}
+
+inline Value::Value(double val)
+    : bits_(val != val ? kCanonicalNaN : std::bit_cast<std::uint64_t>(val))
+{}
+
+inline Value::Value(bool val)
+    : bits_(TagOf(Kind::Bool) | static_cast<std::uint64_t>(val))
+{}
+
+inline Value::Value(NilType)
+    : bits_(TagOf(Kind::Nil))
+{}
+
+inline Value::Value(const Value& other)
+    : bits_(other.bits_)
+{
+    Retain();
+}
+
+inline Value::Value(Value&& other) noexcept
+    : bits_(other.bits_)
+{
+    other.bits_ = TagOf(Kind::Nil);
+}
+
+inline Value& Value::operator=(const Value& other) {
+    other.Retain();
+    Release();
+    bits_ = other.bits_;
+    return *this;
+}
+
+inline Value& Value::operator=(Value&& other) noexcept {
+    if (this != &other) {
+        Release();
+        bits_ = other.bits_;
+        other.bits_ = TagOf(Kind::Nil);
+    }
+    return *this;
+}
+
+inline Value::~Value() {
+    Release();
+}
+
+
+inline Value::Kind Value::GetKind() const {
+    if (bits_ < kBoxedBase) {
+        return Kind::Number;
+    }
+    return static_cast<Kind>((bits_ - kTagBase) >> kTagShift);
+}
+
+inline bool Value::IsNumber() const { return bits_ < kBoxedBase; }
+
+inline bool Value::IsString() const { return Is(Kind::String); }
+
+inline bool Value::IsBool() const { return Is(Kind::Bool); }
+
+inline bool Value::IsNil() const { return Is(Kind::Nil); }
+
+inline bool Value::IsList() const { return Is(Kind::List); }
+
+inline bool Value::IsFunction() const { return Is(Kind::Function); }
+
+
+inline double Value::AsNumber() const {
+    if (!IsNumber()) {
+        ThrowNotNumber();
+    }
+    return std::bit_cast<double>(bits_);
+}
+
+
+// Heap storage behind a list Value, shared by all of its copies. A list made
+// by range() holds only its bounds until the elements are first needed.
+class List {
+public:
+    explicit List(Value::Array elements)
+        : elements_(std::move(elements))
+    {}
+
+    explicit List(Range range)
+        : range_(range)
+    {}
+
+    bool IsLazy() const { return range_.has_value(); }
+
+    const Range& GetRange() const { return *range_; }
+
+    std::size_t Size() const { return range_ ? range_->size : elements_.size(); }
+
+    Value::Array& Elements() const {
+        if (range_) {
+            elements_ = Value::Materialize(*range_);
+            range_.reset();
+        }
+        return elements_;
+    }
+
+private:
+    mutable std::optional<Range> range_;
+    mutable Value::Array elements_;
 };
+
+
+inline bool Value::IsRange() const { return IsList() && Payload<List>().IsLazy(); }
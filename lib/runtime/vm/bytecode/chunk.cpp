@@ -0,0 +1,60 @@
+#include <iomanip>
+
+#include <runtime/vm/bytecode/chunk.h>
+
+
+static void DisassembleInstruction(Instruction i, std::size_t offset
+                                , const FunctionProto& proto, std::ostream& out)
+{
+    OpCode op = GetOp(i);
+    out << std::setw(5) << offset << "  "
+        << std::left << std::setw(12) << kOpCodeNames[static_cast<int>(op)]
+        << std::right;
+
+    switch (op) {
+        case OpCode::LoadK:
+            out << int(GetA(i)) << " K" << GetBx(i)
+                << "\t; " << proto.constants[GetBx(i)];
+            break;
+        case OpCode::GetGlobal:
+        case OpCode::SetGlobal:
+        case OpCode::AddGlobal:
+            out << int(GetA(i)) << " G" << GetBx(i);
+            break;
+        case OpCode::Closure:
+            out << int(GetA(i)) << " P" << GetBx(i)
+                << "\t; " << proto.protos[GetBx(i)]->name;
+            break;
+        case OpCode::Jmp:
+            out << GetSBx(i) << "\t; -> " << offset + 1 + GetSBx(i);
+            break;
+        case OpCode::JmpIf:
+        case OpCode::JmpIfNot:
+        case OpCode::ForPrep:
+        case OpCode::ForLoop:
+            out << int(GetA(i)) << " " << GetSBx(i)
+                << "\t; -> " << offset + 1 + GetSBx(i);
+            break;
+        default:
+            out << int(GetA(i)) << " " << int(GetB(i)) << " " << int(GetC(i));
+            break;
+    }
+    out << '\n';
+}
+
+
+void Disassemble(const FunctionProto& proto, std::ostream& out) {
+    out << "function " << proto.name
+        << " (params: " << proto.num_params
+        << ", registers: " << proto.max_registers
+        << ", upvalues: " << proto.upvalues.size() << ")\n";
+
+    for (std::size_t offset = 0; offset < proto.code.size(); ++offset) {
+        DisassembleInstruction(proto.code[offset], offset, proto, out);
+    }
+    out << '\n';
+
+    for (const auto& child : proto.protos) {
+        Disassemble(*child, out);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <runtime/value/value.h>
+#include <runtime/vm/bytecode/opcodes.h>
+
+
+struct UpvalueInfo {
+    bool in_parent_local;
+    Register index;
+};
+
+
+struct FunctionProto {
+    std::string name;
+    std::size_t num_params = 0;
+    std::size_t max_registers = 1;
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+    std::vector<UpvalueInfo> upvalues;
+    std::vector<std::unique_ptr<FunctionProto>> protos;
+};
+
+
+struct UpvalueCell {
+    std::size_t slot;
+    bool open;
+    Value closed;
+};
+
+
+struct CompiledClosure {
+    const FunctionProto* proto;
+    std::vector<std::shared_ptr<UpvalueCell>> upvalues;
+};
+
+
+struct CompiledProgram {
+    std::unique_ptr<FunctionProto> main;
+};
+
+
+void Disassemble(const FunctionProto&, std::ostream&);
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+
+
+// Every instruction is one 64-bit word: | C:16 | B:16 | A:16 | op:16 |.
+// Bx reuses the B and C fields as one unsigned 32-bit operand, sBx is Bx
+// biased by kMaxSBx. Registers are relative to the base of the current frame.
+#define ITMO_VM_OPCODES(X)                                                    \
+    X(Move)        /* A B     R[A] = R[B]                                  */ \
+    X(LoadK)       /* A Bx    R[A] = K[Bx]                                 */ \
+    X(LoadNil)     /* A       R[A] = nil                                   */ \
+    X(LoadBool)    /* A B     R[A] = (bool)B                               */ \
+    X(GetGlobal)   /* A Bx    R[A] = G[Bx]                                 */ \
+    X(SetGlobal)   /* A Bx    G[Bx] = R[A]                                 */ \
+    X(GetUpval)    /* A B     R[A] = U[B]                                  */ \
+    X(SetUpval)    /* A B     U[B] = R[A]                                  */ \
+    X(Add)         /* A B C   R[A] = R[B] + R[C]                           */ \
+    X(AddTo)       /* A B     R[A] += R[B], extending strings and lists    */ \
+    X(AddGlobal)   /* A Bx    G[Bx] += R[A], as AddTo                      */ \
+    X(AddUpval)    /* A B     U[B] += R[A], as AddTo                       */ \
+    X(Sub)         /* A B C   R[A] = R[B] - R[C]                           */ \
+    X(Mul)         /* A B C   R[A] = R[B] * R[C]                           */ \
+    X(Div)         /* A B C   R[A] = R[B] / R[C]                           */ \
+    X(Mod)         /* A B C   R[A] = R[B] % R[C]                           */ \
+    X(Pow)         /* A B C   R[A] = R[B] ^ R[C]                           */ \
+    X(Eq)          /* A B C   R[A] = R[B] == R[C]                          */ \
+    X(Ne)          /* A B C   R[A] = R[B] != R[C]                          */ \
+    X(Lt)          /* A B C   R[A] = R[B] < R[C]                           */ \
+    X(Le)          /* A B C   R[A] = R[B] <= R[C]                          */ \
+    X(Gt)          /* A B C   R[A] = R[B] > R[C]                           */ \
+    X(Ge)          /* A B C   R[A] = R[B] >= R[C]                          */ \
+    X(Neg)         /* A B     R[A] = -R[B]                                 */ \
+    X(Not)         /* A B     R[A] = not R[B]                              */ \
+    X(Jmp)         /* sBx     pc += sBx                                    */ \
+    X(JmpIf)       /* A sBx   if R[A] then pc += sBx                       */ \
+    X(JmpIfNot)    /* A sBx   if not R[A] then pc += sBx                   */ \
+    X(TestEq)      /* A B     if not (R[A] == R[B]) take the next Jmp      */ \
+    X(TestNe)      /* A B     if not (R[A] != R[B]) take the next Jmp      */ \
+    X(TestLt)      /* A B     if not (R[A] < R[B]) take the next Jmp       */ \
+    X(TestLe)      /* A B     if not (R[A] <= R[B]) take the next Jmp      */ \
+    X(TestGt)      /* A B     if not (R[A] > R[B]) take the next Jmp       */ \
+    X(TestGe)      /* A B     if not (R[A] >= R[B]) take the next Jmp      */ \
+    X(NewList)     /* A B C   R[A] = [R[B], ..., R[B + C - 1]]             */ \
+    X(AppendList)  /* A B C   R[A] += [R[B], ..., R[B + C - 1]]            */ \
+    X(Index)       /* A B C   R[A] = R[B][R[C]]                            */ \
+    X(Slice)       /* A B C   R[A] = R[B][R[C] : R[C + 1]], nil = omitted  */ \
+    X(SetIndex)    /* A B C   R[A][R[B]] = R[C]                            */ \
+    X(Call)        /* A B     R[A] = R[A](R[A + 1], ..., R[A + B])         */ \
+    X(Return)      /* A B     return B ? R[A] : nil                        */ \
+    X(Closure)     /* A Bx    R[A] = closure(P[Bx])                        */ \
+    X(Close)       /* A       close upvalues of registers >= A             */ \
+    X(ForPrep)     /* A sBx   check R[A] is a list, R[A + 1] = 0, jump     */ \
+    X(ForLoop)     /* A sBx   if R[A + 1] < len(R[A]) then                 */ \
+                   /*         R[A + 2] = R[A][R[A + 1]++], pc += sBx       */
+
+
+enum class OpCode : std::uint8_t {
+#define ITMO_VM_OPCODE_ENUM(name) name,
+    ITMO_VM_OPCODES(ITMO_VM_OPCODE_ENUM)
+#undef ITMO_VM_OPCODE_ENUM
+};
+
+
+inline constexpr const char* kOpCodeNames[] = {
+#define ITMO_VM_OPCODE_NAME(name) #name,
+    ITMO_VM_OPCODES(ITMO_VM_OPCODE_NAME)
+#undef ITMO_VM_OPCODE_NAME
+};
+
+
+using Instruction = std::uint64_t;
+using Register = std::uint16_t;
+
+inline constexpr int kMaxRegisters = 0xFFFF;
+inline constexpr std::uint32_t kMaxBx = 0xFFFFFFFF;
+inline constexpr long long kMaxSBx = kMaxBx >> 1;
+
+
+constexpr Instruction Encode(OpCode op, Register a, Register b = 0, Register c = 0) {
+    return static_cast<Instruction>(op)
+        | (static_cast<Instruction>(a) << 16)
+        | (static_cast<Instruction>(b) << 32)
+        | (static_cast<Instruction>(c) << 48);
+}
+
+constexpr Instruction EncodeBx(OpCode op, Register a, std::uint32_t bx) {
+    return static_cast<Instruction>(op)
+        | (static_cast<Instruction>(a) << 16)
+        | (static_cast<Instruction>(bx) << 32);
+}
+
+constexpr Instruction EncodeSBx(OpCode op, Register a, long long sbx) {
+    return EncodeBx(op, a, static_cast<std::uint32_t>(sbx + kMaxSBx));
+}
+
+constexpr OpCode GetOp(Instruction i) { return static_cast<OpCode>(i & 0xFFFF); }
+
+constexpr Register GetA(Instruction i) { return (i >> 16) & 0xFFFF; }
+
+constexpr Register GetB(Instruction i) { return (i >> 32) & 0xFFFF; }
+
+constexpr Register GetC(Instruction i) { return (i >> 48) & 0xFFFF; }
+
+constexpr std::uint32_t GetBx(Instruction i) { return static_cast<std::uint32_t>(i >> 32); }
+
+constexpr long long GetSBx(Instruction i) { return static_cast<long long>(GetBx(i)) - kMaxSBx; }
@@ -0,0 +1,924 @@
+#include <algorithm>
+#include <type_traits>
+
+#include <runtime/vm/compiler/compiler.h>
+
+
+namespace {
+
+template<typename Visitor>
+void VisitChildren(const Expression& expr, Visitor&& visit) {
+    std::visit([&visit](const auto& node) {
+        using T = std::decay_t<decltype(node)>;
+
+        if constexpr (std::is_same_v<T, UnaryExpression>) {
+            visit(*node.rhs);
+        } else if constexpr (std::is_same_v<T, BinaryExpression>) {
+            visit(*node.lhs);
+            visit(*node.rhs);
+        } else if constexpr (std::is_same_v<T, CallableExpression>) {
+            visit(*node.callable);
+            for (const auto& arg : node.f_arguments) { visit(*arg); }
+        } else if constexpr (std::is_same_v<T, ListExpression>) {
+            for (const auto& element : node.elements) { visit(*element); }
+        } else if constexpr (std::is_same_v<T, AssignExpression>) {
+            visit(*node.rhs);
+        } else if constexpr (std::is_same_v<T, IndexExpression>) {
+            visit(*node.object);
+            visit(*node.index);
+        } else if constexpr (std::is_same_v<T, SliceExpression>) {
+            visit(*node.object);
+            if (node.from_s) { visit(*node.from_s); }
+            if (node.to_s) { visit(*node.to_s); }
+        } else if constexpr (std::is_same_v<T, IndexAssignExpression>) {
+            visit(*node.object);
+            visit(*node.index);
+            visit(*node.rhs);
+        } else if constexpr (std::is_same_v<T, FusedExpression>) {
+            visit(*node.original);
+        }
+    }, expr.value);
+}
+
+
+void CollectAssignedNames(const Expression& expr, std::vector<std::string>& names) {
+    if (auto* assign = std::get_if<AssignExpression>(&expr.value)) {
+        names.push_back(assign->name);
+    }
+    VisitChildren(expr, [&names](const Expression& child) {
+        CollectAssignedNames(child, names);
+    });
+}
+
+
+bool HasSideEffects(const Expression& expr) {
+    if (std::holds_alternative<CallableExpression>(expr.value)
+        || std::holds_alternative<AssignExpression>(expr.value)
+        || std::holds_alternative<IndexAssignExpression>(expr.value))
+    {
+        return true;
+    }
+    bool result = false;
+    VisitChildren(expr, [&result](const Expression& child) {
+        result = result || HasSideEffects(child);
+    });
+    return result;
+}
+
+
+const Expression* TopLevelExpression(const Statement& stmt) {
+    return std::visit([](const auto& node) -> const Expression* {
+        using T = std::decay_t<decltype(node)>;
+
+        if constexpr (std::is_same_v<T, ExpressionStatement>) {
+            return &node.expression;
+        } else if constexpr (std::is_same_v<T, IfStatement>
+                            || std::is_same_v<T, WhileStatement>)
+        {
+            return &node.condition;
+        } else if constexpr (std::is_same_v<T, ForStatement>) {
+            return &node.iter;
+        } else {
+            return nullptr;
+        }
+    }, stmt.value);
+}
+
+
+std::optional<OpCode> BinaryOpCode(TokenType op) {
+    switch (op) {
+        case TokenType::plus_: return OpCode::Add;
+        case TokenType::minus_: return OpCode::Sub;
+        case TokenType::star_: return OpCode::Mul;
+        case TokenType::slash_: return OpCode::Div;
+        case TokenType::percent_: return OpCode::Mod;
+        case TokenType::degree_: return OpCode::Pow;
+        case TokenType::double_eq_: return OpCode::Eq;
+        case TokenType::not_eq_: return OpCode::Ne;
+        case TokenType::less_: return OpCode::Lt;
+        case TokenType::less_eq_: return OpCode::Le;
+        case TokenType::greater_: return OpCode::Gt;
+        case TokenType::greater_eq_: return OpCode::Ge;
+        default: return std::nullopt;
+    }
+}
+
+
+std::optional<OpCode> TestOpCode(TokenType op) {
+    switch (op) {
+        case TokenType::double_eq_: return OpCode::TestEq;
+        case TokenType::not_eq_: return OpCode::TestNe;
+        case TokenType::less_: return OpCode::TestLt;
+        case TokenType::less_eq_: return OpCode::TestLe;
+        case TokenType::greater_: return OpCode::TestGt;
+        case TokenType::greater_eq_: return OpCode::TestGe;
+        default: return std::nullopt;
+    }
+}
+
+
+constexpr std::size_t kListBatch = 50;
+
+}
+
+
+BytecodeCompiler::BytecodeCompiler(GlobalTable& globals)
+    : globals_(globals)
+{}
+
+
+CompiledProgram BytecodeCompiler::Compile(const std::vector<Statement>& program) {
+    FunctionState main_state;
+    main_state.proto = std::make_unique<FunctionProto>();
+    main_state.proto->name = "[global]";
+    fs_ = &main_state;
+
+    // Top-level names are bound before any function body is compiled, so a
+    // function assigning to a global declared further down still updates it.
+    for (const auto& stmt : program) {
+        if (const Expression* expr = TopLevelExpression(stmt)) {
+            std::vector<std::string> names;
+            CollectAssignedNames(*expr, names);
+            for (const auto& name : names) {
+                GlobalSlot(name);
+            }
+        }
+    }
+
+    CompileStatements(program);
+    Emit(Encode(OpCode::Return, 0, 0));
+
+    fs_ = nullptr;
+
+    CompiledProgram result;
+    result.main = std::move(main_state.proto);
+    return result;
+}
+
+
+void BytecodeCompiler::CompileStatement(const Statement& stmt) {
+    std::visit([this](const auto& node) {
+        CompileStatementImpl(node);
+    }, stmt.value);
+    FreeTemporaries();
+}
+
+
+void BytecodeCompiler::CompileStatements(const std::vector<Statement>& stmts) {
+    for (const auto& stmt : stmts) {
+        CompileStatement(stmt);
+    }
+}
+
+
+void BytecodeCompiler::CompileStatementImpl(const ExpressionStatement& stmt) {
+    DeclareAssignedNames(stmt.expression);
+
+    if (auto* assign = std::get_if<AssignExpression>(&stmt.expression.value)) {
+        CompileAssign(*assign, std::nullopt);
+        return;
+    }
+    CompileExpression(stmt.expression, AllocateRegister());
+}
+
+
+void BytecodeCompiler::CompileStatementImpl(const IfStatement& stmt) {
+    DeclareAssignedNames(stmt.condition);
+    std::size_t else_jump = CompileCondition(stmt.condition);
+    FreeTemporaries();
+
+    EnterScope();
+    CompileStatements(stmt.then_case);
+    ExitScope();
+
+    if (stmt.else_case.empty()) {
+        PatchJump(else_jump, CurrentOffset());
+        return;
+    }
+
+    std::size_t end_jump = EmitJump(OpCode::Jmp);
+    PatchJump(else_jump, CurrentOffset());
+
+    EnterScope();
+    CompileStatements(stmt.else_case);
+    ExitScope();
+
+    PatchJump(end_jump, CurrentOffset());
+}
+
+
+void BytecodeCompiler::CompileStatementImpl(const WhileStatement& stmt) {
+    DeclareAssignedNames(stmt.condition);
+
+    std::size_t loop_start = CurrentOffset();
+    std::size_t exit_jump = CompileCondition(stmt.condition);
+    FreeTemporaries();
+
+    fs_->loops.push_back({static_cast<Register>(fs_->locals.size()), {}, {}});
+
+    EnterScope();
+    CompileStatements(stmt.body);
+    ExitScope();
+
+    PatchJump(EmitJump(OpCode::Jmp), loop_start);
+
+    LoopContext loop = std::move(fs_->loops.back());
+    fs_->loops.pop_back();
+
+    for (std::size_t jump : loop.continue_jumps) {
+        PatchJump(jump, loop_start);
+    }
+    PatchJump(exit_jump, CurrentOffset());
+    for (std::size_t jump : loop.break_jumps) {
+        PatchJump(jump, CurrentOffset());
+    }
+}
+
+
+void BytecodeCompiler::CompileStatementImpl(const ForStatement& stmt) {
+    DeclareAssignedNames(stmt.iter);
+
+    EnterScope();
+    Register iter_reg = DeclareLocal("(for iterable)");
+    CompileExpression(stmt.iter, iter_reg);
+    FreeTemporaries();
+
+    DeclareLocal("(for index)");
+    std::size_t var_local = fs_->locals.size();
+    Register var_reg = DeclareLocal(stmt.var);
+
+    std::size_t prep_jump = EmitJump(OpCode::ForPrep, iter_reg);
+    std::size_t body_start = CurrentOffset();
+
+    fs_->loops.push_back({var_reg, {}, {}});
+    CompileStatements(stmt.body);
+
+    std::size_t continue_target = CurrentOffset();
+    EmitCloseIfCaptured(var_local);
+
+    PatchJump(prep_jump, CurrentOffset());
+    PatchJump(EmitJump(OpCode::ForLoop, iter_reg), body_start);
+
+    LoopContext loop = std::move(fs_->loops.back());
+    fs_->loops.pop_back();
+
+    for (std::size_t jump : loop.continue_jumps) {
+        PatchJump(jump, continue_target);
+    }
+    for (std::size_t jump : loop.break_jumps) {
+        PatchJump(jump, CurrentOffset());
+    }
+
+    ExitScope(false);
+}
+
+
+void BytecodeCompiler::CompileStatementImpl(const ReturnStatement& stmt) {
+    if (!fs_->enclosing) {
+        throw VirtualMachineError(VirtualMachineError::kReturnOutsideFunction);
+    }
+
+    if (!stmt.value) {
+        Emit(Encode(OpCode::Return, 0, 0));
+        return;
+    }
+
+    DeclareAssignedNames(*stmt.value);
+    Register reg = CompileToAnyRegister(*stmt.value);
+    Emit(Encode(OpCode::Return, reg, 1));
+}
+
+
+void BytecodeCompiler::CompileStatementImpl(const BlockStatement& stmt) {
+    EnterScope();
+    CompileStatements(stmt.statements);
+    ExitScope();
+}
+
+
+void BytecodeCompiler::CompileStatementImpl(const BreakStatement&) {
+    if (fs_->loops.empty()) {
+        throw VirtualMachineError(VirtualMachineError::kBreakOutsideLoop);
+    }
+    auto& loop = fs_->loops.back();
+    Emit(Encode(OpCode::Close, loop.base_reg));
+    loop.break_jumps.push_back(EmitJump(OpCode::Jmp));
+}
+
+
+void BytecodeCompiler::CompileStatementImpl(const ContinueStatement&) {
+    if (fs_->loops.empty()) {
+        throw VirtualMachineError(VirtualMachineError::kContinueOutsideLoop);
+    }
+    auto& loop = fs_->loops.back();
+    Emit(Encode(OpCode::Close, loop.base_reg));
+    loop.continue_jumps.push_back(EmitJump(OpCode::Jmp));
+}
+
+
+void BytecodeCompiler::CompileExpression(const Expression& expr, Register target) {
+    std::visit([this, target](const auto& node) {
+        CompileExpressionImpl(node, target);
+    }, expr.value);
+}
+
+
+Register BytecodeCompiler::CompileToAnyRegister(const Expression& expr) {
+    if (auto* var = std::get_if<VariableExpression>(&expr.value)) {
+        if (auto* local = FindLocal(*fs_, var->name)) {
+            return local->reg;
+        }
+    }
+    Register reg = AllocateRegister();
+    CompileExpression(expr, reg);
+    return reg;
+}
+
+
+// A local can be read in place unless evaluating the next operand may
+// reassign it before the instruction consuming both operands runs.
+Register BytecodeCompiler::CompileOperand(const Expression& expr, const Expression& next) {
+    if (!HasSideEffects(next)) {
+        return CompileToAnyRegister(expr);
+    }
+    Register reg = AllocateRegister();
+    CompileExpression(expr, reg);
+    return reg;
+}
+
+
+// Emits code that falls through when the condition holds and returns the
+// jump that has to be patched to the "condition failed" target.
+std::size_t BytecodeCompiler::CompileCondition(const Expression& cond) {
+    if (auto* binary = std::get_if<BinaryExpression>(&cond.value)) {
+        if (auto test = TestOpCode(binary->operation)) {
+            Register lhs = CompileOperand(*binary->lhs, *binary->rhs);
+            Register rhs = CompileToAnyRegister(*binary->rhs);
+            Emit(Encode(*test, lhs, rhs));
+            return EmitJump(OpCode::Jmp);
+        }
+    }
+    Register reg = CompileToAnyRegister(cond);
+    return EmitJump(OpCode::JmpIfNot, reg);
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const NumberExpression& expr, Register target) {
+    Emit(EncodeBx(OpCode::LoadK, target, NumberConstant(expr.value)));
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const StringExpression& expr, Register target) {
+    Emit(EncodeBx(OpCode::LoadK, target, StringConstant(expr.value)));
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const BoolExpression& expr, Register target) {
+    Emit(Encode(OpCode::LoadBool, target, expr.value ? 1 : 0));
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const NilExpression&, Register target) {
+    Emit(Encode(OpCode::LoadNil, target));
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const VariableExpression& expr, Register target) {
+    if (auto* local = FindLocal(*fs_, expr.name)) {
+        if (local->reg != target) {
+            Emit(Encode(OpCode::Move, target, local->reg));
+        }
+        return;
+    }
+    if (auto upvalue = ResolveUpvalue(*fs_, expr.name)) {
+        Emit(Encode(OpCode::GetUpval, target, *upvalue));
+        return;
+    }
+    Emit(EncodeBx(OpCode::GetGlobal, target, GlobalSlot(expr.name)));
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const UnaryExpression& expr, Register target) {
+    OpCode op;
+    switch (expr.operation) {
+        case TokenType::minus_: op = OpCode::Neg; break;
+        case TokenType::not_: op = OpCode::Not; break;
+        default:
+            throw VirtualMachineError(VirtualMachineError::kUnsupportedOperator);
+    }
+
+    int saved = fs_->free_reg;
+    Register operand = CompileToAnyRegister(*expr.rhs);
+    Emit(Encode(op, target, operand));
+    fs_->free_reg = saved;
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const BinaryExpression& expr, Register target) {
+    int saved = fs_->free_reg;
+
+    if (expr.operation == TokenType::and_ || expr.operation == TokenType::or_) {
+        // Short-circuiting writes the result register twice, so never do it
+        // straight into a local the right operand might still read.
+        bool local_target = target < fs_->locals.size();
+        Register reg = local_target ? AllocateRegister() : target;
+
+        CompileExpression(*expr.lhs, reg);
+        std::size_t skip = EmitJump(expr.operation == TokenType::and_
+                                    ? OpCode::JmpIfNot : OpCode::JmpIf, reg);
+        CompileExpression(*expr.rhs, reg);
+        PatchJump(skip, CurrentOffset());
+
+        if (reg != target) {
+            Emit(Encode(OpCode::Move, target, reg));
+        }
+        fs_->free_reg = saved;
+        return;
+    }
+
+    auto op = BinaryOpCode(expr.operation);
+    if (!op) {
+        throw VirtualMachineError(VirtualMachineError::kUnsupportedOperator);
+    }
+
+    // Nothing reads a temporary target before the result is stored, so the
+    // left operand is built right in it and a left-leaning chain such as
+    // 1 + 2 + 3 + ... takes two registers however long it is.
+    Register lhs;
+    if (target >= fs_->locals.size() && !std::holds_alternative<VariableExpression>(expr.lhs->value)) {
+        CompileExpression(*expr.lhs, target);
+        lhs = target;
+    } else {
+        lhs = CompileOperand(*expr.lhs, *expr.rhs);
+    }
+    Register rhs = CompileToAnyRegister(*expr.rhs);
+    Emit(Encode(*op, target, lhs, rhs));
+    fs_->free_reg = saved;
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const CallableExpression& expr, Register target) {
+    int saved = fs_->free_reg;
+
+    // The call frame starts right at the target when it is the topmost temporary.
+    bool target_on_top = target >= fs_->locals.size() && target + 1 == fs_->free_reg;
+    Register base = target_on_top ? target : AllocateRegister();
+    CompileExpression(*expr.callable, base);
+    for (const auto& arg : expr.f_arguments) {
+        CompileExpression(*arg, AllocateRegister());
+    }
+    Emit(Encode(OpCode::Call, base, static_cast<Register>(expr.f_arguments.size())));
+
+    if (base != target) {
+        Emit(Encode(OpCode::Move, target, base));
+    }
+    fs_->free_reg = saved;
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const ListExpression& expr, Register target) {
+    int saved = fs_->free_reg;
+
+    const auto& elements = expr.elements;
+    bool batched = elements.size() > kListBatch;
+    Register list_reg = (batched && target < fs_->locals.size())
+                            ? AllocateRegister() : target;
+
+    std::size_t start = 0;
+    do {
+        int batch_saved = fs_->free_reg;
+        std::size_t count = std::min(kListBatch, elements.size() - start);
+        auto first = static_cast<Register>(fs_->free_reg);
+
+        for (std::size_t k = 0; k < count; ++k) {
+            CompileExpression(*elements[start + k], AllocateRegister());
+        }
+        Emit(Encode(start == 0 ? OpCode::NewList : OpCode::AppendList
+                    , list_reg, first, static_cast<Register>(count)));
+
+        fs_->free_reg = batch_saved;
+        start += count;
+    } while (start < elements.size());
+
+    if (list_reg != target) {
+        Emit(Encode(OpCode::Move, target, list_reg));
+    }
+    fs_->free_reg = saved;
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const FunctionExpression& expr, Register target) {
+    std::string name = expr.parameters.empty()
+        ? "[anonymous]"
+        : "[function(" + std::to_string(expr.parameters.size()) + " params)]";
+    CompileFunction(expr, target, name);
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const AssignExpression& expr, Register target) {
+    CompileAssign(expr, target);
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const IndexExpression& expr, Register target) {
+    int saved = fs_->free_reg;
+    Register object = CompileOperand(*expr.object, *expr.index);
+    Register index = CompileToAnyRegister(*expr.index);
+    Emit(Encode(OpCode::Index, target, object, index));
+    fs_->free_reg = saved;
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const SliceExpression& expr, Register target) {
+    int saved = fs_->free_reg;
+
+    bool bounds_have_effects = (expr.from_s && HasSideEffects(*expr.from_s))
+                            || (expr.to_s && HasSideEffects(*expr.to_s));
+    Register object;
+    if (bounds_have_effects) {
+        object = AllocateRegister();
+        CompileExpression(*expr.object, object);
+    } else {
+        object = CompileToAnyRegister(*expr.object);
+    }
+
+    Register from = AllocateRegister();
+    Register to = AllocateRegister();
+
+    if (expr.from_s) {
+        CompileExpression(*expr.from_s, from);
+    } else {
+        Emit(Encode(OpCode::LoadNil, from));
+    }
+    if (expr.to_s) {
+        CompileExpression(*expr.to_s, to);
+    } else {
+        Emit(Encode(OpCode::LoadNil, to));
+    }
+
+    Emit(Encode(OpCode::Slice, target, object, from));
+    fs_->free_reg = saved;
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const IndexAssignExpression& expr, Register target) {
+    int saved = fs_->free_reg;
+
+    bool later_effects = HasSideEffects(*expr.index) || HasSideEffects(*expr.rhs);
+    Register object = later_effects ? AllocateRegister() : CompileToAnyRegister(*expr.object);
+    if (later_effects) {
+        CompileExpression(*expr.object, object);
+    }
+    Register index = CompileOperand(*expr.index, *expr.rhs);
+
+    // A local target may still be read by the right-hand side, so the new
+    // element is only built in place when the target is a temporary.
+    bool temp_target = target >= fs_->locals.size();
+    Register value;
+    if (expr.operation == TokenType::assign_) {
+        if (temp_target) {
+            CompileExpression(*expr.rhs, target);
+            value = target;
+        } else {
+            value = CompileToAnyRegister(*expr.rhs);
+        }
+    } else {
+        auto op = BinaryOpCode(CompoundBaseOperation(expr.operation));
+        if (!op) {
+            throw VirtualMachineError(VirtualMachineError::kUnsupportedOperator);
+        }
+        value = temp_target ? target : AllocateRegister();
+        Emit(Encode(OpCode::Index, value, object, index));
+        Register rhs = CompileToAnyRegister(*expr.rhs);
+        Emit(Encode(*op, value, value, rhs));
+    }
+
+    Emit(Encode(OpCode::SetIndex, object, index, value));
+    if (value != target) {
+        Emit(Encode(OpCode::Move, target, value));
+    }
+    fs_->free_reg = saved;
+}
+
+
+void BytecodeCompiler::CompileExpressionImpl(const FusedExpression& expr, Register target) {
+    CompileExpression(*expr.original, target);
+}
+
+
+void BytecodeCompiler::CompileAssign(const AssignExpression& expr
+                                , std::optional<Register> target)
+{
+    if (expr.operation != TokenType::assign_) {
+        CompileCompoundAssign(expr, target);
+        return;
+    }
+
+    int saved = fs_->free_reg;
+
+    auto compile_rhs = [this, &expr](Register reg) {
+        if (auto* function = std::get_if<FunctionExpression>(&expr.rhs->value)) {
+            CompileFunction(*function, reg, expr.name);
+        } else {
+            CompileExpression(*expr.rhs, reg);
+        }
+    };
+
+    if (auto* local = FindLocal(*fs_, expr.name)) {
+        Register reg = local->reg;
+        compile_rhs(reg);
+        if (target && *target != reg) {
+            Emit(Encode(OpCode::Move, *target, reg));
+        }
+        fs_->free_reg = saved;
+        return;
+    }
+
+    Register reg = target ? *target : AllocateRegister();
+    compile_rhs(reg);
+
+    if (auto upvalue = ResolveUpvalue(*fs_, expr.name)) {
+        Emit(Encode(OpCode::SetUpval, reg, *upvalue));
+    } else {
+        Emit(EncodeBx(OpCode::SetGlobal, reg, GlobalSlot(expr.name)));
+    }
+    fs_->free_reg = saved;
+}
+
+
+// Like the tree-walker, the right-hand side is evaluated before the variable
+// is read. `+=` updates the variable where it lives, so strings and lists are
+// extended in their own buffers.
+void BytecodeCompiler::CompileCompoundAssign(const AssignExpression& expr
+                                        , std::optional<Register> target)
+{
+    auto op = BinaryOpCode(CompoundBaseOperation(expr.operation));
+    if (!op) {
+        throw VirtualMachineError(VirtualMachineError::kUnsupportedOperator);
+    }
+    bool append = expr.operation == TokenType::plus_eq_;
+
+    int saved = fs_->free_reg;
+    Register rhs = CompileToAnyRegister(*expr.rhs);
+
+    if (auto* local = FindLocal(*fs_, expr.name)) {
+        Register reg = local->reg;
+        Emit(append ? Encode(OpCode::AddTo, reg, rhs) : Encode(*op, reg, reg, rhs));
+        if (target && *target != reg) {
+            Emit(Encode(OpCode::Move, *target, reg));
+        }
+        fs_->free_reg = saved;
+        return;
+    }
+
+    auto upvalue = ResolveUpvalue(*fs_, expr.name);
+    auto load = [&](Register reg) {
+        if (upvalue) {
+            Emit(Encode(OpCode::GetUpval, reg, *upvalue));
+        } else {
+            Emit(EncodeBx(OpCode::GetGlobal, reg, GlobalSlot(expr.name)));
+        }
+    };
+
+    if (append) {
+        if (upvalue) {
+            Emit(Encode(OpCode::AddUpval, rhs, *upvalue));
+        } else {
+            Emit(EncodeBx(OpCode::AddGlobal, rhs, GlobalSlot(expr.name)));
+        }
+        if (target) {
+            load(*target);
+        }
+    } else {
+        // A local target may be the right-hand side itself.
+        bool temp_target = target && *target >= fs_->locals.size();
+        Register reg = temp_target ? *target : AllocateRegister();
+        load(reg);
+        Emit(Encode(*op, reg, reg, rhs));
+        if (upvalue) {
+            Emit(Encode(OpCode::SetUpval, reg, *upvalue));
+        } else {
+            Emit(EncodeBx(OpCode::SetGlobal, reg, GlobalSlot(expr.name)));
+        }
+        if (target && *target != reg) {
+            Emit(Encode(OpCode::Move, *target, reg));
+        }
+    }
+    fs_->free_reg = saved;
+}
+
+
+void BytecodeCompiler::CompileFunction(const FunctionExpression& expr
+                                    , Register target, const std::string& name)
+{
+    FunctionState state;
+    state.enclosing = fs_;
+    state.proto = std::make_unique<FunctionProto>();
+    state.proto->name = name;
+    state.proto->num_params = expr.parameters.size();
+
+    fs_ = &state;
+    for (const auto& param : expr.parameters) {
+        DeclareLocal(param);
+    }
+    CompileStatements(expr.f_body);
+    Emit(Encode(OpCode::Return, 0, 0));
+    fs_ = state.enclosing;
+
+    auto& protos = fs_->proto->protos;
+    if (protos.size() >= static_cast<std::size_t>(kMaxBx)) {
+        throw VirtualMachineError(VirtualMachineError::kTooManyConstants);
+    }
+    protos.push_back(std::move(state.proto));
+    Emit(EncodeBx(OpCode::Closure, target, static_cast<std::uint32_t>(protos.size() - 1)));
+}
+
+
+void BytecodeCompiler::EnterScope() {
+    fs_->scopes.push_back(fs_->locals.size());
+}
+
+
+void BytecodeCompiler::ExitScope(bool close_upvalues) {
+    std::size_t start = fs_->scopes.back();
+    fs_->scopes.pop_back();
+
+    if (close_upvalues) {
+        EmitCloseIfCaptured(start);
+    }
+    fs_->locals.resize(start);
+    FreeTemporaries();
+}
+
+
+// Mirrors SemanticAnalizer: a name assigned for the first time is declared
+// in the innermost scope before the statement that assigns it is evaluated.
+void BytecodeCompiler::DeclareAssignedNames(const Expression& expr) {
+    std::vector<std::string> names;
+    CollectAssignedNames(expr, names);
+
+    for (const auto& name : names) {
+        if (FindLocal(*fs_, name)
+            || ResolveUpvalue(*fs_, name)
+            || globals_.Has(name))
+        {
+            continue;
+        }
+        if (IsGlobalScope()) {
+            GlobalSlot(name);
+        } else {
+            DeclareLocal(name);
+        }
+    }
+}
+
+
+Register BytecodeCompiler::DeclareLocal(const std::string& name) {
+    Register reg = AllocateRegister();
+    fs_->locals.push_back({name, reg});
+    return reg;
+}
+
+
+Register BytecodeCompiler::AllocateRegister() {
+    if (fs_->free_reg >= kMaxRegisters) {
+        throw VirtualMachineError(VirtualMachineError::kTooManyRegisters);
+    }
+    auto reg = static_cast<Register>(fs_->free_reg++);
+    fs_->proto->max_registers = std::max<std::size_t>(fs_->proto->max_registers, fs_->free_reg);
+    return reg;
+}
+
+
+void BytecodeCompiler::FreeTemporaries() {
+    fs_->free_reg = static_cast<int>(fs_->locals.size());
+}
+
+
+BytecodeCompiler::LocalVariable* BytecodeCompiler::FindLocal(FunctionState& state
+                                                        , const std::string& name)
+{
+    for (auto it = state.locals.rbegin(); it != state.locals.rend(); ++it) {
+        if (it->name == name) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+
+std::optional<Register> BytecodeCompiler::ResolveUpvalue(FunctionState& state
+                                                        , const std::string& name)
+{
+    if (!state.enclosing) {
+        return std::nullopt;
+    }
+
+    auto& names = state.upvalue_names;
+    if (auto it = std::find(names.begin(), names.end(), name); it != names.end()) {
+        return static_cast<Register>(it - names.begin());
+    }
+
+    if (auto* local = FindLocal(*state.enclosing, name)) {
+        local->captured = true;
+        return AddUpvalue(state, name, true, local->reg);
+    }
+    if (auto upvalue = ResolveUpvalue(*state.enclosing, name)) {
+        return AddUpvalue(state, name, false, *upvalue);
+    }
+    return std::nullopt;
+}
+
+
+Register BytecodeCompiler::AddUpvalue(FunctionState& state, const std::string& name
+                                        , bool in_parent_local, Register index)
+{
+    if (state.upvalue_names.size() >= static_cast<std::size_t>(kMaxRegisters)) {
+        throw VirtualMachineError(VirtualMachineError::kTooManyUpvalues);
+    }
+    state.upvalue_names.push_back(name);
+    state.proto->upvalues.push_back({in_parent_local, index});
+    return static_cast<Register>(state.upvalue_names.size() - 1);
+}
+
+
+std::uint32_t BytecodeCompiler::GlobalSlot(const std::string& name) {
+    std::size_t slot = globals_.Bind(name);
+    if (slot > static_cast<std::size_t>(kMaxBx)) {
+        throw VirtualMachineError(VirtualMachineError::kTooManyConstants);
+    }
+    return static_cast<std::uint32_t>(slot);
+}
+
+
+bool BytecodeCompiler::IsGlobalScope() const {
+    return !fs_->enclosing && fs_->scopes.empty();
+}
+
+
+std::uint32_t BytecodeCompiler::AddConstant(const Value& value) {
+    auto& constants = fs_->proto->constants;
+    if (constants.size() >= static_cast<std::size_t>(kMaxBx)) {
+        throw VirtualMachineError(VirtualMachineError::kTooManyConstants);
+    }
+    constants.push_back(value);
+    return static_cast<std::uint32_t>(constants.size() - 1);
+}
+
+
+std::uint32_t BytecodeCompiler::NumberConstant(double number) {
+    auto& cache = fs_->number_constants;
+    if (auto it = cache.find(number); it != cache.end()) {
+        return it->second;
+    }
+    std::uint32_t index = AddConstant(Value(number));
+    cache.emplace(number, index);
+    return index;
+}
+
+
+std::uint32_t BytecodeCompiler::StringConstant(const std::string& str) {
+    auto& cache = fs_->string_constants;
+    if (auto it = cache.find(str); it != cache.end()) {
+        return it->second;
+    }
+    std::uint32_t index = AddConstant(Value(str));
+    cache.emplace(str, index);
+    return index;
+}
+
+
+std::size_t BytecodeCompiler::Emit(Instruction instruction) {
+    fs_->proto->code.push_back(instruction);
+    return fs_->proto->code.size() - 1;
+}
+
+
+std::size_t BytecodeCompiler::EmitJump(OpCode op, Register reg) {
+    return Emit(EncodeSBx(op, reg, 0));
+}
+
+
+void BytecodeCompiler::PatchJump(std::size_t at, std::size_t target) {
+    auto offset = static_cast<long long>(target) - static_cast<long long>(at + 1);
+    if (offset > kMaxSBx || offset < -kMaxSBx) {
+        throw VirtualMachineError(VirtualMachineError::kJumpTooLong);
+    }
+    auto& code = fs_->proto->code;
+    code[at] = EncodeSBx(GetOp(code[at]), GetA(code[at]), offset);
+}
+
+
+std::size_t BytecodeCompiler::CurrentOffset() const {
+    return fs_->proto->code.size();
+}
+
+
+void BytecodeCompiler::EmitCloseIfCaptured(std::size_t first_local) {
+    const auto& locals = fs_->locals;
+    bool captured = std::any_of(locals.begin() + first_local, locals.end()
+                                , [](const LocalVariable& local) { return local.captured; });
+    if (captured) {
+        Emit(Encode(OpCode::Close, locals[first_local].reg));
+    }
+}
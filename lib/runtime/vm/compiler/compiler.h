@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vls_and_sttmnts.h>
+#include <runtime/enviroment/global_table.h>
+#include <runtime/vm/bytecode/chunk.h>
+#include <runtime/vm/errors/vm_errors.h>
+
+
+// Lowers a semantically checked program into register bytecode.
+// Names assigned at the top level are bound in the global table the program
+// will run against and referenced by slot, everything declared
+// inside a function or a block lives in a register of its frame, and names of
+// enclosing functions are reached through upvalues.
+class BytecodeCompiler {
+public:
+    explicit BytecodeCompiler(GlobalTable&);
+
+    CompiledProgram Compile(const std::vector<Statement>&);
+
+private:
+    struct LocalVariable {
+        std::string name;
+        Register reg;
+        bool captured = false;
+    };
+
+    struct LoopContext {
+        Register base_reg;
+        std::vector<std::size_t> break_jumps;
+        std::vector<std::size_t> continue_jumps;
+    };
+
+    struct FunctionState {
+        FunctionState* enclosing = nullptr;
+        std::unique_ptr<FunctionProto> proto;
+        std::vector<LocalVariable> locals;
+        std::vector<std::size_t> scopes;
+        std::vector<LoopContext> loops;
+        std::vector<std::string> upvalue_names;
+        std::unordered_map<double, std::uint32_t> number_constants;
+        std::unordered_map<std::string, std::uint32_t> string_constants;
+        int free_reg = 0;
+    };
+
+private:
+    void CompileStatement(const Statement&);
+    void CompileStatements(const std::vector<Statement>&);
+
+    void CompileStatementImpl(const ExpressionStatement&);
+    void CompileStatementImpl(const IfStatement&);
+    void CompileStatementImpl(const WhileStatement&);
+    void CompileStatementImpl(const ForStatement&);
+    void CompileStatementImpl(const ReturnStatement&);
+    void CompileStatementImpl(const BlockStatement&);
+    void CompileStatementImpl(const BreakStatement&);
+    void CompileStatementImpl(const ContinueStatement&);
+
+private:
+    void CompileExpression(const Expression&, Register);
+    Register CompileToAnyRegister(const Expression&);
+    Register CompileOperand(const Expression&, const Expression&);
+    std::size_t CompileCondition(const Expression&);
+
+    void CompileExpressionImpl(const NumberExpression&, Register);
+    void CompileExpressionImpl(const StringExpression&, Register);
+    void CompileExpressionImpl(const BoolExpression&, Register);
+    void CompileExpressionImpl(const NilExpression&, Register);
+    void CompileExpressionImpl(const VariableExpression&, Register);
+    void CompileExpressionImpl(const UnaryExpression&, Register);
+    void CompileExpressionImpl(const BinaryExpression&, Register);
+    void CompileExpressionImpl(const CallableExpression&, Register);
+    void CompileExpressionImpl(const ListExpression&, Register);
+    void CompileExpressionImpl(const FunctionExpression&, Register);
+    void CompileExpressionImpl(const AssignExpression&, Register);
+    void CompileExpressionImpl(const IndexExpression&, Register);
+    void CompileExpressionImpl(const SliceExpression&, Register);
+    void CompileExpressionImpl(const IndexAssignExpression&, Register);
+    void CompileExpressionImpl(const FusedExpression&, Register);
+
+    void CompileAssign(const AssignExpression&, std::optional<Register>);
+    void CompileCompoundAssign(const AssignExpression&, std::optional<Register>);
+    void CompileFunction(const FunctionExpression&, Register, const std::string&);
+
+private:
+    void EnterScope();
+    void ExitScope(bool close_upvalues = true);
+    void DeclareAssignedNames(const Expression&);
+    Register DeclareLocal(const std::string&);
+    Register AllocateRegister();
+    void FreeTemporaries();
+
+    LocalVariable* FindLocal(FunctionState&, const std::string&);
+    std::optional<Register> ResolveUpvalue(FunctionState&, const std::string&);
+    Register AddUpvalue(FunctionState&, const std::string&, bool, Register);
+    std::uint32_t GlobalSlot(const std::string&);
+    bool IsGlobalScope() const;
+
+    std::uint32_t AddConstant(const Value&);
+    std::uint32_t NumberConstant(double);
+    std::uint32_t StringConstant(const std::string&);
+
+    std::size_t Emit(Instruction);
+    std::size_t EmitJump(OpCode, Register = 0);
+    void PatchJump(std::size_t, std::size_t);
+    std::size_t CurrentOffset() const;
+    void EmitCloseIfCaptured(std::size_t);
+
+private:
+    FunctionState* fs_ = nullptr;
+    GlobalTable& globals_;
+};
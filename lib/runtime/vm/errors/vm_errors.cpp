@@ -0,0 +1,6 @@
+#include <runtime/vm/errors/vm_errors.h>
+
+
+VirtualMachineError::VirtualMachineError(const std::string& message)
+    : std::runtime_error(message)
+{}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdexcept>
+
+
+class VirtualMachineError : public std::runtime_error {
+public:
+    static constexpr const char* kReturnOutsideFunction = "return outside of function";
+    static constexpr const char* kBreakOutsideLoop = "break outside of loop";
+    static constexpr const char* kContinueOutsideLoop = "continue outside of loop";
+    static constexpr const char* kTooManyRegisters = "function needs too many registers";
+    static constexpr const char* kTooManyConstants = "function has too many constants";
+    static constexpr const char* kTooManyUpvalues = "function captures too many variables";
+    static constexpr const char* kJumpTooLong = "control structure too long";
+    static constexpr const char* kUnsupportedOperator = "Unsupported operator";
+    static constexpr const char* kCallOfNonFunction = "Call of non-function";
+    static constexpr const char* kStackOverflow = "stack overflow: more nested calls than the limit of ";
+
+public:
+    VirtualMachineError(const std::string&);
+};
@@ -0,0 +1,504 @@
+#include <cmath>
+#include <sstream>
+
+#include <semantic.h>
+#include <syntax.h>
+#include <runtime/vm/vm.h>
+#include <runtime/interpreter/interpreter.h>
+#include <runtime/interpreter/errors/intrptr_errors.h>
+#include <runtime/interpreter/builtins/builtins.h>
+#include <runtime/evaluator/operations/handlers.h>
+
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ITMO_VM_COMPUTED_GOTO 1
+#endif
+
+
+static constexpr std::size_t kInitialStackSize = 1024;
+
+
+bool VirtualMachine::Interpret(std::istream& in, std::ostream& out, std::size_t max_depth) {
+    try {
+        SyntaxAnalizer parser(in);
+        auto program = parser.Parse();
+        VirtualMachine vm(out, max_depth);
+        SemanticAnalizer sem(out, vm.globals_.Names());
+        if (!sem.Analyse(program)) { return false; }
+
+        CompiledProgram compiled = BytecodeCompiler(vm.globals_).Compile(program);
+        vm.Run(compiled);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Interpreter error: " << e.what() << "\n";
+        return false;
+    } catch (...) {
+        std::cerr << InterpreterError::kUnknownError;
+        return false;
+    }
+}
+
+
+bool VirtualMachine::Disassemble(std::istream& in, std::ostream& out) {
+    try {
+        SyntaxAnalizer parser(in);
+        auto program = parser.Parse();
+        VirtualMachine vm(out);
+        SemanticAnalizer sem(out, vm.globals_.Names());
+        if (!sem.Analyse(program)) { return false; }
+
+        CompiledProgram compiled = BytecodeCompiler(vm.globals_).Compile(program);
+        ::Disassemble(*compiled.main, out);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Interpreter error: " << e.what() << "\n";
+        return false;
+    }
+}
+
+
+VirtualMachine::VirtualMachine(std::ostream& out, std::size_t max_depth)
+    : output_(out)
+    , globals_()
+    , stack_(kInitialStackSize)
+    , max_depth_(max_depth)
+{
+    BuiltinRegistry::Get().RegisterAll(globals_, output_, std::cin);
+
+    auto stacktrace = std::make_shared<FunctionalObject>(
+        [this](FunctionalObject::Arguments) -> Value {
+            return Value(GetStackTrace());
+        }
+    );
+    globals_.Define("stacktrace", Value(stacktrace));
+}
+
+
+void VirtualMachine::Run(const CompiledProgram& program) {
+    auto main = std::make_shared<CompiledClosure>();
+    main->proto = program.main.get();
+
+    EnsureStack(main->proto->max_registers);
+    frames_.push_back({main.get(), main->proto->code.data(), 0});
+    Execute();
+}
+
+
+void VirtualMachine::EnsureStack(std::size_t size) {
+    if (stack_.size() < size) {
+        stack_.resize(std::max(size, stack_.size() * 2));
+    }
+}
+
+
+std::shared_ptr<UpvalueCell> VirtualMachine::CaptureUpvalue(std::size_t slot) {
+    auto it = open_upvalues_.begin();
+    while (it != open_upvalues_.end() && (*it)->slot < slot) {
+        ++it;
+    }
+    if (it != open_upvalues_.end() && (*it)->slot == slot) {
+        return *it;
+    }
+    auto cell = std::make_shared<UpvalueCell>(UpvalueCell{slot, true, Value()});
+    open_upvalues_.insert(it, cell);
+    return cell;
+}
+
+
+void VirtualMachine::CloseUpvalues(std::size_t from) {
+    while (!open_upvalues_.empty() && open_upvalues_.back()->slot >= from) {
+        auto& cell = *open_upvalues_.back();
+        cell.closed = stack_[cell.slot];
+        cell.open = false;
+        open_upvalues_.pop_back();
+    }
+}
+
+
+Value& VirtualMachine::UpvalueRef(UpvalueCell& cell) {
+    return cell.open ? stack_[cell.slot] : cell.closed;
+}
+
+
+std::string VirtualMachine::GetStackTrace() const {
+    std::ostringstream oss;
+    oss << "stacktrace: ";
+    for (std::size_t i = 0; i < frames_.size(); ++i) {
+        if (i > 0) {
+            oss << " -> ";
+        }
+        oss << frames_[i].closure->proto->name;
+    }
+    return oss.str();
+}
+
+
+void VirtualMachine::StackOverflow() const {
+    std::vector<std::string> names;
+    for (const CallInfo& frame : frames_) {
+        names.push_back(frame.closure->proto->name);
+    }
+    throw VirtualMachineError(VirtualMachineError::kStackOverflow + std::to_string(max_depth_)
+                              + "\n" + Interpreter::FormatStackTrace(names));
+}
+
+
+void VirtualMachine::Execute() {
+    const std::size_t entry_depth = frames_.size() - 1;
+
+    CompiledClosure* closure;
+    const Instruction* pc;
+    const Value* constants;
+    std::size_t base;
+    Value* R;
+    Instruction i;
+
+#define ITMO_VM_LOAD_FRAME()                                    \
+    do {                                                        \
+        const CallInfo& frame = frames_.back();                 \
+        closure = frame.closure;                                \
+        pc = frame.pc;                                          \
+        base = frame.base;                                      \
+        constants = closure->proto->constants.data();           \
+        R = stack_.data() + base;                               \
+    } while (0)
+
+#define ITMO_VM_ARITHMETIC(name, expr, fallback)                \
+    ITMO_VM_CASE(name) {                                        \
+        const Value& lhs = R[GetB(i)];                          \
+        const Value& rhs = R[GetC(i)];                          \
+        if (lhs.IsNumber() && rhs.IsNumber()) {                 \
+            double x = lhs.AsNumber();                          \
+            double y = rhs.AsNumber();                          \
+            R[GetA(i)] = Value(expr);                           \
+        } else {                                                \
+            R[GetA(i)] = fallback(lhs, rhs);                    \
+        }                                                       \
+        ITMO_VM_DISPATCH();                                     \
+    }
+
+#define ITMO_VM_COMPARISON(name, cmp, fallback)                 \
+    ITMO_VM_CASE(name) {                                        \
+        const Value& lhs = R[GetB(i)];                          \
+        const Value& rhs = R[GetC(i)];                          \
+        if (lhs.IsNumber() && rhs.IsNumber()) {                 \
+            double x = lhs.AsNumber();                          \
+            double y = rhs.AsNumber();                          \
+            R[GetA(i)] = Value(x cmp y);                        \
+        } else {                                                \
+            R[GetA(i)] = fallback(lhs, rhs);                    \
+        }                                                       \
+        ITMO_VM_DISPATCH();                                     \
+    }
+
+#define ITMO_VM_TEST(name, cmp, fallback)                       \
+    ITMO_VM_CASE(name) {                                        \
+        const Value& lhs = R[GetA(i)];                          \
+        const Value& rhs = R[GetB(i)];                          \
+        bool holds = (lhs.IsNumber() && rhs.IsNumber())         \
+            ? (lhs.AsNumber() cmp rhs.AsNumber())               \
+            : Interpreter::IsTrue(fallback(lhs, rhs));          \
+        pc += holds ? 1 : 1 + GetSBx(*pc);                      \
+        ITMO_VM_DISPATCH();                                     \
+    }
+
+#ifdef ITMO_VM_COMPUTED_GOTO
+    static void* const kDispatchTable[] = {
+#define ITMO_VM_LABEL(name) &&op_##name,
+        ITMO_VM_OPCODES(ITMO_VM_LABEL)
+#undef ITMO_VM_LABEL
+    };
+#define ITMO_VM_CASE(name) op_##name:
+#define ITMO_VM_DISPATCH()                                      \
+    do {                                                        \
+        i = *pc++;                                              \
+        goto *kDispatchTable[static_cast<int>(GetOp(i))];       \
+    } while (0)
+#else
+#define ITMO_VM_CASE(name) case OpCode::name:
+#define ITMO_VM_DISPATCH() continue
+#endif
+
+    auto equal = [](const Value& lhs, const Value& rhs) {
+        return Value(Interpreter::IsEqual(lhs, rhs));
+    };
+    auto not_equal = [](const Value& lhs, const Value& rhs) {
+        return Value(!Interpreter::IsEqual(lhs, rhs));
+    };
+
+    ITMO_VM_LOAD_FRAME();
+
+#ifdef ITMO_VM_COMPUTED_GOTO
+    ITMO_VM_DISPATCH();
+#else
+    for (;;) {
+        i = *pc++;
+        switch (GetOp(i)) {
+#endif
+
+    ITMO_VM_CASE(Move) {
+        R[GetA(i)] = R[GetB(i)];
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(LoadK) {
+        R[GetA(i)] = constants[GetBx(i)];
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(LoadNil) {
+        R[GetA(i)] = Value();
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(LoadBool) {
+        R[GetA(i)] = Value(GetB(i) != 0);
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(GetGlobal) {
+        R[GetA(i)] = globals_.Get(GetBx(i));
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(SetGlobal) {
+        globals_.Set(GetBx(i), R[GetA(i)]);
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(GetUpval) {
+        R[GetA(i)] = UpvalueRef(*closure->upvalues[GetB(i)]);
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(SetUpval) {
+        UpvalueRef(*closure->upvalues[GetB(i)]) = R[GetA(i)];
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_ARITHMETIC(Add, x + y, Add)
+
+    ITMO_VM_CASE(AddTo) {
+        Value& lhs = R[GetA(i)];
+        const Value& rhs = R[GetB(i)];
+        if (lhs.IsNumber() && rhs.IsNumber()) {
+            lhs = Value(lhs.AsNumber() + rhs.AsNumber());
+        } else {
+            AddInPlace(lhs, rhs);
+        }
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(AddGlobal) {
+        AddInPlace(globals_.Get(GetBx(i)), R[GetA(i)]);
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(AddUpval) {
+        AddInPlace(UpvalueRef(*closure->upvalues[GetB(i)]), R[GetA(i)]);
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_ARITHMETIC(Sub, x - y, Substract)
+    ITMO_VM_ARITHMETIC(Mul, x * y, Multiply)
+    ITMO_VM_ARITHMETIC(Div, x / y, Divide)
+    ITMO_VM_ARITHMETIC(Mod, std::fmod(x, y), Mod)
+    ITMO_VM_ARITHMETIC(Pow, std::pow(x, y), PowerOf)
+
+    ITMO_VM_COMPARISON(Eq, ==, equal)
+    ITMO_VM_COMPARISON(Ne, !=, not_equal)
+    ITMO_VM_COMPARISON(Lt, <, Less)
+    ITMO_VM_COMPARISON(Le, <=, LessEqual)
+    ITMO_VM_COMPARISON(Gt, >, Greater)
+    ITMO_VM_COMPARISON(Ge, >=, GreaterEqual)
+
+    ITMO_VM_CASE(Neg) {
+        const Value& operand = R[GetB(i)];
+        if (operand.IsNumber()) {
+            R[GetA(i)] = Value(-operand.AsNumber());
+        } else {
+            R[GetA(i)] = Negate(operand);
+        }
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(Not) {
+        R[GetA(i)] = LogicalNot(R[GetB(i)]);
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(Jmp) {
+        pc += GetSBx(i);
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(JmpIf) {
+        if (Interpreter::IsTrue(R[GetA(i)])) {
+            pc += GetSBx(i);
+        }
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(JmpIfNot) {
+        if (!Interpreter::IsTrue(R[GetA(i)])) {
+            pc += GetSBx(i);
+        }
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_TEST(TestEq, ==, equal)
+    ITMO_VM_TEST(TestNe, !=, not_equal)
+    ITMO_VM_TEST(TestLt, <, Less)
+    ITMO_VM_TEST(TestLe, <=, LessEqual)
+    ITMO_VM_TEST(TestGt, >, Greater)
+    ITMO_VM_TEST(TestGe, >=, GreaterEqual)
+
+    ITMO_VM_CASE(NewList) {
+        Value::Array array;
+        array.reserve(GetC(i));
+        for (std::size_t k = 0; k < GetC(i); ++k) {
+            array.push_back(R[GetB(i) + k]);
+        }
+        R[GetA(i)] = Value(std::move(array));
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(AppendList) {
+        auto& array = R[GetA(i)].AsList();
+        for (std::size_t k = 0; k < GetC(i); ++k) {
+            array.push_back(R[GetB(i) + k]);
+        }
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(Index) {
+        R[GetA(i)] = ::Index(R[GetB(i)], R[GetC(i)]);
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(Slice) {
+        const Value& from = R[GetC(i)];
+        const Value& to = R[GetC(i) + 1];
+        R[GetA(i)] = ::Slice(R[GetB(i)]
+                            , from.IsNil() ? nullptr : &from
+                            , to.IsNil() ? nullptr : &to);
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(SetIndex) {
+        ::SetIndex(R[GetA(i)], R[GetB(i)], R[GetC(i)]);
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(Call) {
+        Register a = GetA(i);
+        std::size_t argc = GetB(i);
+
+        if (!R[a].IsFunction()) {
+            throw VirtualMachineError(VirtualMachineError::kCallOfNonFunction);
+        }
+        const FunctionalObject* function = R[a].AsFunction().get();
+
+        if (CompiledClosure* callee = function->compiled.get()) {
+            const FunctionProto* proto = callee->proto;
+            std::size_t callee_base = base + a + 1;
+
+            frames_.back().pc = pc;
+            // The bottom frame is the program itself.
+            if (frames_.size() > max_depth_) {
+                StackOverflow();
+            }
+            EnsureStack(callee_base + proto->max_registers);
+            for (std::size_t k = argc; k < proto->num_params; ++k) {
+                stack_[callee_base + k] = Value();
+            }
+            frames_.push_back({callee, proto->code.data(), callee_base});
+            ITMO_VM_LOAD_FRAME();
+        } else if (function->native) {
+            Value result = function->native(FunctionalObject::Arguments(R + a + 1, argc));
+            R[a] = std::move(result);
+        } else {
+            throw VirtualMachineError(VirtualMachineError::kCallOfNonFunction);
+        }
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(Return) {
+        if (!open_upvalues_.empty()) {
+            CloseUpvalues(base);
+        }
+        Value result = GetB(i) ? std::move(R[GetA(i)]) : Value();
+
+        frames_.pop_back();
+        if (frames_.size() == entry_depth) {
+            return;
+        }
+        stack_[base - 1] = std::move(result);
+        ITMO_VM_LOAD_FRAME();
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(Closure) {
+        const FunctionProto* proto = closure->proto->protos[GetBx(i)].get();
+        auto compiled = std::make_shared<CompiledClosure>();
+        compiled->proto = proto;
+        compiled->upvalues.reserve(proto->upvalues.size());
+
+        for (const auto& upvalue : proto->upvalues) {
+            compiled->upvalues.push_back(upvalue.in_parent_local
+                ? CaptureUpvalue(base + upvalue.index)
+                : closure->upvalues[upvalue.index]);
+        }
+        R[GetA(i)] = Value(std::make_shared<FunctionalObject>(std::move(compiled)));
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(Close) {
+        if (!open_upvalues_.empty()) {
+            CloseUpvalues(base + GetA(i));
+        }
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(ForPrep) {
+        if (!R[GetA(i)].IsList()) {
+            throw VirtualMachineError(InterpreterError::kCanOnlyIterateArrays);
+        }
+        R[GetA(i) + 1] = Value(0.0);
+        pc += GetSBx(i);
+        ITMO_VM_DISPATCH();
+    }
+
+    ITMO_VM_CASE(ForLoop) {
+        const Value& iterable = R[GetA(i)];
+        auto position = static_cast<std::size_t>(R[GetA(i) + 1].AsNumber());
+        if (iterable.IsRange()) {
+            const Range& range = iterable.AsRange();
+            if (position < range.size) {
+                R[GetA(i) + 2] = Value(range.At(position));
+                R[GetA(i) + 1] = Value(static_cast<double>(position + 1));
+                pc += GetSBx(i);
+            }
+        } else {
+            const auto& array = iterable.AsList();
+            if (position < array.size()) {
+                R[GetA(i) + 2] = array[position];
+                R[GetA(i) + 1] = Value(static_cast<double>(position + 1));
+                pc += GetSBx(i);
+            }
+        }
+        ITMO_VM_DISPATCH();
+    }
+
+#ifndef ITMO_VM_COMPUTED_GOTO
+        }
+    }
+#endif
+
+#undef ITMO_VM_LOAD_FRAME
+#undef ITMO_VM_ARITHMETIC
+#undef ITMO_VM_COMPARISON
+#undef ITMO_VM_TEST
+#undef ITMO_VM_CASE
+#undef ITMO_VM_DISPATCH
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <runtime/value/value.h>
+#include <runtime/function/function.h>
+#include <runtime/enviroment/global_table.h>
+#include <runtime/vm/bytecode/chunk.h>
+#include <runtime/vm/compiler/compiler.h>
+#include <runtime/vm/errors/vm_errors.h>
+#include <runtime/interpreter/interpreter.h>
+
+
+// Register-based alternative to the tree-walking Interpreter. Script frames
+// live on a heap-allocated call stack, so script-to-script calls never recurse
+// on the native stack; builtins are shared with the tree-walker.
+class VirtualMachine {
+public:
+    // More than `max_depth` nested script calls is a stack overflow error.
+    static bool Interpret(std::istream&, std::ostream&, std::size_t max_depth = kDefaultMaxCallDepth);
+    static bool Disassemble(std::istream&, std::ostream&);
+
+private:
+    struct CallInfo {
+        CompiledClosure* closure;
+        const Instruction* pc;
+        std::size_t base;
+    };
+
+private:
+    VirtualMachine(std::ostream&, std::size_t max_depth = kDefaultMaxCallDepth);
+
+    void Run(const CompiledProgram&);
+    void Execute();
+    void EnsureStack(std::size_t);
+
+    std::shared_ptr<UpvalueCell> CaptureUpvalue(std::size_t);
+    void CloseUpvalues(std::size_t);
+    Value& UpvalueRef(UpvalueCell&);
+
+    std::string GetStackTrace() const;
+    [[noreturn]] void StackOverflow() const;
+
+private:
+    std::ostream& output_;
+    GlobalTable globals_;
+    std::vector<Value> stack_;
+    std::vector<CallInfo> frames_;
+    std::size_t max_depth_;
+    std::vector<std::shared_ptr<UpvalueCell>> open_upvalues_;
+};
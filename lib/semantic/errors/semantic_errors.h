@@ -27,6 +27,8 @@ struct ErrorMsgHandler {
     static constexpr const char*
     kIndexMustBeNumber = "Index must be a number";
     static constexpr const char*
+    kAttemptingToAssignToNonListElement = "Attempting to assign to an element of non-list type";
+    static constexpr const char*
     kAttemptingToSliceNonSliceableType = "Attempting to slice non-sliceable type";
     static constexpr const char*
     kSliceStartIndexMustBeNumber = "Slice start index must be a number";
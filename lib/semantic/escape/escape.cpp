@@ -0,0 +1,195 @@
+#include <algorithm>
+
+#include <escape/escape.h>
+
+
+EscapeAnalysis::EscapeAnalysis(const std::vector<std::string>& global_names) {
+    auto it = std::find(global_names.begin(), global_names.end(), "len");
+    if (it != global_names.end()) {
+        len_ = static_cast<std::uint32_t>(it - global_names.begin());
+    }
+}
+
+
+// Whether a variable escapes is only known once the whole body has been
+// walked, and whether `len` is rebound once the whole program has.
+void EscapeAnalysis::Run(const std::vector<Statement>& program) {
+    for (const auto& statement : program) {
+        Walk(statement);
+    }
+
+    if (len_assigned_) {
+        escaping_.insert(measured_.begin(), measured_.end());
+    }
+    for (const auto& [list, variable] : bound_) {
+        if (!escaping_.count(variable)) {
+            list->escapes = false;
+        }
+    }
+}
+
+
+void EscapeAnalysis::Walk(const std::vector<Statement>& statements, const ScopeLayout& layout) {
+    bool enters = !frames_.empty() && !layout.elided;
+    if (enters) {
+        frames_.back().scopes.push_back(next_scope_++);
+    }
+    for (const auto& statement : statements) {
+        Walk(statement);
+    }
+    if (enters) {
+        frames_.back().scopes.pop_back();
+    }
+}
+
+
+void EscapeAnalysis::Walk(const Statement& statement) {
+    std::visit([this](const auto& stmt) {
+        using T = std::decay_t<decltype(stmt)>;
+
+        if constexpr (std::is_same_v<T, ExpressionStatement>) {
+            Walk(stmt.expression, false);
+        } else if constexpr (std::is_same_v<T, IfStatement>) {
+            Walk(stmt.condition, false);
+            Walk(stmt.then_case, stmt.then_scope);
+            Walk(stmt.else_case, stmt.else_scope);
+        } else if constexpr (std::is_same_v<T, WhileStatement>) {
+            if (!frames_.empty()) { ++frames_.back().loops; }
+            Walk(stmt.condition, false);
+            Walk(stmt.body, stmt.body_scope);
+            if (!frames_.empty()) { --frames_.back().loops; }
+        } else if constexpr (std::is_same_v<T, ForStatement>) {
+            Walk(stmt.iter, false);
+            if (!frames_.empty()) { ++frames_.back().loops; }
+            Walk(stmt.body, stmt.body_scope);
+            if (!frames_.empty()) { --frames_.back().loops; }
+        } else if constexpr (std::is_same_v<T, ReturnStatement>) {
+            const auto* call = stmt.value ? std::get_if<CallableExpression>(&stmt.value->value) : nullptr;
+            if (call && stmt.tail_call) {
+                WalkCall(*call, true);
+            } else if (stmt.value) {
+                Walk(*stmt.value, true);
+            }
+        } else if constexpr (std::is_same_v<T, BlockStatement>) {
+            Walk(stmt.statements, stmt.scope);
+        }
+    }, statement.value);
+}
+
+
+void EscapeAnalysis::Walk(const Expression& expression, bool kept) {
+    std::visit([this, kept](const auto& expr) {
+        using T = std::decay_t<decltype(expr)>;
+
+        if constexpr (std::is_same_v<T, VariableExpression>) {
+            if (auto variable = Local(expr.address); variable && kept) {
+                escaping_.insert(*variable);
+            }
+        } else if constexpr (std::is_same_v<T, UnaryExpression>) {
+            Walk(*expr.rhs, false);
+        } else if constexpr (std::is_same_v<T, BinaryExpression>) {
+            // `and` and `or` give back one of their operands.
+            bool logical = expr.operation == TokenType::and_ || expr.operation == TokenType::or_;
+            Walk(*expr.lhs, logical && kept);
+            Walk(*expr.rhs, logical && kept);
+        } else if constexpr (std::is_same_v<T, CallableExpression>) {
+            WalkCall(expr);
+        } else if constexpr (std::is_same_v<T, ListExpression>) {
+            for (const auto& element : expr.elements) {
+                Walk(*element, true);
+            }
+            if (!kept && Confined()) {
+                expr.escapes = false;
+            }
+        } else if constexpr (std::is_same_v<T, FunctionExpression>) {
+            Frame frame;
+            frame.scopes.push_back(next_scope_++);
+            frames_.push_back(std::move(frame));
+            for (const auto& statement : expr.f_body) {
+                Walk(statement);
+            }
+            frames_.pop_back();
+        } else if constexpr (std::is_same_v<T, AssignExpression>) {
+            WalkAssign(expr, kept);
+        } else if constexpr (std::is_same_v<T, IndexExpression>) {
+            Walk(*expr.object, false);
+            Walk(*expr.index, false);
+        } else if constexpr (std::is_same_v<T, SliceExpression>) {
+            Walk(*expr.object, false);
+            if (expr.from_s) { Walk(*expr.from_s, false); }
+            if (expr.to_s) { Walk(*expr.to_s, false); }
+        } else if constexpr (std::is_same_v<T, IndexAssignExpression>) {
+            Walk(*expr.object, false);
+            Walk(*expr.index, false);
+            Walk(*expr.rhs, true);
+        } else if constexpr (std::is_same_v<T, FusedExpression>) {
+            Walk(*expr.original, kept);
+        }
+    }, expression.value);
+}
+
+
+// A tail call runs its callee once the caller's lists are released, so
+// there even `len` keeps its argument.
+void EscapeAnalysis::WalkCall(const CallableExpression& expr, bool tail) {
+    Walk(*expr.callable, false);
+
+    const auto* callee = std::get_if<VariableExpression>(&expr.callable->value);
+    if (!tail && callee && len_ && callee->address.kind == LexicalAddress::Kind::Global
+        && callee->address.slot == *len_ && expr.f_arguments.size() == 1)
+    {
+        if (auto variable = Local(*expr.f_arguments[0])) {
+            measured_.insert(*variable);
+            return;
+        }
+    }
+    for (const auto& argument : expr.f_arguments) {
+        Walk(*argument, true);
+    }
+}
+
+
+void EscapeAnalysis::WalkAssign(const AssignExpression& expr, bool kept) {
+    if (expr.address.kind == LexicalAddress::Kind::Global && len_ && expr.address.slot == *len_) {
+        len_assigned_ = true;
+    }
+
+    auto variable = Local(expr.address);
+    const auto* list = std::get_if<ListExpression>(&expr.rhs->value);
+    if (variable && list && !kept && expr.operation == TokenType::assign_ && Confined()) {
+        for (const auto& element : list->elements) {
+            Walk(*element, true);
+        }
+        bound_.emplace_back(list, *variable);
+        return;
+    }
+
+    Walk(*expr.rhs, true);
+    if (variable && kept) {
+        escaping_.insert(*variable);
+    }
+}
+
+
+std::optional<EscapeAnalysis::Variable> EscapeAnalysis::Local(const Expression& expression) const {
+    const auto* var = std::get_if<VariableExpression>(&expression.value);
+    return var ? Local(var->address) : std::nullopt;
+}
+
+
+std::optional<EscapeAnalysis::Variable> EscapeAnalysis::Local(const LexicalAddress& address) const {
+    if (frames_.empty() || address.kind != LexicalAddress::Kind::Local) {
+        return std::nullopt;
+    }
+    const auto& scopes = frames_.back().scopes;
+    if (address.depth >= scopes.size()) {
+        return std::nullopt;
+    }
+    return Variable{scopes[scopes.size() - 1 - address.depth], address.slot};
+}
+
+
+// Inside a function and outside its loops.
+bool EscapeAnalysis::Confined() const {
+    return !frames_.empty() && frames_.back().loops == 0;
+}
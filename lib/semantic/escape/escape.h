@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <vls_and_sttmnts.h>
+
+
+// Finds the list literals in function bodies whose list can never outlive
+// the call that creates it, and clears their ListExpression::escapes. Such
+// a literal is either used on the spot (indexed, sliced, iterated over,
+// compared, or combined by an arithmetic operator) or assigned to a local
+// that is only used that way or passed to `len` outside a tail call. A
+// local escapes when its value may be kept: assigned to another variable,
+// stored in a list, passed to a call, returned, or captured by a closure
+// (a Cell). Literals inside loops are left alone, since their memory is
+// reclaimed only when the call returns. Runs on a program SemanticAnalizer
+// has resolved.
+class EscapeAnalysis {
+public:
+    // `global_names` as SemanticAnalizer::GlobalNames returns them.
+    explicit EscapeAnalysis(const std::vector<std::string>& global_names);
+
+    void Run(const std::vector<Statement>&);
+
+private:
+    // A local: the scope holding it, numbered in the order scopes are
+    // entered, and its slot there.
+    using Variable = std::pair<std::uint32_t, std::uint32_t>;
+
+    // A function body being walked.
+    struct Frame {
+        std::vector<std::uint32_t> scopes;
+        std::size_t loops = 0;
+    };
+
+private:
+    void Walk(const std::vector<Statement>&, const ScopeLayout&);
+    void Walk(const Statement&);
+    // `kept` tells whether the value of the expression may outlive it.
+    void Walk(const Expression&, bool kept);
+    void WalkCall(const CallableExpression&, bool tail = false);
+    void WalkAssign(const AssignExpression&, bool kept);
+
+    std::optional<Variable> Local(const Expression&) const;
+    std::optional<Variable> Local(const LexicalAddress&) const;
+    bool Confined() const;
+
+private:
+    std::optional<std::uint32_t> len_;
+    bool len_assigned_ = false;
+    std::uint32_t next_scope_ = 0;
+    std::vector<Frame> frames_;
+    std::set<Variable> escaping_;
+    // Passed to `len`, which keeps nothing unless the program rebinds it.
+    std::set<Variable> measured_;
+    std::vector<std::pair<const ListExpression*, Variable>> bound_;
+};
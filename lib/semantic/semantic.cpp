@@ -3,6 +3,51 @@
 #include <semantic.h>
 
 
+namespace {
+
+// Assignments evaluated directly in a scope, i.e. not inside a nested block
+// or function body, which get scopes of their own.
+void CollectAssignedNames(const Expression& expression, SymbolTable& table) {
+    std::visit([&table](const auto& expr) {
+        using T = std::decay_t<decltype(expr)>;
+
+        if constexpr (std::is_same_v<T, AssignExpression>) {
+            table.Reserve(expr.name);
+            CollectAssignedNames(*expr.rhs, table);
+        } else if constexpr (std::is_same_v<T, UnaryExpression>) {
+            CollectAssignedNames(*expr.rhs, table);
+        } else if constexpr (std::is_same_v<T, BinaryExpression>) {
+            CollectAssignedNames(*expr.lhs, table);
+            CollectAssignedNames(*expr.rhs, table);
+        } else if constexpr (std::is_same_v<T, CallableExpression>) {
+            CollectAssignedNames(*expr.callable, table);
+            for (const auto& arg : expr.f_arguments) {
+                CollectAssignedNames(*arg, table);
+            }
+        } else if constexpr (std::is_same_v<T, ListExpression>) {
+            for (const auto& element : expr.elements) {
+                CollectAssignedNames(*element, table);
+            }
+        } else if constexpr (std::is_same_v<T, IndexExpression>) {
+            CollectAssignedNames(*expr.object, table);
+            CollectAssignedNames(*expr.index, table);
+        } else if constexpr (std::is_same_v<T, SliceExpression>) {
+            CollectAssignedNames(*expr.object, table);
+            if (expr.from_s) { CollectAssignedNames(*expr.from_s, table); }
+            if (expr.to_s) { CollectAssignedNames(*expr.to_s, table); }
+        } else if constexpr (std::is_same_v<T, IndexAssignExpression>) {
+            CollectAssignedNames(*expr.object, table);
+            CollectAssignedNames(*expr.index, table);
+            CollectAssignedNames(*expr.rhs, table);
+        } else if constexpr (std::is_same_v<T, FusedExpression>) {
+            CollectAssignedNames(*expr.original, table);
+        }
+    }, expression.value);
+}
+
+}
+
+
 inline void SemanticAnalizer::ErrorReport(const std::string& message
     , const std::string& details)
 {
@@ -16,23 +61,66 @@ inline void SemanticAnalizer::ErrorReport(const std::string& message
 
 SemanticAnalizer::SemanticAnalizer(std::ostream& error_stream)
     : error_stream_(error_stream)
+    , predefined_(SymbolTable::kBuiltinFunctions.begin()
+                , SymbolTable::kBuiltinFunctions.end())
+{}
+
+
+// Predefined names take the first global slots in the given order, which
+// lets the caller pass the names its global table already binds.
+SemanticAnalizer::SemanticAnalizer(std::ostream& error_stream
+    , std::vector<std::string> predefined)
+    : error_stream_(error_stream)
+    , predefined_(std::move(predefined))
 {}
 
 
 bool SemanticAnalizer::Analyse(const std::vector<Statement>& program) {
     symbol_table_.EnterScope();
 
-    for (const auto& builtin : SymbolTable::kBuiltinFunctions) {
-        symbol_table_.Declare(builtin);
+    for (const auto& name : predefined_) {
+        symbol_table_.Declare(name);
     }
+    ReserveAssignedNames(program);
 
     bool success = ProcessStatements(program);
+    global_names_ = symbol_table_.GlobalNames();
     symbol_table_.ExitScope();
 
+    if (success) {
+        EscapeAnalysis(global_names_).Run(program);
+    }
+
     return success;
 }
 
 
+const std::vector<std::string>& SemanticAnalizer::GlobalNames() const {
+    return global_names_;
+}
+
+
+void SemanticAnalizer::ReserveAssignedNames(const std::vector<Statement>& statements) {
+    for (const auto& statement : statements) {
+        std::visit([this](const auto& stmt) {
+            using T = std::decay_t<decltype(stmt)>;
+
+            if constexpr (std::is_same_v<T, ExpressionStatement>) {
+                CollectAssignedNames(stmt.expression, symbol_table_);
+            } else if constexpr (std::is_same_v<T, IfStatement>
+                                || std::is_same_v<T, WhileStatement>)
+            {
+                CollectAssignedNames(stmt.condition, symbol_table_);
+            } else if constexpr (std::is_same_v<T, ForStatement>) {
+                CollectAssignedNames(stmt.iter, symbol_table_);
+            } else if constexpr (std::is_same_v<T, ReturnStatement>) {
+                if (stmt.value) { CollectAssignedNames(*stmt.value, symbol_table_); }
+            }
+        }, statement.value);
+    }
+}
+
+
 bool SemanticAnalizer::ProcessStatement(const Statement& statement) {
     return std::visit([this](const auto& stmt) {
         return ProcessStatementImpl(stmt);
@@ -93,10 +181,15 @@ bool SemanticAnalizer::CheckUnaryOperation(const UnaryExpression& expr) {
 
 
 bool SemanticAnalizer::CheckBinaryOperation(const BinaryExpression& expr) {
-    auto left_type = GetExpressionType(*expr.lhs);
-    auto right_type = GetExpressionType(*expr.rhs);
+    return CheckBinaryOperation(expr.operation
+        , GetExpressionType(*expr.lhs), GetExpressionType(*expr.rhs));
+}
+
 
-    switch (expr.operation) {
+bool SemanticAnalizer::CheckBinaryOperation(TokenType operation
+                , SemanticType left_type, SemanticType right_type)
+{
+    switch (operation) {
         case TokenType::plus_:
             if (left_type == SemanticType::String
                 || right_type == SemanticType::String)
@@ -104,8 +197,10 @@ bool SemanticAnalizer::CheckBinaryOperation(const BinaryExpression& expr) {
                 return true;
             }
 
-            if (left_type == SemanticType::Number
+            if ((left_type == SemanticType::Number
                 && right_type == SemanticType::Number)
+                || (left_type == SemanticType::List
+                && right_type == SemanticType::List))
             {
                 return true;
             }
@@ -298,3 +393,25 @@ bool SemanticAnalizer::CheckTypeCompatibility(SemanticType expected
     ErrorReport(ErrorMsgHandler::kTypeMismatchInSlice + context);
     return false;
 }
+
+
+bool SemanticAnalizer::CheckIndexAssignExpression(const IndexAssignExpression& expr) {
+    auto object_type = GetExpressionType(*expr.object);
+    auto index_type = GetExpressionType(*expr.index);
+
+    if (object_type != SemanticType::List
+        && object_type != SemanticType::Unknown)
+    {
+        ErrorReport(ErrorMsgHandler::kAttemptingToAssignToNonListElement);
+        return false;
+    }
+
+    if (index_type != SemanticType::Number
+        && index_type != SemanticType::Unknown)
+    {
+        ErrorReport(ErrorMsgHandler::kIndexMustBeNumber);
+        return false;
+    }
+
+    return true;
+}
@@ -5,6 +5,7 @@
 #include <algorithm>
 
 #include <syntax.h>
+#include <escape/escape.h>
 #include <symbols/symb_table.h>
 #include <errors/semantic_errors.h>
 #include <type_system/type_system.h>
@@ -39,23 +40,30 @@ concept ExpressionLike = requires {
     || std::is_same_v<T, FunctionExpression>
     || std::is_same_v<T, AssignExpression>
     || std::is_same_v<T, IndexExpression>
-    || std::is_same_v<T, SliceExpression>;
+    || std::is_same_v<T, SliceExpression>
+    || std::is_same_v<T, IndexAssignExpression>
+    || std::is_same_v<T, FusedExpression>;
 };
 
 
 class SemanticAnalizer {
 public:
     SemanticAnalizer(std::ostream&);
+    SemanticAnalizer(std::ostream&, std::vector<std::string>);
     bool Analyse(const std::vector<Statement>&);
 
+    const std::vector<std::string>& GlobalNames() const;
+
 private:
     SemanticType GetExpressionType(const Expression&);
     bool CheckTypeCompatibility(SemanticType, SemanticType, const std::string&);
     bool CheckBinaryOperation(const BinaryExpression&);
+    bool CheckBinaryOperation(TokenType, SemanticType, SemanticType);
     bool CheckUnaryOperation(const UnaryExpression&);
     bool CheckCallableExpression(const CallableExpression&);
     bool CheckIndexExpression(const IndexExpression&);
     bool CheckSliceExpression(const SliceExpression&);
+    bool CheckIndexAssignExpression(const IndexAssignExpression&);
 
 private:
     bool ProcessStatement(const Statement&);
@@ -64,6 +72,8 @@ private:
 
     void ErrorReport(const std::string&, const std::string& details = "");
 
+    void ReserveAssignedNames(const std::vector<Statement>&);
+
     template<StatementLike T>
     bool ProcessStatementImpl(const T&);
 
@@ -78,7 +88,11 @@ private:
 
 private:
     std::ostream& error_stream_;
+    std::vector<std::string> predefined_;
+    std::vector<std::string> global_names_;
     SymbolTable symbol_table_;
+    // Functions being analysed; a call returned inside one is a tail call.
+    std::size_t functions_ = 0;
     std::unordered_map<std::string, SemanticType> variable_types_;
 };
 
@@ -124,13 +138,17 @@ inline bool SemanticAnalizer::ProcessStatementImpl(const IfStatement& stmt) {
     bool success = ProcessExpression(stmt.condition);
 
     symbol_table_.EnterScope();
+    ReserveAssignedNames(stmt.then_case);
+    symbol_table_.ElideIfEmpty();
     success &= ProcessStatements(stmt.then_case);
-    symbol_table_.ExitScope();
+    stmt.then_scope = symbol_table_.ExitScope();
 
     if (!stmt.else_case.empty()) {
         symbol_table_.EnterScope();
+        ReserveAssignedNames(stmt.else_case);
+        symbol_table_.ElideIfEmpty();
         success &= ProcessStatements(stmt.else_case);
-        symbol_table_.ExitScope();
+        stmt.else_scope = symbol_table_.ExitScope();
     }
 
     return success;
@@ -142,8 +160,10 @@ inline bool SemanticAnalizer::ProcessStatementImpl(const WhileStatement& stmt) {
     bool success = ProcessExpression(stmt.condition);
 
     symbol_table_.EnterScope();
+    ReserveAssignedNames(stmt.body);
+    symbol_table_.ElideIfEmpty();
     success &= ProcessStatements(stmt.body);
-    symbol_table_.ExitScope();
+    stmt.body_scope = symbol_table_.ExitScope();
 
     return success;
 }
@@ -157,14 +177,18 @@ inline bool SemanticAnalizer::ProcessStatementImpl(const ForStatement& stmt) {
         ErrorReport(ErrorMsgHandler::kVariableAlreadyDeclared, stmt.var);
         return false;
     }
+    ReserveAssignedNames(stmt.body);
     success &= ProcessStatements(stmt.body);
-    symbol_table_.ExitScope();
+    stmt.body_scope = symbol_table_.ExitScope();
     return success;
 }
 
 
 template<>
 inline bool SemanticAnalizer::ProcessStatementImpl(const ReturnStatement& stmt) {
+    if (stmt.value && std::holds_alternative<CallableExpression>(stmt.value->value) && functions_ > 0) {
+        stmt.tail_call = true;
+    }
     return stmt.value ? ProcessExpression(*stmt.value) : true;
 }
 
@@ -172,8 +196,10 @@ inline bool SemanticAnalizer::ProcessStatementImpl(const ReturnStatement& stmt)
 template<>
 inline bool SemanticAnalizer::ProcessStatementImpl(const BlockStatement& stmt) {
     symbol_table_.EnterScope();
+    ReserveAssignedNames(stmt.statements);
+    symbol_table_.ElideIfEmpty();
     bool success = ProcessStatements(stmt.statements);
-    symbol_table_.ExitScope();
+    stmt.scope = symbol_table_.ExitScope();
     return success;
 }
 
@@ -184,6 +210,7 @@ inline bool SemanticAnalizer::ProcessExpressionImpl(const VariableExpression& ex
         ErrorReport(ErrorMsgHandler::kUndefinedVariable, expr.name);
         return false;
     }
+    symbol_table_.Resolve(expr.name, expr.address);
     return true;
 }
 
@@ -224,7 +251,8 @@ inline bool SemanticAnalizer::ProcessExpressionImpl(const ListExpression& expr)
 
 template<>
 inline bool SemanticAnalizer::ProcessExpressionImpl(const FunctionExpression& expr) {
-    symbol_table_.EnterScope();
+    symbol_table_.EnterScope(true);
+    ++functions_;
     bool success = true;
     for (const auto& param : expr.parameters) {
         if (!symbol_table_.Declare(param)) {
@@ -232,26 +260,38 @@ inline bool SemanticAnalizer::ProcessExpressionImpl(const FunctionExpression& ex
             success = false;
         }
     }
+    ReserveAssignedNames(expr.f_body);
     success &= ProcessStatements(expr.f_body);
-    symbol_table_.ExitScope();
+    --functions_;
+    expr.captures = symbol_table_.Captures();
+    expr.scope = symbol_table_.ExitScope();
     return success;
 }
 
 
 template<>
 inline bool SemanticAnalizer::ProcessExpressionImpl(const AssignExpression& expr) {
-    if (!symbol_table_.Exists(expr.name)) {
+    symbol_table_.ResolveAssignment(expr.name, expr.address);
+    if (expr.address.kind == LexicalAddress::Kind::Unresolved) {
         if (!symbol_table_.Declare(expr.name)) {
             ErrorReport(ErrorMsgHandler::kFailingDeclaration, expr.name);
             return false;
         }
+        symbol_table_.Resolve(expr.name, expr.address);
     }
     bool success = ProcessExpression(*expr.rhs);
     if (success) {
         auto rhs_type = GetExpressionType(*expr.rhs);
+        if (expr.operation != TokenType::assign_) {
+            auto it = variable_types_.find(expr.name);
+            auto type = (it != variable_types_.end()) ? it->second : SemanticType::Unknown;
+            auto operation = CompoundBaseOperation(expr.operation);
+            success &= CheckBinaryOperation(operation, type, rhs_type);
+            rhs_type = TypeSystem::GetBinaryResultType(operation, type, rhs_type);
+        }
         variable_types_[expr.name] = rhs_type;
     }
-    return ProcessExpression(*expr.rhs);
+    return success;
 }
 
 
@@ -274,6 +314,22 @@ inline bool SemanticAnalizer::ProcessExpressionImpl(const SliceExpression& expr)
 }
 
 
+template<>
+inline bool SemanticAnalizer::ProcessExpressionImpl(const IndexAssignExpression& expr) {
+    bool success = ProcessExpression(*expr.object);
+    success &= ProcessExpression(*expr.index);
+    success &= ProcessExpression(*expr.rhs);
+    if (success) { success &= CheckIndexAssignExpression(expr); }
+    return success;
+}
+
+
+template<>
+inline bool SemanticAnalizer::ProcessExpressionImpl(const FusedExpression& expr) {
+    return ProcessExpression(*expr.original);
+}
+
+
 template<typename Container>
 inline bool SemanticAnalizer::ProcessStatements(const Container& statements) {
     return std::all_of(statements.begin(), statements.end(),
@@ -3,8 +3,9 @@
 #include <symbols/symb_table.h>
 
 
-void SymbolTable::EnterScope() {
+void SymbolTable::EnterScope(bool function_scope) {
     scopes_.emplace_back();
+    scopes_.back().function_scope = function_scope;
 }
 
 
@@ -18,10 +19,42 @@ constexpr bool SymbolTable::IsEmpty() const noexcept {
 }
 
 
-void SymbolTable::ExitScope() {
+ScopeLayout SymbolTable::ExitScope() {
+    ScopeLayout layout;
     if (!scopes_.empty()) {
+        const auto& scope = scopes_.back();
+        layout.elided = scope.elided;
+        layout.captured = scope.captured;
+        layout.slots = static_cast<std::uint32_t>(scope.slot_count);
+
+        std::size_t index = scopes_.size() - 1;
+        std::erase_if(uses_, [&](const Use& use) {
+            if (use.scope != index) {
+                return false;
+            }
+            if (use.slot < scope.cells.size() && scope.cells[use.slot]) {
+                use.address->kind = LexicalAddress::Kind::Cell;
+            }
+            return true;
+        });
         scopes_.pop_back();
     }
+    return layout;
+}
+
+
+// Called once the names a block assigns are reserved: a block without slots
+// of its own never needs an environment, and addresses computed inside it
+// skip it.
+void SymbolTable::ElideIfEmpty() {
+    if (scopes_.size() > 1 && scopes_.back().slot_count == 0) {
+        scopes_.back().elided = true;
+    }
+}
+
+
+const std::vector<LexicalAddress>& SymbolTable::Captures() const {
+    return scopes_.back().captures;
 }
 
 
@@ -29,17 +62,43 @@ bool SymbolTable::Declare(std::string_view name) {
     if (scopes_.empty()) { EnterScope(); }
 
     auto& current_scope = scopes_.back();
-    auto name_str = std::string(name);
+    auto [it, inserted] = current_scope.symbols.try_emplace(std::string(name));
+    auto& symbol = it->second;
 
-    if (current_scope.contains(name_str)) {
+    if (inserted) {
+        symbol.scope = scopes_.size() - 1;
+        symbol.slot = current_scope.slot_count++;
+    } else if (symbol.declared) {
         return false;
     }
 
-    current_scope[std::move(name_str)] = true;
+    symbol.declared = true;
     return true;
 }
 
 
+// Gives a name assigned somewhere in the current scope its slot up front,
+// without making it visible yet. Functions defined earlier in the scope may
+// assign to it once it exists, which ResolveAssignment accounts for. Names
+// that already refer to an outer variable need no slot here.
+void SymbolTable::Reserve(std::string_view name) {
+    if (scopes_.empty()) { EnterScope(); }
+
+    auto name_str = std::string(name);
+    if (FindAssignable(name_str)) {
+        return;
+    }
+
+    auto& current_scope = scopes_.back();
+    auto [it, inserted] = current_scope.symbols.try_emplace(std::move(name_str));
+
+    if (inserted) {
+        it->second.scope = scopes_.size() - 1;
+        it->second.slot = current_scope.slot_count++;
+    }
+}
+
+
 bool SymbolTable::Exists(std::string_view name) const noexcept {
     auto name_str = std::string(name);
 
@@ -51,7 +110,147 @@ bool SymbolTable::Exists(std::string_view name) const noexcept {
     return std::any_of(scopes_.crbegin(), scopes_.crend(),
                       [&name_str](const auto& scope)
                       {
-                          return scope.contains(name_str);
+                          auto it = scope.symbols.find(name_str);
+                          return it != scope.symbols.end() && it->second.declared;
                       }
     );
 }
+
+
+void SymbolTable::Resolve(std::string_view name, LexicalAddress& address) {
+    auto name_str = std::string(name);
+
+    for (auto scope = scopes_.crbegin(); scope != scopes_.crend(); ++scope) {
+        auto it = scope->symbols.find(name_str);
+        if (it != scope->symbols.end() && it->second.declared) {
+            AddressOf(it->second, address);
+            return;
+        }
+    }
+
+    // A builtin the runtime did not predeclare still gets a global slot;
+    // reading it fails at run time like any unset global.
+    auto& globals = scopes_.front();
+    auto [it, inserted] = globals.symbols.try_emplace(name_str);
+    if (inserted) {
+        it->second.scope = 0;
+        it->second.slot = globals.slot_count++;
+    }
+    AddressOf(it->second, address);
+}
+
+
+// An assignment updates the closest visible binding. Inside a function that
+// also covers names the enclosing scopes only define later: by the time the
+// function runs they exist, so the assignment must not create a local.
+void SymbolTable::ResolveAssignment(std::string_view name, LexicalAddress& address) {
+    auto name_str = std::string(name);
+
+    const Symbol* found = FindAssignable(name_str);
+    if (!found) {
+        address = LexicalAddress{};
+        return;
+    }
+
+    Symbol symbol = *found;
+    Symbol& alias = scopes_.back().symbols[name_str];
+    alias = symbol;
+    alias.declared = true;
+    AddressOf(symbol, address);
+}
+
+
+const SymbolTable::Symbol* SymbolTable::FindAssignable(const std::string& name) const {
+    bool crossed_function = false;
+
+    for (auto scope = scopes_.crbegin(); scope != scopes_.crend(); ++scope) {
+        auto it = scope->symbols.find(name);
+        if (it != scope->symbols.end() && (it->second.declared || crossed_function)) {
+            return &it->second;
+        }
+        crossed_function = crossed_function || scope->function_scope;
+    }
+    return nullptr;
+}
+
+
+// A variable of the current function is a Local until its scope is exited.
+// Reaching one of an enclosing function makes it a cell of its scope: the
+// outermost function in between captures it from the scope the function is
+// created in, and each function further in from the one around it.
+void SymbolTable::AddressOf(const Symbol& symbol, LexicalAddress& address) {
+    auto slot = static_cast<std::uint32_t>(symbol.slot);
+    if (symbol.scope == 0) {
+        address = LexicalAddress{LexicalAddress::Kind::Global, 0, slot};
+        return;
+    }
+
+    std::size_t current = scopes_.size() - 1;
+    std::size_t function = symbol.scope + 1;
+    while (function <= current && !scopes_[function].function_scope) {
+        ++function;
+    }
+    if (function > current) {
+        address = LexicalAddress{LexicalAddress::Kind::Local, Depth(symbol.scope, current), slot};
+        uses_.push_back(Use{&address, symbol.scope, symbol.slot});
+        return;
+    }
+
+    Scope& owner = scopes_[symbol.scope];
+    owner.captured = true;
+    if (owner.cells.size() <= symbol.slot) {
+        owner.cells.resize(symbol.slot + 1);
+    }
+    owner.cells[symbol.slot] = true;
+
+    LexicalAddress captured{LexicalAddress::Kind::Cell, Depth(symbol.scope, function - 1), slot};
+    for (std::size_t i = function; i <= current; ++i) {
+        if (scopes_[i].function_scope) {
+            captured = LexicalAddress{LexicalAddress::Kind::Upvalue, 0, Capture(scopes_[i], captured)};
+        }
+    }
+    address = captured;
+}
+
+
+std::uint32_t SymbolTable::Depth(std::size_t from, std::size_t to) const {
+    std::uint32_t depth = 0;
+    for (std::size_t i = to; i > from; --i) {
+        if (!scopes_[i].elided) {
+            ++depth;
+        }
+    }
+    return depth;
+}
+
+
+// The index of the function's upvalue for the cell at `address`, added on
+// first use.
+std::uint32_t SymbolTable::Capture(Scope& function, const LexicalAddress& address) {
+    auto& captures = function.captures;
+    for (std::size_t i = 0; i < captures.size(); ++i) {
+        if (captures[i].kind == address.kind && captures[i].depth == address.depth
+            && captures[i].slot == address.slot)
+        {
+            return static_cast<std::uint32_t>(i);
+        }
+    }
+    captures.push_back(address);
+    return static_cast<std::uint32_t>(captures.size() - 1);
+}
+
+
+std::vector<std::string> SymbolTable::GlobalNames() const {
+    if (scopes_.empty()) {
+        return {};
+    }
+
+    const auto& globals = scopes_.front();
+    std::vector<std::string> names(globals.slot_count);
+    for (const auto& [name, symbol] : globals.symbols) {
+        if (symbol.scope == 0) {
+            names[symbol.slot] = name;
+        }
+    }
+    return names;
+}
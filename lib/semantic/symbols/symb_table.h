@@ -6,20 +6,73 @@
 #include <unordered_map>
 #include <string_view>
 
+#include <vls_and_sttmnts.h>
 
+
+// Scopes mirror the environments the interpreter creates at run time, so a
+// symbol's position in this table is its lexical address. Parameters and the
+// loop variable of `for` are declared first and occupy the leading slots; the
+// outermost scope's slots index the interpreter's global table.
 class SymbolTable {
 public:
-    void EnterScope();
-    void ExitScope();
+    void EnterScope(bool function_scope = false);
+    // Local addresses of variables a nested function captured are turned
+    // into Cells here, once every use in their scope is known.
+    ScopeLayout ExitScope();
+    void ElideIfEmpty();
+    // What the innermost function captures, as FunctionExpression::captures.
+    const std::vector<LexicalAddress>& Captures() const;
 
     bool Declare(std::string_view);
+    void Reserve(std::string_view);
     bool Exists(std::string_view) const noexcept;
 
+    // Both fill in an address the table may still change until the scope of
+    // the name is exited, so it must not move before then.
+    void Resolve(std::string_view, LexicalAddress&);
+    void ResolveAssignment(std::string_view, LexicalAddress&);
+
+    std::vector<std::string> GlobalNames() const;
+
     constexpr std::size_t ScopeDepth() const noexcept;
     constexpr bool IsEmpty() const noexcept;
 
 private:
-    std::vector<std::unordered_map<std::string, bool>> scopes_;
+    struct Symbol {
+        std::size_t scope;
+        std::size_t slot;
+        bool declared = false;
+    };
+
+    struct Scope {
+        std::unordered_map<std::string, Symbol> symbols;
+        std::size_t slot_count = 0;
+        bool function_scope = false;
+        bool elided = false;
+        bool captured = false;
+        // Slots holding a variable some nested function captures.
+        std::vector<bool> cells;
+        // Of a function scope: the cells its function object takes.
+        std::vector<LexicalAddress> captures;
+    };
+
+    // A Local address handed out for a symbol of `scope`.
+    struct Use {
+        LexicalAddress* address;
+        std::size_t scope;
+        std::size_t slot;
+    };
+
+private:
+    const Symbol* FindAssignable(const std::string&) const;
+    void AddressOf(const Symbol&, LexicalAddress&);
+    // Scopes that exist at run time among those above `from` up to `to`.
+    std::uint32_t Depth(std::size_t from, std::size_t to) const;
+    std::uint32_t Capture(Scope& function, const LexicalAddress&);
+
+private:
+    std::vector<Scope> scopes_;
+    std::vector<Use> uses_;
 
     static constexpr std::array kBuiltinFunctions =
     {
@@ -72,6 +72,9 @@ SemanticType TypeSystem::GetBinaryResultType(TokenType op
             {
                 return SemanticType::String;
             }
+            if (left == SemanticType::List || right == SemanticType::List) {
+                return SemanticType::List;
+            }
             return SemanticType::Number;
 
         case TokenType::star_:
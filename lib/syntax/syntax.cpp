@@ -223,6 +223,11 @@ Expression SyntaxAnalizer::ParseAssignment() {
         Update();
         auto rhs = std::make_unique<Expression>(ParseAssignment());
 
+        if (auto* target = std::get_if<IndexExpression>(&expr.value)) {
+            return Expression{ IndexAssignExpression{std::move(target->object)
+                , std::move(target->index), op, std::move(rhs)} };
+        }
+
         if (!std::holds_alternative<VariableExpression>(expr.value)) {
             throw SyntaxError(current_tkn_
             , SyntaxError::kExpectedIdentifierInFor);
@@ -311,6 +316,7 @@ Expression SyntaxAnalizer::ParseCallable() {
     while (true) {
         switch (current_tkn_.type) {
             case TokenType::l_paren_ : {
+                std::size_t line = current_tkn_.line;
                 Update();
                 std::vector<std::unique_ptr<Expression>> args;
                 if (current_tkn_.type != TokenType::r_paren_) {
@@ -331,7 +337,8 @@ Expression SyntaxAnalizer::ParseCallable() {
                     CallableExpression
                     {
                         std::make_unique<Expression>(std::move(expr)),
-                        std::move(args)
+                        std::move(args),
+                        line
                     }
                 };
                 break;
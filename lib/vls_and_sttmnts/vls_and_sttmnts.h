@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
@@ -11,6 +12,10 @@ struct Expression;
 
 struct Statement;
 
+struct FunctionalObject;
+
+class Value;
+
 struct NilExpression { };
 
 struct BreakStatement { };
@@ -33,9 +38,90 @@ struct BoolExpression {
     bool value;
 };
 
+// Where a name lives at run time, filled in by SemanticAnalizer. Local names
+// are reached by walking `depth` scopes up from the current one and taking
+// `slot` there; for globals `slot` indexes the global table. Scopes are only
+// walked within a function. A local that a nested function captures is a
+// Cell: its slot holds a heap cell shared with the closures. The function
+// that captured it reaches it as an Upvalue, `slot` indexing the cells the
+// function object holds.
+struct LexicalAddress {
+    enum class Kind : std::uint8_t {
+        Unresolved,
+        Local,
+        Global,
+        Cell,
+        Upvalue,
+    };
+
+    Kind kind = Kind::Unresolved;
+    std::uint32_t depth = 0;
+    std::uint32_t slot = 0;
+};
+
+// Run-time shape of a block's scope, filled in by SemanticAnalizer. Elided
+// scopes bind nothing and execute in the enclosing environment; a loop scope
+// no closure captures keeps one environment across iterations.
+struct ScopeLayout {
+    bool elided = false;
+    bool captured = true;
+    std::uint32_t slots = 0;
+};
+
+// Operand types a node has seen, recorded by the tree-walker. A node that
+// keeps seeing the same kinds is quickened: it takes a path specialized for
+// them, guarded by a kind check. A failed guard, or a kind change while the
+// node warms up, leaves it on the generic path for good. Kinds are the
+// values of Value::Kind.
+struct QuickeningSite {
+    enum class State : std::uint8_t {
+        Warming,
+        Quickened,
+        Generic,
+    };
+
+    static constexpr std::uint8_t kWarmup = 8;
+
+    State state = State::Warming;
+    std::uint8_t hits = 0;
+    std::uint8_t left = 0;
+    std::uint8_t right = 0;
+
+    bool Matches(std::uint8_t l, std::uint8_t r) const { return left == l && right == r; }
+
+    void Observe(std::uint8_t l, std::uint8_t r) {
+        if (hits == 0) {
+            left = l;
+            right = r;
+        } else if (!Matches(l, r)) {
+            state = State::Generic;
+            return;
+        }
+        if (++hits == kWarmup) {
+            state = State::Quickened;
+        }
+    }
+};
+
+// The function a call site called last, recorded by the tree-walker. A
+// call whose callee is a variable still holding that object skips
+// evaluating the callee and the checks on it. Holding the object keeps its
+// address from being reused by another function while it is cached.
+// A global callee also leaves the slot it was read from, valid while the
+// global table's version is still `version`.
+struct CallSiteCache {
+    std::shared_ptr<FunctionalObject> function;
+    const Value* slot = nullptr;
+    std::size_t version = 0;
+    bool native = false;
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+};
+
 struct VariableExpression {
     VariableExpression(const std::string&);
     std::string name;
+    mutable LexicalAddress address;
 };
 
 struct UnaryExpression {
@@ -47,31 +133,45 @@ struct BinaryExpression {
     std::unique_ptr<Expression> lhs;
     TokenType operation;
     std::unique_ptr<Expression> rhs;
+    mutable QuickeningSite site{};
 };
 
 struct CallableExpression {
     std::unique_ptr<Expression> callable;
     std::vector<std::unique_ptr<Expression>> f_arguments;
+    // Source line of the opening parenthesis, for stack traces.
+    std::size_t line = 0;
+    mutable CallSiteCache cache{};
 };
 
 struct ListExpression {
     std::vector<std::unique_ptr<Expression>> elements;
+    // Cleared by EscapeAnalysis when the list can never outlive the call
+    // that creates it.
+    mutable bool escapes = true;
 };
 
 struct FunctionExpression {
     std::vector<std::string> parameters;
     std::vector<Statement> f_body;
+    mutable ScopeLayout scope{};
+    // The cells a function object takes when the expression creates it, in
+    // the order of its upvalues: Cells of the scope the expression runs in
+    // or the enclosing function's own Upvalues.
+    mutable std::vector<LexicalAddress> captures{};
 };
 
 struct AssignExpression {
     std::string name;
     TokenType operation;
     std::unique_ptr<Expression> rhs;
+    mutable LexicalAddress address{};
 };
 
 struct IndexExpression {
     std::unique_ptr<Expression> object;
     std::unique_ptr<Expression> index;
+    mutable QuickeningSite site{};
 };
 
 struct SliceExpression {
@@ -80,6 +180,38 @@ struct SliceExpression {
     std::unique_ptr<Expression> to_s;
 };
 
+struct IndexAssignExpression {
+    std::unique_ptr<Expression> object;
+    std::unique_ptr<Expression> index;
+    TokenType operation;
+    std::unique_ptr<Expression> rhs;
+};
+
+// An idiom the tree-walker runs in one step, put in place of the subtree it
+// replaces by FusionPass once names are resolved. Operands are variables,
+// except that one of `lhs` and `rhs` may be the number `constant`, marked
+// by an unresolved address. Passes that do not know fused nodes use
+// `original`, which is also what runs when the operands are not numbers
+// (or, for Index, a list). `hits` and `misses` count both outcomes.
+struct FusedExpression {
+    enum class Kind : std::uint8_t {
+        Increment,      // target = target +/- constant, target +/-= constant
+        Compare,        // lhs < rhs and every other comparison
+        Index,          // lhs[rhs]
+        AssignBinary,   // target = lhs op rhs, for an arithmetic op
+    };
+
+    Kind kind;
+    TokenType operation;
+    LexicalAddress target;
+    LexicalAddress lhs;
+    LexicalAddress rhs;
+    double constant = 0;
+    std::unique_ptr<Expression> original = nullptr;
+    mutable std::uint64_t hits = 0;
+    mutable std::uint64_t misses = 0;
+};
+
 using ExpressionVariant = std::variant
 <
     NumberExpression, StringExpression
@@ -88,7 +220,8 @@ using ExpressionVariant = std::variant
     , BinaryExpression, CallableExpression
     , ListExpression, FunctionExpression
     , AssignExpression, IndexExpression
-    , SliceExpression
+    , SliceExpression, IndexAssignExpression
+    , FusedExpression
 >;
 
 struct Expression {
@@ -108,25 +241,33 @@ struct IfStatement {
     Expression condition;
     std::vector<Statement> then_case;
     std::vector<Statement> else_case;
+    mutable ScopeLayout then_scope{};
+    mutable ScopeLayout else_scope{};
 };
 
 struct WhileStatement {
     Expression condition;
     std::vector<Statement> body;
+    mutable ScopeLayout body_scope{};
 };
 
 struct ForStatement {
     std::string var;
     Expression iter;
     std::vector<Statement> body;
+    mutable ScopeLayout body_scope{};
 };
 
 struct ReturnStatement {
     std::unique_ptr<Expression> value;
+    // Set by SemanticAnalizer when the value is a call inside a function,
+    // whose callee may run in place of the returning function's frame.
+    mutable bool tail_call = false;
 };
 
 struct BlockStatement {
     std::vector<Statement> statements;
+    mutable ScopeLayout scope{};
 };
 
 using StatementVariant = std::variant
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <tests/engine.h>
+#include <runtime/aot/aot.h>
+
+class AotTest : public ::testing::Test {
+protected:
+    std::string emitted(const std::string& code) {
+        std::istringstream input(code);
+        std::ostringstream cpp;
+        if (AotCompiler::Emit(input, cpp)) {
+            return cpp.str();
+        }
+        return "";
+    }
+
+    // Compiles the program, runs it and returns its stdout and exit status.
+    // The pid keeps test processes running side by side apart.
+    std::pair<std::string, int> compiled_run(const std::string& code, const std::string& name) {
+        std::filesystem::path executable = std::filesystem::temp_directory_path()
+                                        / (name + "_" + std::to_string(getpid()));
+        std::istringstream input(code);
+        if (!AotCompiler::Build(input, executable)) {
+            return {"", -1};
+        }
+
+        std::string output;
+        FILE* pipe = popen(("'" + executable.string() + "' 2>/dev/null").c_str(), "r");
+        char buffer[256];
+        while (std::size_t read = std::fread(buffer, 1, sizeof(buffer), pipe)) {
+            output.append(buffer, read);
+        }
+        int status = pclose(pipe);
+
+        std::filesystem::remove(executable);
+        std::filesystem::remove(executable.string() + ".cpp");
+        return {output, status};
+    }
+};
+
+TEST_F(AotTest, EmitsTranslationUnit) {
+    std::string cpp = emitted(R"(
+        square = function(x) return x * x end function
+        println(square(4))
+    )");
+    EXPECT_NE(cpp.find("Value Function0(const AotRuntime::Upvalues& upvalues, FunctionalObject::Arguments args)"), std::string::npos);
+    EXPECT_NE(cpp.find("void Main(Enviroment& top_level)"), std::string::npos);
+    EXPECT_NE(cpp.find("int main()"), std::string::npos);
+}
+
+TEST_F(AotTest, RejectsInvalidPrograms) {
+    EXPECT_EQ(emitted("x = \"a\" - \"b\""), "");
+    EXPECT_EQ(emitted("if then"), "");
+}
+
+TEST_F(AotTest, CompiledProgramMatchesTreeWalker) {
+    std::string code = R"(
+        fib = function(n)
+            if n < 2 then return n end if
+            return fib(n - 1) + fib(n - 2)
+        end function
+
+        sum_to = function(n)
+            total = 0
+            add = function(v) total += v end function
+            for i in range(n) add(i) end for
+            return total
+        end function
+
+        counter = function()
+            n = 0
+            return function() n += 1 return n end function
+        end function
+        tick = counter()
+        tick()
+
+        xs = [1, 2, 3, "a\"b"]
+        xs[0] += 10
+        xs[1] = xs[1] * 3
+        s = "hello world"
+        k = 0
+        odd = ""
+        while k < 10 and not (k == 7)
+            k += 1
+            if k % 2 == 0 then continue end if
+            odd += to_string(k)
+        end while
+
+        println(fib(15))
+        println(sum_to(5))
+        println(tick())
+        grown = range(2)
+        for g in grown
+            if g == 0 then push(grown, 5) end if
+            println(g)
+        end for
+        println(join([xs[0], xs[1], len(xs)], ","))
+        println(s[1:4] + s[8:])
+        println(odd)
+        println(nil or "default")
+        println(1 / 3)
+    )";
+    std::string expected = tree_output(code);
+    ASSERT_FALSE(expected.empty());
+
+    auto [output, status] = compiled_run(code, "itmoscript_aot_matches");
+    EXPECT_EQ(status, 0);
+    EXPECT_EQ(output, expected + "\n");
+}
+
+TEST_F(AotTest, CompiledProgramReportsErrors) {
+    auto [output, status] = compiled_run(R"(
+        println("before")
+        xs = [1]
+        println(xs[5])
+    )", "itmoscript_aot_errors");
+    EXPECT_EQ(output, "before\n");
+    EXPECT_NE(status, 0);
+}
+
+TEST_F(AotTest, PathsAreNotInterpretedByAShell) {
+    std::filesystem::path marker = "itmoscript_aot_injected_" + std::to_string(getpid());
+    auto [output, status] = compiled_run("println(1)", "itmoscript_aot_$(touch " + marker.string() + ")");
+    EXPECT_EQ(output, "1\n\n");
+    EXPECT_EQ(status, 0);
+    EXPECT_FALSE(std::filesystem::exists(marker));
+    std::filesystem::remove(marker);
+}
+
+TEST_F(AotTest, DeepRecursionFailsWithStackOverflow) {
+    std::string code = R"(
+        g = function(n)
+            if n == 0 then return 0 end if
+            return g(n - 1) + 1
+        end function
+    )";
+    auto [output, status] = compiled_run(code + "println(g(100000))", "itmoscript_aot_deep");
+    EXPECT_EQ(output, "100000\n\n");
+    EXPECT_EQ(status, 0);
+
+    std::tie(output, status) = compiled_run(code + "println(g(1000000))", "itmoscript_aot_overflow");
+    EXPECT_EQ(output, "");
+    EXPECT_EQ(WIFEXITED(status) ? WEXITSTATUS(status) : -1, 1);
+}
@@ -1,19 +1,20 @@
 #include <gtest/gtest.h>
 #include <sstream>
 #include <runtime/interpreter/interpreter.h>
+#include <tests/engine.h>
 
 class TypesAndBuiltinsTest : public ::testing::Test {
 protected:
     bool interpret(const std::string& code) {
         std::istringstream input(code);
         std::ostringstream output;
-        return Interpreter::Interpret(input, output);
+        return RunScript(input, output);
     }
 
     std::string interpret_with_output(const std::string& code) {
         std::istringstream input(code);
         std::ostringstream output;
-        if (Interpreter::Interpret(input, output)) {
+        if (RunScript(input, output)) {
             return output.str();
         }
         return "";
@@ -121,6 +122,88 @@ TEST_F(TypesAndBuiltinsTest, RangeFunction) {
     EXPECT_EQ(interpret_with_output(code), "504627508");
 }
 
+TEST_F(TypesAndBuiltinsTest, LazyRange) {
+    std::string code = R"(
+        r = range(0, 1000000000, 3)
+        print(len(r))
+        print(r[-1])
+        print(type(r))
+
+        s = r[10:13]
+        print(len(s))
+        print(s[0])
+
+        down = range(10, 0, -2)
+        print(down[1:][0])
+
+        total = 0
+        for i in range(0, 1000000000)
+            if i == 5 then
+                break
+            end if
+            total = total + i
+        end for
+        print(total)
+    )";
+
+    EXPECT_EQ(interpret_with_output(code), "333333334999999999array330810");
+}
+
+TEST_F(TypesAndBuiltinsTest, RangeRejectsBoundsWithTooManyElements) {
+    EXPECT_FALSE(interpret("r = range(0, 1 / 0)"));
+    EXPECT_FALSE(interpret("r = range(0, 1e300, 1e-300)"));
+    EXPECT_FALSE(interpret("r = range(0, 0 / 0)"));
+    EXPECT_EQ(interpret_with_output("print(len(range(0, 1e15)))"), "1000000000000000");
+}
+
+TEST_F(TypesAndBuiltinsTest, RangeMaterializesOnMutation) {
+    std::string code = R"(
+        r = range(3)
+        alias = r
+        push(r, 10)
+        print(len(alias))
+        print(alias[3])
+        print(join(range(3), ","))
+        print(pop(range(1, 4)))
+    )";
+
+    EXPECT_EQ(interpret_with_output(code), "4100,1,23");
+}
+
+TEST_F(TypesAndBuiltinsTest, ForLoopSeesRangeGrownByItsBody) {
+    std::string code = R"(
+        r = range(3)
+        for i in r
+            print(i)
+            if i == 0 then push(r, 7) end if
+        end for
+    )";
+
+    EXPECT_EQ(interpret_with_output(code), "0127");
+}
+
+TEST_F(TypesAndBuiltinsTest, ListBuiltinsMutateInPlace) {
+    std::string code = R"(
+        xs = [3, 1, 2]
+        ys = xs
+        print(pop(xs))
+        print(len(ys))
+
+        push(ys, 5)
+        insert(xs, 0, 4)
+        print(join(xs, ","))
+
+        print(remove(ys, 1))
+        sort(xs)
+        print(join(ys, ","))
+
+        zs = push(push(xs, 6), 7)
+        print(len(xs))
+    )";
+
+    EXPECT_EQ(interpret_with_output(code), "224,3,1,531,4,55");
+}
+
 TEST_F(TypesAndBuiltinsTest, TypeConversion) {
     std::string code = R"(
         num = 42
@@ -207,13 +290,13 @@ protected:
     bool interpret(const std::string& code) {
         std::istringstream input(code);
         std::ostringstream output;
-        return Interpreter::Interpret(input, output);
+        return RunScript(input, output);
     }
 
     std::string interpret_with_output(const std::string& code) {
         std::istringstream input(code);
         std::ostringstream output;
-        if (Interpreter::Interpret(input, output)) {
+        if (RunScript(input, output)) {
             return output.str();
         }
         return "";
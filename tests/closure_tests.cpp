@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <tests/engine.h>
+
+TEST(ClosureEngineTest, MatchesTreeWalker) {
+    std::string code = R"(
+        fib = function(n)
+            if n < 2 then return n end if
+            return fib(n - 1) + fib(n - 2)
+        end function
+
+        bump_twice = function(count)
+            bump = function(by)
+                count += by
+            end function
+            bump(1)
+            bump(2)
+            return count
+        end function
+
+        xs = []
+        for i in range(10)
+            if i % 3 == 0 then continue end if
+            if i > 7 and not (i == 9) then break end if
+            push(xs, i * i)
+        end for
+        xs[0] -= 1
+
+        s = ""
+        k = 0
+        while k < 4 or s == ""
+            s += "ab"[k % 2]
+            k = k + 1
+        end while
+
+        println(fib(15))
+        println(bump_twice(7))
+        println(join(xs, ","))
+        println(s[1:3])
+        println(-k)
+        print(nil == nil and "b" > "a")
+    )";
+
+    EXPECT_EQ(closure_output(code), tree_output(code));
+    EXPECT_EQ(closure_output(code), "610\n10\n0,4,16,25,49\nba\n-4\ntrue");
+}
+
+TEST(ClosureEngineTest, ReportsRuntimeErrors) {
+    EXPECT_EQ(closure_output("x = 1\nx()"), "");
+    EXPECT_EQ(closure_output("xs = [1]\nprint(xs[3])"), "");
+    EXPECT_EQ(closure_output("f = function()\n  z = z + 1\nend function\nf()"), "");
+    EXPECT_EQ(closure_output("for c in 5\nend for"), "");
+}
+
+TEST(ClosureEngineTest, CallsDeeperThanTheLimitFailWithStackOverflow) {
+    std::string code = R"(
+        count = function(n)
+            if n == 0 then return 0 end if
+            return count(n - 1) + 1
+        end function
+    )";
+    auto run = [&](std::string n, std::size_t max_depth) {
+        std::istringstream input(code + "println(count(" + n + "))");
+        std::ostringstream output;
+        return ClosureEngine::Interpret(input, output, max_depth);
+    };
+    EXPECT_TRUE(run("99", 100));
+    EXPECT_FALSE(run("100", 100));
+    EXPECT_TRUE(run("100000", kDefaultMaxCallDepth));
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include <runtime/interpreter/interpreter.h>
+#include <runtime/closure/closure.h>
+
+
+// The suite is built once per engine: ITMO_TEST_CLOSURE_ENGINE runs every
+// script on the closure-compiled backend instead of the tree-walker.
+inline bool RunScript(std::istream& in, std::ostream& out) {
+#ifdef ITMO_TEST_CLOSURE_ENGINE
+    return ClosureEngine::Interpret(in, out);
+#else
+    return Interpreter::Interpret(in, out);
+#endif
+}
+
+
+// What a program prints on the tree-walker, the reference the other
+// engines are compared with; empty if it fails.
+inline std::string tree_output(const std::string& code) {
+    std::istringstream input(code);
+    std::ostringstream output;
+    if (Interpreter::Interpret(input, output)) {
+        return output.str();
+    }
+    return "";
+}
+
+
+// The same on the closure engine.
+inline std::string closure_output(const std::string& code) {
+    std::istringstream input(code);
+    std::ostringstream output;
+    if (ClosureEngine::Interpret(input, output)) {
+        return output.str();
+    }
+    return "";
+}
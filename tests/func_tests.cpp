@@ -1,19 +1,20 @@
 #include <gtest/gtest.h>
 #include <sstream>
 #include <runtime/interpreter/interpreter.h>
+#include <tests/engine.h>
 
 class CompleteBuiltinFunctionsTest : public ::testing::Test {
 protected:
     bool interpret(const std::string& code) {
         std::istringstream input(code);
         std::ostringstream output;
-        return Interpreter::Interpret(input, output);
+        return RunScript(input, output);
     }
 
     std::string interpret_with_output(const std::string& code) {
         std::istringstream input(code);
         std::ostringstream output;
-        if (Interpreter::Interpret(input, output)) {
+        if (RunScript(input, output)) {
             return output.str();
         }
         return "";
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include <runtime/interpreter/interpreter.h>
+#include <tests/engine.h>
 
 
 TEST(FunctionTestSuite, SimpleFunctionTest) {
@@ -18,7 +19,7 @@ TEST(FunctionTestSuite, SimpleFunctionTest) {
     std::istringstream input(code);
     std::ostringstream output;
 
-    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    ASSERT_TRUE(RunScript(input, output));
     ASSERT_EQ(output.str(), expected);
 }
 
@@ -41,7 +42,7 @@ TEST(FunctionTestSuite, FunctionAsArgTest) {
     std::istringstream input(code);
     std::ostringstream output;
 
-    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    ASSERT_TRUE(RunScript(input, output));
     ASSERT_EQ(output.str(), expected);
 }
 
@@ -63,7 +64,7 @@ TEST(FunctionTestSuite, NestedFunctionTest) {
     std::istringstream input(code);
     std::ostringstream output;
 
-    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    ASSERT_TRUE(RunScript(input, output));
     ASSERT_EQ(output.str(), expected);
 }
 
@@ -85,6 +86,111 @@ TEST(FunctionTestSuite, FunnySyntaxTest) {
     std::istringstream input(code);
     std::ostringstream output;
 
-    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    ASSERT_TRUE(RunScript(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(FunctionTestSuite, ClosureOutlivesItsFunctionTest) {
+    std::string code = R"(
+        make = function(start)
+            count = start
+            step = function() count = count + 1 return count end function
+            return step
+        end function
+
+        a = make(10)
+        b = make(100)
+        print(a())
+        print(a())
+        print(b())
+    )";
+
+    std::string expected = "1112101";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(RunScript(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(FunctionTestSuite, ClosuresShareCapturedVariableTest) {
+    std::string code = R"(
+        pair = function()
+            n = 0
+            inc = function() n += 1 end function
+            get = function() return n end function
+            inc()
+            inc()
+            return [inc, get]
+        end function
+
+        p = pair()
+        p[0]()
+        print(p[1]())
+    )";
+
+    std::string expected = "3";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(RunScript(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(FunctionTestSuite, ListsConfinedToTheCallTest) {
+    std::string code = R"(
+        spread = function(a, b)
+            d = [a - b, b - a, a * b]
+            s = 0
+            for x in d
+                s = s + x
+            end for
+            head = d[0:2]
+            return s + len(head) + [10, 20][1]
+        end function
+
+        keep = function(a)
+            k = [a, a]
+            return k
+        end function
+
+        total = 0
+        kept = []
+        for i in range(1000)
+            total = total + spread(i, 2)
+            kept = kept + keep(i)
+        end for
+        print(total)
+        print(len(kept))
+        print(kept[1998])
+    )";
+
+    std::string expected = "10210002000999";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(RunScript(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+TEST(FunctionTestSuite, TailCallMeasuresConfinedListTest) {
+    std::string code = R"(
+        measure = function(a)
+            local = [a, a, a]
+            return len(local)
+        end function
+        print(measure(1))
+        print(measure(2) + measure(3))
+    )";
+
+    std::string expected = "36";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(RunScript(input, output));
     ASSERT_EQ(output.str(), expected);
 }
@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 
 #include <runtime/interpreter/interpreter.h>
+#include <tests/engine.h>
 
 
 std::string kUnreachable = "239";
@@ -27,7 +28,7 @@ TEST(IllegalOperationsSuite, TypeMixing) {
 
             std::ostringstream output;
 
-            ASSERT_FALSE(Interpreter::Interpret(input, output));
+            ASSERT_FALSE(RunScript(input, output));
             ASSERT_FALSE(output.str().ends_with(kUnreachable));
         }
     }
@@ -46,6 +47,6 @@ TEST(IllegalOperationsSuite, ArgumentCountMismatch) {
     std::istringstream input(code);
     std::ostringstream output;
 
-    ASSERT_FALSE(Interpreter::Interpret(input, output));
+    ASSERT_FALSE(RunScript(input, output));
     ASSERT_FALSE(output.str().ends_with(kUnreachable));
 }
@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <tests/engine.h>
+#include <runtime/jit/jit.h>
+
+class JitTest : public ::testing::Test {
+protected:
+    // The function literal assigned by the first statement of `code`, with
+    // `range` and `print` as the only predefined globals.
+    const FunctionExpression& parse_function(const std::string& code) {
+        std::istringstream input(code);
+        SyntaxAnalizer parser(input);
+        programs_.push_back(parser.Parse());
+        std::ostringstream errors;
+        EXPECT_TRUE(SemanticAnalizer(errors, {"range", "print"}).Analyse(programs_.back()));
+        const auto& stmt = std::get<ExpressionStatement>(programs_.back()[0].value);
+        const auto& assign = std::get<AssignExpression>(stmt.expression.value);
+        return std::get<FunctionExpression>(assign.rhs->value);
+    }
+
+private:
+    std::vector<std::vector<Statement>> programs_;
+};
+
+TEST_F(JitTest, CompilesNumericFunction) {
+    const auto& literal = parse_function(R"(
+        poly = function(x, y)
+            s = 0
+            for i in range(3)
+                s += x * i
+            end for
+            if s >= 0 and not (y == 0) then return s + y end if
+            return -s % 4
+        end function
+    )");
+    FunctionalObject fn(literal.parameters, &literal.f_body, {});
+    GlobalTable globals;
+    globals.Define("range", Value(std::make_shared<FunctionalObject>(
+        FunctionalObject::NativeFn([](FunctionalObject::Arguments) { return Value(NilType{}); }))));
+
+    auto jit = JitFunction::Compile(fn, globals);
+    ASSERT_NE(jit, nullptr);
+
+    auto result = jit->Call(std::vector<Value>{Value(2.0), Value(1.0)}, globals, kDefaultMaxCallDepth);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->AsNumber(), 7);
+
+    result = jit->Call(std::vector<Value>{Value(-3.0), Value(0.0)}, globals, kDefaultMaxCallDepth);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->AsNumber(), 1);
+
+    EXPECT_FALSE(jit->Call(std::vector<Value>{Value(2.0), Value(NilType{})}, globals, kDefaultMaxCallDepth).has_value());
+    EXPECT_FALSE(jit->Call(std::vector<Value>{Value(2.0)}, globals, kDefaultMaxCallDepth).has_value());
+}
+
+TEST_F(JitTest, RejectsUnsupportedBodies) {
+    GlobalTable globals;
+    globals.Bind("range");
+    globals.Bind("print");
+
+    const auto& prints = parse_function(R"(
+        f = function(x)
+            print(x)
+            return x
+        end function
+    )");
+    FunctionalObject printing(prints.parameters, &prints.f_body, {});
+    EXPECT_EQ(JitFunction::Compile(printing, globals), nullptr);
+
+    const auto& lists = parse_function(R"(
+        g = function(x)
+            xs = [x]
+            return x
+        end function
+    )");
+    FunctionalObject listing(lists.parameters, &lists.f_body, {});
+    EXPECT_EQ(JitFunction::Compile(listing, globals), nullptr);
+}
+
+TEST_F(JitTest, HotFunctionsMatchClosureEngine) {
+    std::string code = R"(
+        fib = function(n)
+            if n < 2 then return n end if
+            return fib(n - 1) + fib(n - 2)
+        end function
+
+        kernel = function(n)
+            s = 0
+            for i in range(n)
+                j = 0
+                while j < 10
+                    if i % 2 == 0 and not (j == 3) then
+                        s += i * j
+                    else
+                        s -= 1
+                    end if
+                    j += 1
+                    if j > 7 then continue end if
+                end while
+                if s > 100000 then break end if
+            end for
+            return s / 2 ^ 2
+        end function
+
+        total = 0
+        for t in range(40)
+            total += kernel(t) + fib(t % 12)
+        end for
+        println(fib(20))
+        println(total)
+        println(kernel(3.5))
+    )";
+    std::string expected = closure_output(code);
+    ASSERT_FALSE(expected.empty());
+    EXPECT_EQ(tree_output(code), expected);
+}
+
+TEST_F(JitTest, TailRecursionRunsAsLoop) {
+    std::string code = R"(
+        sum = function(n, acc)
+            if n == 0 then return acc end if
+            return sum(n - 1, acc + n)
+        end function
+        for i in range(20)
+            sum(i, 0)
+        end for
+        println(sum(1000000, 0))
+    )";
+    EXPECT_EQ(tree_output(code), "500000500000\n");
+}
+
+TEST_F(JitTest, CompiledRecursionStopsAtTheDepthLimit) {
+    std::string code = R"(
+        depth = function(n)
+            if n == 0 then return 0 end if
+            return depth(n - 1) + 1
+        end function
+        for i in range(20)
+            depth(i)
+        end for
+    )";
+    auto run = [&](std::string n) {
+        std::istringstream input(code + "println(depth(" + n + "))");
+        std::ostringstream output;
+        return Interpreter::Interpret(input, output, nullptr, nullptr, 1000);
+    };
+    EXPECT_TRUE(run("999"));
+    EXPECT_FALSE(run("1000"));
+}
+
+TEST_F(JitTest, GuardsFallBackToInterpreter) {
+    std::string code = R"(
+        double = function(x) return x * 2 end function
+        positive = function(x) if x > 0 then return x end if end function
+        r = 0
+        for t in range(20)
+            r = double(t) + positive(t + 1)
+        end for
+        println(r)
+        println(double("ab"))
+        println(positive(-1))
+
+        fact = function(n)
+            if n <= 1 then return 1 end if
+            return n * fact(n - 1)
+        end function
+        for t in range(20)
+            r = fact(5)
+        end for
+        println(r)
+        other = fact
+        fact = function(n) return 0 end function
+        println(other(5))
+    )";
+    EXPECT_EQ(tree_output(code), "58\nabab\nnil\n120\n0\n");
+}
+
+TEST_F(JitTest, ReportsErrorsFromCompiledFunctions) {
+    std::string code = R"(
+        steps = function(n, step)
+            s = 0
+            for i in range(0, n, step)
+                s += i
+            end for
+            return s
+        end function
+        for t in range(20)
+            steps(t, 1)
+        end for
+        println(steps(4, 1))
+        steps(3, 0)
+    )";
+    EXPECT_EQ(tree_output(code), "");
+}
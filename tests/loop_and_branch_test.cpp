@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include <runtime/interpreter/interpreter.h>
+#include <tests/engine.h>
 
 
 TEST(BranchTestSuite, SimpleIfTest) {
@@ -16,7 +17,7 @@ TEST(BranchTestSuite, SimpleIfTest) {
     std::istringstream input(code);
     std::ostringstream output;
 
-    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    ASSERT_TRUE(RunScript(input, output));
     ASSERT_EQ(output.str(), expected);
 }
 
@@ -35,7 +36,7 @@ TEST(BranchTestSuite, SimpleElseIfTest) {
     std::istringstream input(code);
     std::ostringstream output;
 
-    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    ASSERT_TRUE(RunScript(input, output));
     ASSERT_EQ(output.str(), expected);
 }
 
@@ -59,7 +60,7 @@ TEST(BranchTestSuite, ComplexIfTest) {
     std::istringstream input(code);
     std::ostringstream output;
 
-    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    ASSERT_TRUE(RunScript(input, output));
     ASSERT_EQ(output.str(), expected);
 }
 
@@ -71,7 +72,7 @@ TEST(BranchTestSuite, OneLineIfTest) {
     std::istringstream input(code);
     std::ostringstream output;
 
-    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    ASSERT_TRUE(RunScript(input, output));
     ASSERT_EQ(output.str(), expected);
 }
 
@@ -88,7 +89,7 @@ TEST(LoopTestSuit, ForLoop) {
     std::istringstream input(code);
     std::ostringstream output;
 
-    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    ASSERT_TRUE(RunScript(input, output));
     ASSERT_EQ(output.str(), expected);
 }
 
@@ -107,6 +108,71 @@ TEST(LoopTestSuit, WhileLoop) {
     std::istringstream input(code);
     std::ostringstream output;
 
-    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    ASSERT_TRUE(RunScript(input, output));
     ASSERT_EQ(output.str(), expected);
 }
+
+
+TEST(LoopTestSuit, ReturnFromNestedLoops) {
+    std::string code = R"(
+        find = function(target)
+            for i in range(10)
+                j = 0
+                while j < 10
+                    if i * 10 + j == target then
+                        return i * 100 + j
+                    end if
+                    j = j + 1
+                end while
+            end for
+            return nil
+        end function
+        print(find(42))
+        print(find(1000))
+    )";
+
+    std::string expected = "402nil";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(RunScript(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+
+TEST(LoopTestSuit, BreakOnlyLeavesInnermostLoop) {
+    std::string code = R"(
+        count = 0
+        for i in range(3)
+            for j in range(100)
+                if j == 2 then
+                    break
+                end if
+                count = count + 1
+            end for
+        end for
+        print(count)
+    )";
+
+    std::string expected = "6";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_TRUE(RunScript(input, output));
+    ASSERT_EQ(output.str(), expected);
+}
+
+
+TEST(LoopTestSuit, BreakOutsideLoopFails) {
+    std::string code = R"(
+        print(1)
+        break
+    )";
+
+    std::istringstream input(code);
+    std::ostringstream output;
+
+    ASSERT_FALSE(RunScript(input, output));
+}
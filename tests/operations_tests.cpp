@@ -7,9 +7,7 @@
 
 class OperationHandlersTest : public ::testing::Test {
 protected:
-    void SetUp() override {
-        Initialize();
-    }
+    void SetUp() override {}
 };
 
 TEST_F(OperationHandlersTest, AsNumber) {
@@ -100,45 +98,51 @@ TEST_F(OperationHandlersTest, UnaryOperations) {
     EXPECT_TRUE(result3.AsBool());
 }
 
-class OperationRegistryTest : public ::testing::Test {
-protected:
-    void SetUp() override {
-        Initialize();
-        registry = &OperationRegistry::Get();
-    }
-
-    OperationRegistry* registry;
-};
-
-TEST_F(OperationRegistryTest, BinaryOperationSupport) {
-    EXPECT_TRUE(registry->SupportsBinary(TokenType::plus_));
-    EXPECT_TRUE(registry->SupportsBinary(TokenType::minus_));
-    EXPECT_TRUE(registry->SupportsBinary(TokenType::star_));
-    EXPECT_TRUE(registry->SupportsBinary(TokenType::slash_));
-    EXPECT_FALSE(registry->SupportsBinary(TokenType::identifier_));
+TEST(OperationRegistryTest, BinaryOperationSupport) {
+    EXPECT_TRUE(OperationRegistry::SupportsBinary(TokenType::plus_));
+    EXPECT_TRUE(OperationRegistry::SupportsBinary(TokenType::minus_));
+    EXPECT_TRUE(OperationRegistry::SupportsBinary(TokenType::star_));
+    EXPECT_TRUE(OperationRegistry::SupportsBinary(TokenType::slash_));
+    EXPECT_FALSE(OperationRegistry::SupportsBinary(TokenType::identifier_));
 }
 
-TEST_F(OperationRegistryTest, UnaryOperationSupport) {
-    EXPECT_TRUE(registry->SupportsUnary(TokenType::minus_));
-    EXPECT_TRUE(registry->SupportsUnary(TokenType::not_));
-    EXPECT_FALSE(registry->SupportsUnary(TokenType::plus_));
+TEST(OperationRegistryTest, UnaryOperationSupport) {
+    EXPECT_TRUE(OperationRegistry::SupportsUnary(TokenType::minus_));
+    EXPECT_TRUE(OperationRegistry::SupportsUnary(TokenType::not_));
+    EXPECT_FALSE(OperationRegistry::SupportsUnary(TokenType::plus_));
 }
 
-TEST_F(OperationRegistryTest, ExecuteBinaryOperations) {
-    Value result = registry->ExecuteBinary(TokenType::plus_, Value(3.0), Value(5.0));
+TEST(OperationRegistryTest, ExecuteBinaryOperations) {
+    Value result = OperationRegistry::ExecuteBinary(TokenType::plus_, Value(3.0), Value(5.0));
     EXPECT_TRUE(result.IsNumber());
     EXPECT_EQ(result.AsNumber(), 8.0);
 }
 
-TEST_F(OperationRegistryTest, ExecuteUnaryOperations) {
-    Value result = registry->ExecuteUnary(TokenType::minus_, Value(5.0));
+TEST(OperationRegistryTest, ExecuteUnaryOperations) {
+    Value result = OperationRegistry::ExecuteUnary(TokenType::minus_, Value(5.0));
     EXPECT_TRUE(result.IsNumber());
     EXPECT_EQ(result.AsNumber(), -5.0);
 }
 
-TEST_F(OperationRegistryTest, UnsupportedOperations) {
-    EXPECT_THROW(registry->ExecuteBinary(TokenType::identifier_, Value(1.0), Value(2.0)),
+TEST(OperationRegistryTest, UnsupportedOperations) {
+    EXPECT_THROW(OperationRegistry::ExecuteBinary(TokenType::identifier_, Value(1.0), Value(2.0)),
                  EvaluatorErrors);
-    EXPECT_THROW(registry->ExecuteUnary(TokenType::plus_, Value(5.0)),
+    EXPECT_THROW(OperationRegistry::ExecuteUnary(TokenType::plus_, Value(5.0)),
                  EvaluatorErrors);
 }
+
+TEST(OperationRegistryTest, DispatchesOnOperandKinds) {
+    EXPECT_EQ(OperationRegistry::Binary(BinaryOp::Add, Value(true), Value(2.0)).AsNumber(), 3.0);
+    EXPECT_EQ(OperationRegistry::Binary(BinaryOp::Mul, Value(2.0), Value("ab")).AsString(), "abab");
+    EXPECT_EQ(OperationRegistry::Binary(BinaryOp::Mul, Value("ab"), Value(-1.0)).AsString(), "");
+    EXPECT_TRUE(OperationRegistry::Binary(BinaryOp::Lt, Value("a"), Value("b")).AsBool());
+    EXPECT_FALSE(OperationRegistry::Binary(BinaryOp::Gt, Value(1.0), Value(true)).AsBool());
+    EXPECT_EQ(OperationRegistry::Binary(BinaryOp::Add, Value(Value::Array{Value(1.0)})
+                                      , Value(Range(0, 2, 1))).AsList().size(), 3);
+    EXPECT_TRUE(OperationRegistry::Unary(UnaryOp::Not, Value(Value::Array{})).IsBool());
+
+    EXPECT_THROW(OperationRegistry::Binary(BinaryOp::Add, Value("a"), Value(1.0)), EvaluatorErrors);
+    EXPECT_THROW(OperationRegistry::Binary(BinaryOp::Div, Value("a"), Value("b")), EvaluatorErrors);
+    EXPECT_THROW(OperationRegistry::Binary(BinaryOp::Lt, Value(NilType{}), Value(1.0)), EvaluatorErrors);
+    EXPECT_THROW(OperationRegistry::Unary(UnaryOp::Neg, Value("a")), EvaluatorErrors);
+}
@@ -1,22 +1,28 @@
 #include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
 #include <sstream>
+#include <utility>
 
 #include <runtime/interpreter/interpreter.h>
+#include <tests/engine.h>
 #include <runtime/value/value.h>
 #include <runtime/enviroment/enviroment.h>
+#include <runtime/enviroment/global_table.h>
+#include <runtime/enviroment/value_stack.h>
 #include <runtime/function/function.h>
 
 
 bool interpret(const std::string& code) {
     std::istringstream input(code);
     std::ostringstream output;
-    return Interpreter::Interpret(input, output);
+    return RunScript(input, output);
 }
 
 std::string interpret_with_output(const std::string& code) {
     std::istringstream input(code);
     std::ostringstream output;
-    if (Interpreter::Interpret(input, output)) {
+    if (RunScript(input, output)) {
         return output.str();
     }
     return "";
@@ -50,8 +56,8 @@ TEST_F(ValueTest, NilCreation) {
 
 TEST_F(ValueTest, ArrayCreation) {
     Value::Array arr;
-    arr.push_back(std::make_shared<Value>(1.0));
-    arr.push_back(std::make_shared<Value>("test"));
+    arr.push_back(Value(1.0));
+    arr.push_back(Value("test"));
 
     Value v(arr);
     EXPECT_TRUE(v.IsList());
@@ -59,6 +65,69 @@ TEST_F(ValueTest, ArrayCreation) {
 }
 
 
+TEST_F(ValueTest, FitsInOneWord) {
+    EXPECT_EQ(sizeof(Value), 8);
+}
+
+TEST_F(ValueTest, SpecialDoublesStayNumbers) {
+    Value nan(std::nan(""));
+    Value negative_nan(-std::nan(""));
+    Value infinity(-std::numeric_limits<double>::infinity());
+
+    EXPECT_TRUE(nan.IsNumber());
+    EXPECT_TRUE(std::isnan(nan.AsNumber()));
+    EXPECT_TRUE(negative_nan.IsNumber());
+    EXPECT_TRUE(infinity.IsNumber());
+    EXPECT_EQ(infinity.AsNumber(), -std::numeric_limits<double>::infinity());
+}
+
+TEST_F(ValueTest, CopiesShareHeapPayload) {
+    Value original(std::string("payload"));
+    Value copy = original;
+
+    EXPECT_EQ(&copy.AsString(), &original.AsString());
+
+    original = Value(1.0);
+    EXPECT_EQ(copy.AsString(), "payload");
+}
+
+TEST_F(ValueTest, ListCopiesShareStorage) {
+    Value::Array arr;
+    arr.push_back(Value(1.0));
+
+    Value original(std::move(arr));
+    Value copy = original;
+    copy.AsList().push_back(Value(2.0));
+
+    EXPECT_EQ(&copy.AsList(), &original.AsList());
+    EXPECT_EQ(original.AsList().size(), 2);
+}
+
+TEST_F(ValueTest, AppendStringCopiesOnlyWhenShared) {
+    Value text(std::string("abc"));
+    const std::string* buffer = &text.AsString();
+    text.AppendString("d");
+    EXPECT_EQ(&text.AsString(), buffer);
+
+    Value copy = text;
+    text.AppendString("e");
+    EXPECT_NE(&text.AsString(), buffer);
+    EXPECT_EQ(text.AsString(), "abcde");
+    EXPECT_EQ(copy.AsString(), "abcd");
+}
+
+TEST_F(ValueTest, RangeMaterializesForEveryCopy) {
+    Value original(Range(0, 3, 1));
+    Value copy = original;
+    EXPECT_TRUE(original.IsRange());
+
+    copy.AsList().push_back(Value(3.0));
+
+    EXPECT_FALSE(original.IsRange());
+    EXPECT_TRUE(original.IsList());
+    EXPECT_EQ(original.AsList().size(), 4);
+}
+
 class EnvironmentTest : public ::testing::Test {
 protected:
     void SetUp() override {
@@ -94,6 +163,87 @@ TEST_F(EnvironmentTest, UndefinedVariableThrows) {
     EXPECT_THROW(env->Get("undefined"), EnviromentError);
 }
 
+TEST_F(EnvironmentTest, SlotAddressing) {
+    Enviroment inner(env.get());
+    env->SetLocal(1, Value(42.0));
+    inner.SetLocal(0, Value(24.0));
+
+    LexicalAddress outer_slot{LexicalAddress::Kind::Local, 1, 1};
+    LexicalAddress inner_slot{LexicalAddress::Kind::Local, 0, 0};
+    EXPECT_EQ(inner.Get(outer_slot, "x").AsNumber(), 42.0);
+    EXPECT_EQ(inner.Get(inner_slot, "y").AsNumber(), 24.0);
+
+    inner.Set(outer_slot, Value(1.0));
+    EXPECT_EQ(env->Get(LexicalAddress{LexicalAddress::Kind::Local, 0, 1}, "x").AsNumber(), 1.0);
+    EXPECT_THROW(inner.Get(LexicalAddress{LexicalAddress::Kind::Local, 1, 0}, "z"), EnviromentError);
+}
+
+
+TEST_F(EnvironmentTest, BorrowedSlotsGrowIntoOwnedOnes) {
+    std::optional<Value> storage[1];
+    Enviroment inner(env.get(), std::span<std::optional<Value>>(storage));
+    inner.SetLocal(0, Value(42.0));
+    EXPECT_EQ(storage[0]->AsNumber(), 42.0);
+
+    inner.SetLocal(2, Value(24.0));
+    LexicalAddress first{LexicalAddress::Kind::Local, 0, 0};
+    LexicalAddress third{LexicalAddress::Kind::Local, 0, 2};
+    EXPECT_EQ(inner.Get(first, "x").AsNumber(), 42.0);
+    EXPECT_EQ(inner.Get(third, "y").AsNumber(), 24.0);
+    EXPECT_EQ(inner.Find(LexicalAddress{LexicalAddress::Kind::Local, 0, 1}), nullptr);
+}
+
+
+TEST(ValueStackTest, RegionsSurviveLaterPushesAndAreResetOnRelease) {
+    ValueStack<Value> stack;
+    Value shared(std::string("shared"));
+    {
+        ValueStack<Value>::Scope outer(stack);
+        std::span<Value> first = stack.Push(4000);
+        first[0] = shared;
+        {
+            ValueStack<Value>::Scope inner(stack);
+            std::span<Value> second = stack.Push(200);
+            second[199] = Value(1.0);
+            std::span<Value> large = stack.Push(10000);
+            large[9999] = shared;
+            EXPECT_NE(second.data(), first.data() + 4000);
+        }
+        EXPECT_EQ(first[0].AsString(), "shared");
+        std::span<Value> again = stack.Push(200);
+        EXPECT_TRUE(again[199].IsNil());
+    }
+    std::span<Value> reused = stack.Push(1);
+    EXPECT_TRUE(reused[0].IsNil());
+}
+
+
+TEST(GlobalTableTest, NamesBindToStableSlots) {
+    GlobalTable globals;
+    std::size_t x = globals.Bind("x");
+    std::size_t y = globals.Bind("y");
+
+    EXPECT_NE(x, y);
+    EXPECT_EQ(globals.Bind("x"), x);
+    EXPECT_THROW(globals.Get(x), EnviromentError);
+
+    globals.Set(x, Value(42.0));
+    globals.Define("y", Value(24.0));
+    EXPECT_EQ(globals.Get(x).AsNumber(), 42.0);
+    EXPECT_EQ(globals.Get("y").AsNumber(), 24.0);
+    EXPECT_EQ(globals.Names(), (std::vector<std::string>{"x", "y"}));
+}
+
+TEST(GlobalTableTest, BuiltinsArePreBound) {
+    GlobalTable globals;
+    std::ostringstream output;
+    std::istringstream input;
+    BuiltinRegistry::Get().RegisterAll(globals, output, input);
+
+    EXPECT_TRUE(globals.Has("len"));
+    EXPECT_TRUE(globals.Get("print").IsFunction());
+}
+
 
 class InterpreterTest : public ::testing::Test {
 protected:
@@ -135,6 +285,301 @@ TEST_F(InterpreterTest, VariableOperations) {
 }
 
 
+TEST_F(InterpreterTest, CompoundAssignment) {
+    std::string code = R"(
+        x = 7
+        x += 3
+        x -= 1
+        x *= 4
+        x /= 6
+        x %= 4
+        x ^= 3
+        println(x)
+
+        s = "a"
+        for i in range(3)
+            s += "b"
+        end for
+        s *= 2
+        println(s)
+
+        xs = [1]
+        alias = xs
+        xs += [2, 3]
+        xs += xs
+        println(join(alias, ","))
+        println(join([0] + xs, ","))
+
+        f = function()
+            total = 0
+            add = function(v)
+                total += v
+            end function
+            add(5)
+            add(6)
+            return total
+        end function
+        print(f())
+    )";
+    EXPECT_EQ(interpret_with_output(code), "8\nabbbabbb\n1,2,3,1,2,3\n0,1,2,3,1,2,3\n11");
+}
+
+
+TEST_F(InterpreterTest, QuickenedNodesFallBackOnNewTypes) {
+    std::string code = R"(
+        add = function(a, b)
+            return a + b
+        end function
+        get = function(c, i)
+            return c[i]
+        end function
+        less = function(a, b)
+            if a < b then return 1 end if
+            return 0
+        end function
+
+        xs = [10, 20, 30]
+        total = 0
+        hits = 0
+        for i in range(24)
+            total = add(total, get(xs, i % 3))
+            hits = hits + less(i, 10)
+        end for
+        println(total)
+        println(hits)
+
+        println(add("a", "b"))
+        println(add(1, 2))
+        println(get("hey", 1))
+        println(get(range(5), -1))
+        println(less("a", "b"))
+
+        k = 0
+        while k < 10 and k != 7
+            k = k + 1
+        end while
+        print(k)
+    )";
+    EXPECT_EQ(interpret_with_output(code), "480\n10\nab\n3\ne\n4\n1\n7");
+}
+
+TEST(QuickeningSiteTest, QuickensOnStableKinds) {
+    QuickeningSite stable;
+    for (int i = 0; i < QuickeningSite::kWarmup; ++i) {
+        EXPECT_EQ(stable.state, QuickeningSite::State::Warming);
+        stable.Observe(0, 0);
+    }
+    EXPECT_EQ(stable.state, QuickeningSite::State::Quickened);
+    EXPECT_TRUE(stable.Matches(0, 0));
+
+    QuickeningSite mixed;
+    mixed.Observe(0, 0);
+    mixed.Observe(3, 0);
+    EXPECT_EQ(mixed.state, QuickeningSite::State::Generic);
+}
+
+
+TEST_F(InterpreterTest, FusedIdiomsFallBackOnOtherTypes) {
+    std::string code = R"(
+        s = "a"
+        b = "b"
+        i = 0
+        while i < 3
+            s = s + b
+            i = i + 1
+        end while
+        println(s)
+
+        xs = range(4)
+        bump = function(c)
+            c += 1
+            return c
+        end function
+        c = bump(true)
+        j = -1
+        println(xs[j])
+        println(c)
+        println("a" < "b")
+
+        ys = [1, 2]
+        zs = [3]
+        w = ys + zs
+        print(join(w, ","))
+    )";
+    EXPECT_EQ(interpret_with_output(code), "abbb\n3\n2\ntrue\n1,2,3");
+    EXPECT_FALSE(interpret("xs = [1]\ni = 2\nprint(xs[i])"));
+    EXPECT_FALSE(interpret("f = function()\n  z = z + 1\nend function\nf()"));
+}
+
+TEST_F(InterpreterTest, DumpsFusionHitRates) {
+    std::istringstream input(R"(
+        i = 0
+        n = 4
+        s = "x"
+        y = "y"
+        while i < n
+            i = i + 1
+            s = s + y
+        end while
+        t = 1
+        t = t + i
+    )");
+    std::ostringstream output;
+    std::ostringstream stats;
+    ASSERT_TRUE(Interpreter::Interpret(input, output, &stats));
+
+    std::string dump = stats.str();
+    EXPECT_NE(dump.find("increment           1           4    100.0%"), std::string::npos) << dump;
+    EXPECT_NE(dump.find("compare             1           5    100.0%"), std::string::npos) << dump;
+    EXPECT_NE(dump.find("index               0           0         -"), std::string::npos) << dump;
+    EXPECT_NE(dump.find("assign-binary       2           5     20.0%"), std::string::npos) << dump;
+}
+
+TEST_F(InterpreterTest, DumpsCallSiteCacheHitRates) {
+    std::istringstream input(R"(
+        double = function(x) return x * 2 end function
+        halve = function(x) return x / 2 end function
+        apply = function(f, x) return f(x) end function
+        total = 0
+        for i in range(4)
+            total += double(i) + abs(i)
+        end for
+        total += apply(double, 1) + apply(halve, 1) + apply(double, 1)
+        println(total)
+    )");
+    std::ostringstream output;
+    std::ostringstream stats;
+    ASSERT_TRUE(Interpreter::Interpret(input, output, nullptr, &stats));
+    EXPECT_EQ(output.str(), "22.5\n");
+
+    std::string dump = stats.str();
+    EXPECT_NE(dump.find("builtin             3           6     50.0%"), std::string::npos) << dump;
+    EXPECT_NE(dump.find("script              5          10     30.0%"), std::string::npos) << dump;
+}
+
+
+TEST_F(InterpreterTest, CallSiteSeesReassignedGlobalCallee) {
+    std::istringstream input(R"(
+        op = function(x) return x + 1 end function
+        result = ""
+        for i in range(4)
+            result += to_string(op(i)) + " "
+            if i == 1 then op = function(x) return x * 10 end function end if
+            if i == 2 then op = abs end if
+        end for
+        println(result)
+    )");
+    std::ostringstream output;
+    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    EXPECT_EQ(output.str(), "\"1 2 20 3 \"\n");
+}
+
+
+TEST_F(InterpreterTest, DeepRecursionKeepsArgumentsAndLocals) {
+    std::string code = R"(
+        count = function(n, tag)
+            if n == 0 then
+                return 0
+            end if
+            mine = [n, tag]
+            rest = count(n - 1, tag + "")
+            return rest + len(mine) - 1 + len(tag) - 3
+        end function
+        println(count(3000, "abc"))
+    )";
+    EXPECT_EQ(interpret_with_output(code), "3000\n");
+}
+
+TEST_F(InterpreterTest, CallsDeeperThanTheLimitFailWithStackOverflow) {
+    std::string code = R"(
+        count = function(n, tag)
+            if n == 0 then return 0 end if
+            return count(n - 1, tag + "") + len(tag)
+        end function
+    )";
+    auto run = [&](std::string n, std::size_t max_depth) {
+        std::istringstream input(code + "println(count(" + n + ", \"x\"))");
+        std::ostringstream output;
+        return Interpreter::Interpret(input, output, nullptr, nullptr, max_depth);
+    };
+    EXPECT_TRUE(run("99", 100));
+    EXPECT_FALSE(run("100", 100));
+    EXPECT_TRUE(run("150000", kDefaultMaxCallDepth));
+}
+
+TEST_F(InterpreterTest, CallsStopAtTheStackLimitWhenNoStackCanBeReserved) {
+    // A stack for this many calls cannot be reserved, so the program runs on
+    // the caller's stack, and the depth limit shrinks to what it holds.
+    std::istringstream input(R"(
+        count = function(n) return count(n + 1) + 1 end function
+        println(count(0))
+    )");
+    std::ostringstream output;
+    EXPECT_FALSE(Interpreter::Interpret(input, output, nullptr, nullptr, std::size_t{1} << 40));
+    EXPECT_EQ(output.str(), "");
+}
+
+TEST_F(InterpreterTest, StacktraceListsCallsInProgressWithTheirLines) {
+    std::istringstream input(R"(outer = function(n)
+        inner = function(k) return stacktrace() end function
+        trace = inner(n)
+        return trace
+    end function
+    count = function(n)
+        if n == 0 then return stacktrace() end if
+        return count(n - 1)
+    end function
+    anonymous = [function() return stacktrace() end function]
+    traces = [outer(1), anonymous[0](), count(3), stacktrace()]
+    print(join(traces, " | ")))");
+    std::ostringstream output;
+    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    EXPECT_EQ(output.str(),
+              "\"stacktrace: [global] -> outer (line 11) -> inner (line 3)"
+              " | stacktrace: [global] -> [anonymous] (line 11)"
+              " | stacktrace: [global] -> count (line 8)"
+              " | stacktrace: [global]\"");
+}
+
+TEST_F(InterpreterTest, TailCallsRunInConstantStack) {
+    std::istringstream input(R"(
+        count = function(i, acc, tag)
+            if i == 0 then
+                return tag + to_string(acc)
+            end if
+            return count(i - 1, acc + 1, tag)
+        end function
+        is_odd = function(n) return nil end function
+        is_even = function(n)
+            if n == 0 then return "even" end if
+            return is_odd(n - 1)
+        end function
+        is_odd = function(n)
+            if n == 0 then return "odd" end if
+            return is_even(n - 1)
+        end function
+        println(count(100000, 0, "n="))
+        println(is_even(100001))
+        println(len(is_even(0)))
+    )");
+    std::ostringstream output;
+    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    EXPECT_EQ(output.str(), "n=100000\nodd\n4\n");
+}
+
+TEST_F(InterpreterTest, CapturedFramesOutliveCallsInTailPosition) {
+    std::istringstream input(R"(
+        apply = function(f) return f() end function
+        twice = function(x)
+            return apply(function() return x * 2 end function)
+        end function
+        println(twice(21))
+    )");
+    std::ostringstream output;
+    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    EXPECT_EQ(output.str(), "42\n");
+}
+
 class BuiltinTest : public ::testing::Test {
 protected:
     void SetUp() override {}
@@ -158,6 +603,38 @@ TEST_F(BuiltinTest, ArrayFunctions) {
     EXPECT_EQ(interpret_with_output("print(len(range(0, 10, 2)))"), "5");
 }
 
+TEST_F(BuiltinTest, IndexAssignmentUpdatesSharedList) {
+    std::string code = R"(
+        counts = [0, 0, 0]
+        alias = counts
+        for x in [0, 2, 2, 1, 2]
+            counts[x] += 1
+        end for
+        alias[-1] = alias[-1] * 10
+        println(join(counts, ","))
+
+        sieve = push(range(20), 0)
+        sieve[0] = 0
+        sieve[1] = 0
+        for i in range(2, 20)
+            if sieve[i] != 0 then
+                j = i * i
+                while j < 20
+                    sieve[j] = 0
+                    j = j + i
+                end while
+            end if
+        end for
+        primes = 0
+        for v in sieve
+            if v != 0 then primes = primes + 1 end if
+        end for
+        print(primes)
+    )";
+
+    EXPECT_EQ(interpret_with_output(code), "1,1,30\n8");
+}
+
 
 class FunctionTest : public ::testing::Test {
 protected:
@@ -194,6 +671,34 @@ TEST_F(FunctionTest, FunctionWithoutReturn) {
     EXPECT_EQ(interpret_with_output(code), "\"Hello, World\"");
 }
 
+TEST_F(FunctionTest, AssignsGlobalDefinedAfterFunction) {
+    std::string code = R"(
+        bump = function()
+            counter = counter + 1
+        end function
+        counter = 10
+        bump()
+        bump()
+        print(counter)
+    )";
+    EXPECT_EQ(interpret_with_output(code), "12");
+}
+
+TEST_F(FunctionTest, ParametersShadowOuterNames) {
+    std::string code = R"(
+        x = 1
+        f = function(x)
+            for i in range(2)
+                x = x + i
+            end for
+            return x
+        end function
+        print(f(5))
+        print(x)
+    )";
+    EXPECT_EQ(interpret_with_output(code), "61");
+}
+
 
 class ErrorTest : public ::testing::Test {
 protected:
@@ -204,6 +709,10 @@ TEST_F(ErrorTest, UndefinedVariable) {
     EXPECT_FALSE(interpret("print(undefined_var)"));
 }
 
+TEST_F(ErrorTest, ReadBeforeAssignment) {
+    EXPECT_FALSE(interpret("f = function()\n  z = z + 1\nend function\nf()"));
+}
+
 TEST_F(ErrorTest, CallNonFunction) {
     EXPECT_FALSE(interpret("x = 42\nx()"));
 }
@@ -216,4 +725,10 @@ TEST_F(ErrorTest, InvalidOperations) {
 TEST_F(ErrorTest, IndexOutOfBounds) {
     EXPECT_FALSE(interpret("s = \"hello\"\nprint(s[10])"));
     EXPECT_FALSE(interpret("arr = [1, 2, 3]\nprint(arr[5])"));
+    EXPECT_FALSE(interpret("arr = [1, 2, 3]\narr[3] = 0"));
+    EXPECT_FALSE(interpret("arr = [1, 2, 3]\narr[-4] += 1"));
+}
+
+TEST_F(ErrorTest, AssignToNonListElement) {
+    EXPECT_FALSE(interpret("f = function() return \"abc\" end function\ns = f()\ns[0] = \"x\""));
 }
@@ -705,6 +705,19 @@ TEST(Semantic, SliceOnlyEnd) {
     EXPECT_TRUE(analyze("arr = [1, 2, 3]\n x = arr[:2]"));
 }
 
+TEST(Semantic, IndexAssignment) {
+    EXPECT_TRUE(analyze("arr = [1, 2, 3]\n arr[0] = 5\n arr[-1] += arr[0]"));
+    EXPECT_FALSE(analyze("s = \"hello\"\n s[0] = \"j\""));
+    EXPECT_FALSE(analyze("arr = [1, 2, 3]\n arr[\"a\"] = 1"));
+}
+
+TEST(Semantic, CompoundAssignment) {
+    EXPECT_TRUE(analyze("s = \"a\"\n s += 1\n s *= 2"));
+    EXPECT_TRUE(analyze("xs = [1]\n xs += [2]\n y = xs[0]"));
+    EXPECT_FALSE(analyze("x = 1\n x -= \"a\""));
+    EXPECT_FALSE(analyze("s = \"a\"\n s /= 2"));
+}
+
 TEST(SemanticSlicing, ValidSlicing) {
     EXPECT_TRUE(analyze("arr = [1, 2, 3, 4]\n x = arr[1:3]"));
     EXPECT_TRUE(analyze("s = \"hello\"\n sub = s[0:2]"));
@@ -712,3 +725,241 @@ TEST(SemanticSlicing, ValidSlicing) {
     EXPECT_TRUE(analyze("arr = [1, 2, 3]\n x = arr[1:]"));
     EXPECT_TRUE(analyze("arr = [1, 2, 3]\n x = arr[:2]"));
 }
+
+
+TEST(SemanticAddress, LocalsResolveToDepthAndSlot) {
+    std::istringstream in(
+        "f = function(a, b)\n"
+        "  c = a\n"
+        "  if c then\n"
+        "    b = c\n"
+        "  end if\n"
+        "  while c\n"
+        "    d = b\n"
+        "    c = d\n"
+        "  end while\n"
+        "end function"
+    );
+    auto ast = SyntaxAnalizer(in).Parse();
+    std::ostringstream errs;
+    ASSERT_TRUE(SemanticAnalizer(errs).Analyse(ast));
+
+    auto& assign_f = std::get<AssignExpression>(
+        std::get<ExpressionStatement>(ast[0].value).expression.value);
+    EXPECT_EQ(assign_f.address.kind, LexicalAddress::Kind::Global);
+
+    auto& function = std::get<FunctionExpression>(assign_f.rhs->value);
+    auto& assign_c = std::get<AssignExpression>(
+        std::get<ExpressionStatement>(function.f_body[0].value).expression.value);
+    EXPECT_EQ(assign_c.address.kind, LexicalAddress::Kind::Local);
+    EXPECT_EQ(assign_c.address.depth, 0u);
+    EXPECT_EQ(assign_c.address.slot, 2u);
+
+    auto& read_a = std::get<VariableExpression>(assign_c.rhs->value);
+    EXPECT_EQ(read_a.address.depth, 0u);
+    EXPECT_EQ(read_a.address.slot, 0u);
+
+    auto& branch = std::get<IfStatement>(function.f_body[1].value);
+    auto& assign_b = std::get<AssignExpression>(
+        std::get<ExpressionStatement>(branch.then_case[0].value).expression.value);
+    EXPECT_TRUE(branch.then_scope.elided);
+    EXPECT_EQ(assign_b.address.kind, LexicalAddress::Kind::Local);
+    EXPECT_EQ(assign_b.address.depth, 0u);
+    EXPECT_EQ(assign_b.address.slot, 1u);
+
+    auto& loop = std::get<WhileStatement>(function.f_body[2].value);
+    EXPECT_FALSE(loop.body_scope.elided);
+    EXPECT_FALSE(loop.body_scope.captured);
+    EXPECT_EQ(loop.body_scope.slots, 1u);
+
+    auto& assign_back = std::get<AssignExpression>(
+        std::get<ExpressionStatement>(loop.body[1].value).expression.value);
+    EXPECT_EQ(assign_back.address.depth, 1u);
+    EXPECT_EQ(assign_back.address.slot, 2u);
+}
+
+
+TEST(SemanticAddress, ClosuresMarkLoopScopesCaptured) {
+    std::istringstream in(
+        "fs = []\n"
+        "for i in range(3)\n"
+        "  g = function() return i end function\n"
+        "end for\n"
+        "for j in range(3)\n"
+        "  h = function() return 1 end function\n"
+        "end for"
+    );
+    auto ast = SyntaxAnalizer(in).Parse();
+    std::ostringstream errs;
+    ASSERT_TRUE(SemanticAnalizer(errs).Analyse(ast));
+
+    EXPECT_TRUE(std::get<ForStatement>(ast[1].value).body_scope.captured);
+    EXPECT_FALSE(std::get<ForStatement>(ast[2].value).body_scope.captured);
+}
+
+TEST(SemanticAddress, ReturnedCallsInsideFunctionsAreTailCalls) {
+    std::istringstream in(
+        "f = function(n)\n"
+        "  if n == 0 then return n end if\n"
+        "  return f(n - 1)\n"
+        "end function\n"
+        "g = function(n)\n"
+        "  if n == 0 then\n"
+        "    k = 1\n"
+        "    h = function() return k end function\n"
+        "  end if\n"
+        "  return f(n)\n"
+        "end function"
+    );
+    auto ast = SyntaxAnalizer(in).Parse();
+    std::ostringstream errs;
+    ASSERT_TRUE(SemanticAnalizer(errs).Analyse(ast));
+
+    auto body = [&](std::size_t i) -> const std::vector<Statement>& {
+        const auto& assign = std::get<AssignExpression>(std::get<ExpressionStatement>(ast[i].value).expression.value);
+        return std::get<FunctionExpression>(assign.rhs->value).f_body;
+    };
+    const auto& base = std::get<IfStatement>(body(0)[0].value);
+    EXPECT_FALSE(std::get<ReturnStatement>(base.then_case[0].value).tail_call);
+    EXPECT_TRUE(std::get<ReturnStatement>(body(0)[1].value).tail_call);
+    EXPECT_TRUE(std::get<ReturnStatement>(body(1)[1].value).tail_call);
+}
+
+
+TEST(SemanticAddress, CapturedVariablesBecomeCellsAndUpvalues) {
+    std::istringstream in(
+        "make = function(start)\n"
+        "  count = start\n"
+        "  inc = function()\n"
+        "    bump = function() count = count + 1 end function\n"
+        "    bump()\n"
+        "    return count\n"
+        "  end function\n"
+        "  return inc\n"
+        "end function"
+    );
+    auto ast = SyntaxAnalizer(in).Parse();
+    std::ostringstream errs;
+    ASSERT_TRUE(SemanticAnalizer(errs).Analyse(ast));
+
+    auto function_of = [](const Statement& stmt) -> const FunctionExpression& {
+        const auto& assign = std::get<AssignExpression>(std::get<ExpressionStatement>(stmt.value).expression.value);
+        return std::get<FunctionExpression>(assign.rhs->value);
+    };
+    auto expect_address = [](const LexicalAddress& address, LexicalAddress::Kind kind
+                            , std::uint32_t depth, std::uint32_t slot)
+    {
+        EXPECT_EQ(address.kind, kind);
+        EXPECT_EQ(address.depth, depth);
+        EXPECT_EQ(address.slot, slot);
+    };
+
+    const auto& make = function_of(ast[0]);
+    EXPECT_TRUE(make.captures.empty());
+    // Resolved before `inc` captures it, and still a cell.
+    const auto& assign_count = std::get<AssignExpression>(
+        std::get<ExpressionStatement>(make.f_body[0].value).expression.value);
+    expect_address(assign_count.address, LexicalAddress::Kind::Cell, 0, 1);
+    expect_address(std::get<VariableExpression>(assign_count.rhs->value).address
+                  , LexicalAddress::Kind::Local, 0, 0);
+
+    const auto& inc = function_of(make.f_body[1]);
+    ASSERT_EQ(inc.captures.size(), 1u);
+    expect_address(inc.captures[0], LexicalAddress::Kind::Cell, 0, 1);
+    const auto& read_count = std::get<VariableExpression>(
+        std::get<ReturnStatement>(inc.f_body[2].value).value->value);
+    expect_address(read_count.address, LexicalAddress::Kind::Upvalue, 0, 0);
+
+    const auto& bump = function_of(inc.f_body[0]);
+    ASSERT_EQ(bump.captures.size(), 1u);
+    expect_address(bump.captures[0], LexicalAddress::Kind::Upvalue, 0, 0);
+    const auto& increment = std::get<AssignExpression>(
+        std::get<ExpressionStatement>(bump.f_body[0].value).expression.value);
+    expect_address(increment.address, LexicalAddress::Kind::Upvalue, 0, 0);
+}
+
+
+TEST(SemanticEscape, ListsConfinedToTheirCallDoNotEscape) {
+    std::istringstream in(
+        "g = function(v) return v end function\n"
+        "f = function(a)\n"
+        "  xs = [a, 1]\n"
+        "  ys = [a, 2]\n"
+        "  zs = [a, 3]\n"
+        "  for x in xs\n"
+        "    ws = [x]\n"
+        "  end for\n"
+        "  n = len(xs) + ys[0] + [4, 5][1]\n"
+        "  g(zs)\n"
+        "  return [n]\n"
+        "end function\n"
+        "top = [1]"
+    );
+    auto ast = SyntaxAnalizer(in).Parse();
+    std::ostringstream errs;
+    ASSERT_TRUE(SemanticAnalizer(errs).Analyse(ast));
+
+    auto expression = [](const Statement& stmt) -> const Expression& {
+        return std::get<ExpressionStatement>(stmt.value).expression;
+    };
+    auto literal = [&](const Statement& stmt) -> const ListExpression& {
+        return std::get<ListExpression>(std::get<AssignExpression>(expression(stmt).value).rhs->value);
+    };
+    const auto& body = std::get<FunctionExpression>(
+        std::get<AssignExpression>(expression(ast[1]).value).rhs->value).f_body;
+
+    EXPECT_FALSE(literal(body[0]).escapes);
+    EXPECT_FALSE(literal(body[1]).escapes);
+    // Passed to a call.
+    EXPECT_TRUE(literal(body[2]).escapes);
+    // Made on every iteration.
+    EXPECT_TRUE(literal(std::get<ForStatement>(body[3].value).body[0]).escapes);
+
+    const auto& sum = std::get<BinaryExpression>(std::get<AssignExpression>(expression(body[4]).value).rhs->value);
+    const auto& indexed = std::get<IndexExpression>(sum.rhs->value);
+    EXPECT_FALSE(std::get<ListExpression>(indexed.object->value).escapes);
+
+    const auto& returned = std::get<ReturnStatement>(body[6].value);
+    EXPECT_TRUE(std::get<ListExpression>(returned.value->value).escapes);
+    EXPECT_TRUE(literal(ast[2]).escapes);
+}
+
+
+TEST(SemanticEscape, RebindingLenMakesMeasuredListsEscape) {
+    std::istringstream in(
+        "f = function()\n"
+        "  xs = [1]\n"
+        "  n = len(xs)\n"
+        "  return n\n"
+        "end function\n"
+        "len = function(v) return v end function"
+    );
+    auto ast = SyntaxAnalizer(in).Parse();
+    std::ostringstream errs;
+    ASSERT_TRUE(SemanticAnalizer(errs).Analyse(ast));
+
+    const auto& function = std::get<FunctionExpression>(std::get<AssignExpression>(
+        std::get<ExpressionStatement>(ast[0].value).expression.value).rhs->value);
+    const auto& assign = std::get<AssignExpression>(
+        std::get<ExpressionStatement>(function.f_body[0].value).expression.value);
+    EXPECT_TRUE(std::get<ListExpression>(assign.rhs->value).escapes);
+}
+
+
+TEST(SemanticEscape, ListsMeasuredInATailCallEscape) {
+    std::istringstream in(
+        "f = function()\n"
+        "  xs = [1]\n"
+        "  return len(xs)\n"
+        "end function"
+    );
+    auto ast = SyntaxAnalizer(in).Parse();
+    std::ostringstream errs;
+    ASSERT_TRUE(SemanticAnalizer(errs).Analyse(ast));
+
+    const auto& function = std::get<FunctionExpression>(std::get<AssignExpression>(
+        std::get<ExpressionStatement>(ast[0].value).expression.value).rhs->value);
+    const auto& assign = std::get<AssignExpression>(
+        std::get<ExpressionStatement>(function.f_body[0].value).expression.value);
+    EXPECT_TRUE(std::get<ListExpression>(assign.rhs->value).escapes);
+}
@@ -514,3 +514,14 @@ TEST(Parser, NestedIf) {
     SyntaxAnalizer p(in);
     EXPECT_NO_THROW(p.Parse());
 }
+
+TEST(Parser, IndexAssignment) {
+    std::istringstream in("xs[0] = 1\nxs[i + 1] += xs[i]\ngrid[i][j] = 0");
+    SyntaxAnalizer p(in);
+    auto program = p.Parse();
+    ASSERT_EQ(program.size(), 3);
+    const auto& statement = std::get<ExpressionStatement>(program[1].value);
+    const auto* assign = std::get_if<IndexAssignExpression>(&statement.expression.value);
+    ASSERT_NE(assign, nullptr);
+    EXPECT_EQ(assign->operation, TokenType::plus_eq_);
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include <runtime/interpreter/interpreter.h>
+#include <tests/engine.h>
 
 TEST(TypesTestSuite, IntTest) {
     std::string code = R"(
@@ -15,6 +16,6 @@ TEST(TypesTestSuite, IntTest) {
     std::istringstream input(code);
     std::ostringstream output;
 
-    ASSERT_TRUE(Interpreter::Interpret(input, output));
+    ASSERT_TRUE(RunScript(input, output));
     ASSERT_EQ(output.str(), expected);
 }
@@ -0,0 +1,240 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <tests/engine.h>
+#include <runtime/vm/vm.h>
+
+class VirtualMachineTest : public ::testing::Test {
+protected:
+    bool run_vm(const std::string& code) {
+        std::istringstream input(code);
+        std::ostringstream output;
+        return VirtualMachine::Interpret(input, output);
+    }
+
+    std::string vm_output(const std::string& code) {
+        std::istringstream input(code);
+        std::ostringstream output;
+        if (VirtualMachine::Interpret(input, output)) {
+            return output.str();
+        }
+        return "";
+    }
+};
+
+TEST_F(VirtualMachineTest, RecursiveFibonacci) {
+    std::string code = R"(
+        fib = function(n)
+            if n < 2 then
+                return n
+            end if
+            return fib(n - 1) + fib(n - 2)
+        end function
+
+        print(fib(20))
+    )";
+
+    EXPECT_EQ(vm_output(code), "6765");
+}
+
+TEST_F(VirtualMachineTest, LoopsWithBreakAndContinue) {
+    std::string code = R"(
+        s = 0
+        for i in range(20)
+            if i % 2 == 0 then
+                continue
+            end if
+            if i > 13 then
+                break
+            end if
+            s = s + i
+        end for
+
+        j = 0
+        while true
+            j = j + 1
+            if j == 5 then break end if
+        end while
+
+        print(s)
+        print(j)
+    )";
+
+    EXPECT_EQ(vm_output(code), tree_output(code));
+    EXPECT_EQ(vm_output(code), "495");
+}
+
+TEST_F(VirtualMachineTest, ClosuresCaptureEnclosingLocals) {
+    std::string code = R"(
+        make_counter = function()
+            count = 0
+            return function()
+                count = count + 1
+                return count
+            end function
+        end function
+
+        c = make_counter()
+        c()
+        c()
+        print(c())
+    )";
+
+    EXPECT_EQ(vm_output(code), "3");
+}
+
+TEST_F(VirtualMachineTest, FunctionsUpdateGlobals) {
+    std::string code = R"(
+        bump = function()
+            total = total + 10
+        end function
+
+        total = 1
+        bump()
+        bump()
+        print(total)
+    )";
+
+    EXPECT_EQ(vm_output(code), "21");
+}
+
+TEST_F(VirtualMachineTest, ListsStringsAndSlices) {
+    std::string code = R"(
+        xs = [1, 2, 3, 4, 5]
+        print(xs[1:3])
+        print(xs[-1])
+        s = "itmoscript"
+        print(s[0:4] * 2)
+        print(len(xs + [6]))
+    )";
+
+    EXPECT_EQ(vm_output(code), tree_output(code));
+}
+
+TEST_F(VirtualMachineTest, IndexAssignment) {
+    std::string code = R"(
+        grid = [[0, 0], [0, 0]]
+        row = grid[1]
+        for i in range(2)
+            for j in range(2)
+                grid[i][j] = i * 2 + j
+            end for
+        end for
+        row[0] += 10
+        xs = [1, 2, 3]
+        ys = xs
+        k = 0
+        xs[k] = xs[k] + (k = 2)
+        println(join(grid[0], ","))
+        println(join(row, ","))
+        print(join(ys, ","))
+    )";
+
+    EXPECT_EQ(vm_output(code), "0,1\n12,3\n3,2,3");
+    EXPECT_EQ(vm_output(code), tree_output(code));
+}
+
+TEST_F(VirtualMachineTest, CompoundAssignment) {
+    std::string code = R"(
+        text = ""
+        xs = []
+        alias = xs
+        for i in range(4)
+            text += "ab"
+            xs += [i]
+        end for
+        n = 10
+        n -= 4
+        n *= n
+        y = 1
+        y = (n /= 9) + y
+
+        collect = function(words)
+            out = ""
+            count = 0
+            join_word = function(w)
+                out += w
+                count += 1
+            end function
+            for w in words
+                join_word(w)
+            end for
+            return join([out, count], ":")
+        end function
+
+        println(text)
+        println(join(alias, ","))
+        println(n)
+        println(y)
+        print(collect(["x", "y", "z"]))
+    )";
+
+    EXPECT_EQ(vm_output(code), "abababab\n0,1,2,3\n4\n5\nxyz:3");
+    EXPECT_EQ(vm_output(code), tree_output(code));
+}
+
+TEST_F(VirtualMachineTest, DeepRecursionDoesNotUseNativeStack) {
+    std::string code = R"(
+        depth = function(n)
+            if n == 0 then return 0 end if
+            return depth(n - 1) + 1
+        end function
+
+        print(depth(100000))
+    )";
+
+    EXPECT_EQ(vm_output(code), "100000");
+}
+
+TEST_F(VirtualMachineTest, CallsDeeperThanTheLimitFailWithStackOverflow) {
+    std::string code = R"(
+        depth = function(n)
+            if n == 0 then return 0 end if
+            return depth(n - 1) + 1
+        end function
+    )";
+    auto run = [&](std::string n) {
+        std::istringstream input(code + "print(depth(" + n + "))");
+        std::ostringstream output;
+        return VirtualMachine::Interpret(input, output, 1000);
+    };
+    EXPECT_TRUE(run("999"));
+    EXPECT_FALSE(run("1000"));
+}
+
+TEST_F(VirtualMachineTest, FunctionsWithMoreThan256LiveValues) {
+    std::string locals;
+    std::string sum = "0";
+    std::string arguments = "0";
+    for (int k = 0; k < 300; ++k) {
+        locals += "a" + std::to_string(k) + " = " + std::to_string(k) + "\n";
+        sum += " + a" + std::to_string(k);
+        arguments += ", " + std::to_string(k);
+    }
+    std::string chain = "1";
+    for (int k = 1; k < 2000; ++k) {
+        chain += " + 1";
+    }
+    std::string code = "f = function()\n" + locals + "return " + sum + "\nend function\n"
+                     + "print(f())\n"
+                     + "print(max(" + arguments + "))\n"
+                     + "x = " + chain + "\nprint(x)\n"
+                     + "g = function() y = " + chain + " return y end function\nprint(g())";
+
+    EXPECT_EQ(vm_output(code), "44850299" "2000" "2000");
+}
+
+TEST_F(VirtualMachineTest, ProgramsWithMoreThan65536Constants) {
+    std::string code = "s = 0\n";
+    for (int k = 1; k <= 70000; ++k) {
+        code += "s = s + " + std::to_string(k) + "\n";
+    }
+    code += "print(s)";
+
+    EXPECT_EQ(vm_output(code), "2450035000");
+}
+
+TEST_F(VirtualMachineTest, RuntimeErrorsFailExecution) {
+    EXPECT_FALSE(run_vm("x = 1 + \"a\""));
+    EXPECT_FALSE(run_vm("f = 5\nf()"));
+    EXPECT_FALSE(run_vm("print(undefined_name)"));
+}